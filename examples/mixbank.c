@@ -0,0 +1,359 @@
+/*
+  MIXBANK:  Builds sound banks for the SDL mixer library.
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+/*
+ * Packs sound files into a bank for Mix_OpenBank(). Every file is loaded
+ * with Mix_LoadWAV() into a headless mixer of the target format, so anything
+ * SDL_mixer can load can go in a bank, and the bank holds exactly what the
+ * mixer would have had in memory. See src/sound_bank.c for the file layout.
+ *
+ * Sounds are named after their files, without the directory or extension,
+ * unless given as name=path. With -l, sounds are also read from a list
+ * file, one per line, which helps when there are too many for the command
+ * line. With -v, the ID of every sound is printed.
+ */
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+#include <SDL3_mixer/SDL_mixer.h>
+
+#include <stdio.h>
+
+#define BANK_VERSION        1
+#define BANK_HEADER_SIZE    32
+#define BANK_ENTRY_SIZE     24
+#define BANK_ALIGN          64
+
+typedef struct
+{
+    char *name;
+    char *path;
+    Mix_Chunk *chunk;
+    Uint64 offset;
+} BankSound;
+
+static BankSound *sounds = NULL;
+static int num_sounds = 0;
+static int max_sounds = 0;
+
+static const struct
+{
+    const char *name;
+    SDL_AudioFormat format;
+} formats[] = {
+    { "u8", SDL_AUDIO_U8 },
+    { "s16", SDL_AUDIO_S16 },
+    { "s32", SDL_AUDIO_S32 },
+    { "f32", SDL_AUDIO_F32 }
+};
+
+static void Usage(char *argv0)
+{
+    SDL_Log("Usage: %s [-f u8|s16|s32|f32] [-r rate] [-c channels] [-l listfile] [-v] -o bankfile [[name=]file ...]\n", argv0);
+    SDL_Log("  -f format    sample format of the bank (default s16)\n");
+    SDL_Log("  -r rate      sample rate of the bank (default 48000)\n");
+    SDL_Log("  -c channels  channels of the bank (default 2)\n");
+    SDL_Log("  -l listfile  also add the sounds listed in a file, one per line\n");
+    SDL_Log("  -v           print the ID of every sound\n");
+}
+
+static int add_sound(const char *arg)
+{
+    const char *equals = SDL_strchr(arg, '=');
+    BankSound *sound;
+
+    if (num_sounds == max_sounds) {
+        int count = max_sounds ? max_sounds * 2 : 256;
+        BankSound *more = (BankSound *)SDL_realloc(sounds, count * sizeof(*sounds));
+        if (!more) {
+            SDL_Log("Out of memory\n");
+            return -1;
+        }
+        sounds = more;
+        max_sounds = count;
+    }
+    sound = &sounds[num_sounds];
+    SDL_zerop(sound);
+
+    if (equals) {
+        sound->name = SDL_strdup(arg);
+        if (sound->name) {
+            sound->name[equals - arg] = '\0';
+        }
+        sound->path = SDL_strdup(equals + 1);
+    } else {
+        const char *base = SDL_strrchr(arg, '/');
+        const char *backslash = SDL_strrchr(arg, '\\');
+        char *dot;
+
+        if (!base || (backslash && backslash > base)) {
+            base = backslash;
+        }
+        sound->name = SDL_strdup(base ? base + 1 : arg);
+        if (sound->name) {
+            dot = SDL_strrchr(sound->name, '.');
+            if (dot && dot != sound->name) {
+                *dot = '\0';
+            }
+        }
+        sound->path = SDL_strdup(arg);
+    }
+    if (!sound->name || !sound->path) {
+        SDL_free(sound->name);
+        SDL_free(sound->path);
+        SDL_Log("Out of memory\n");
+        return -1;
+    }
+    if (!*sound->name) {
+        SDL_Log("Empty sound name for %s\n", arg);
+        SDL_free(sound->name);
+        SDL_free(sound->path);
+        return -1;
+    }
+    ++num_sounds;
+    return 0;
+}
+
+static int add_list(const char *list)
+{
+    size_t size;
+    char *data = (char *)SDL_LoadFile(list, &size);
+    char *line, *next;
+
+    if (!data) {
+        SDL_Log("Couldn't read %s: %s\n", list, SDL_GetError());
+        return -1;
+    }
+    for (line = data; line && *line; line = next) {
+        char *end;
+
+        next = SDL_strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        end = line + SDL_strlen(line);
+        while (end > line && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = '\0';
+        }
+        if (*line && *line != '#' && add_sound(line) < 0) {
+            SDL_free(data);
+            return -1;
+        }
+    }
+    SDL_free(data);
+    return 0;
+}
+
+static int SDLCALL compare_sounds(const void *a, const void *b)
+{
+    return SDL_strcmp(((const BankSound *)a)->name, ((const BankSound *)b)->name);
+}
+
+static void put_le32(Uint8 *p, Uint32 value)
+{
+    p[0] = (Uint8)value;
+    p[1] = (Uint8)(value >> 8);
+    p[2] = (Uint8)(value >> 16);
+    p[3] = (Uint8)(value >> 24);
+}
+
+static void put_le64(Uint8 *p, Uint64 value)
+{
+    put_le32(p, (Uint32)value);
+    put_le32(p + 4, (Uint32)(value >> 32));
+}
+
+static int write_bank(const char *file, const SDL_AudioSpec *spec)
+{
+    static const Uint8 padding[BANK_ALIGN];
+    Uint8 *head;
+    size_t head_size, name_pos, names_size = 0;
+    Uint64 pos;
+    SDL_RWops *dst;
+    int i, result = 0;
+
+    for (i = 0; i < num_sounds; ++i) {
+        names_size += SDL_strlen(sounds[i].name) + 1;
+    }
+    head_size = BANK_HEADER_SIZE + (size_t)num_sounds * BANK_ENTRY_SIZE + names_size;
+    head = (Uint8 *)SDL_calloc(1, head_size);
+    if (!head) {
+        SDL_Log("Out of memory\n");
+        return -1;
+    }
+
+    /* Samples follow the names, each on an aligned offset */
+    pos = (head_size + BANK_ALIGN - 1) & ~(Uint64)(BANK_ALIGN - 1);
+    for (i = 0; i < num_sounds; ++i) {
+        sounds[i].offset = pos;
+        pos += sounds[i].chunk->alen;
+        pos = (pos + BANK_ALIGN - 1) & ~(Uint64)(BANK_ALIGN - 1);
+    }
+
+    SDL_memcpy(head, "MIXBANK\x1a", 8);
+    put_le32(head + 8, BANK_VERSION);
+    put_le32(head + 12, (Uint32)num_sounds);
+    put_le32(head + 16, spec->format);
+    put_le32(head + 20, (Uint32)spec->channels);
+    put_le32(head + 24, (Uint32)spec->freq);
+    name_pos = BANK_HEADER_SIZE + (size_t)num_sounds * BANK_ENTRY_SIZE;
+    for (i = 0; i < num_sounds; ++i) {
+        Uint8 *entry = head + BANK_HEADER_SIZE + i * BANK_ENTRY_SIZE;
+        size_t len = SDL_strlen(sounds[i].name);
+
+        put_le64(entry, sounds[i].offset);
+        put_le32(entry + 8, sounds[i].chunk->alen);
+        put_le32(entry + 12, (Uint32)name_pos);
+        put_le32(entry + 16, (Uint32)len);
+        SDL_memcpy(head + name_pos, sounds[i].name, len + 1);
+        name_pos += len + 1;
+    }
+
+    dst = SDL_RWFromFile(file, "wb");
+    if (!dst) {
+        SDL_Log("Couldn't create %s: %s\n", file, SDL_GetError());
+        SDL_free(head);
+        return -1;
+    }
+    pos = head_size;
+    if (SDL_RWwrite(dst, head, head_size) != head_size) {
+        result = -1;
+    }
+    for (i = 0; i < num_sounds && result == 0; ++i) {
+        size_t pad = (size_t)(sounds[i].offset - pos);
+        const Mix_Chunk *chunk = sounds[i].chunk;
+
+        if (SDL_RWwrite(dst, padding, pad) != pad ||
+            SDL_RWwrite(dst, chunk->abuf, chunk->alen) != chunk->alen) {
+            result = -1;
+        }
+        pos = sounds[i].offset + chunk->alen;
+    }
+    if (SDL_RWclose(dst) < 0) {
+        result = -1;
+    }
+    if (result < 0) {
+        SDL_Log("Couldn't write %s: %s\n", file, SDL_GetError());
+    }
+    SDL_free(head);
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    SDL_AudioSpec spec;
+    const char *output = NULL;
+    SDL_bool verbose = SDL_FALSE;
+    Uint64 total = 0;
+    Uint16 format;
+    size_t f;
+    int i, result = 1;
+
+    spec.format = SDL_AUDIO_S16;
+    spec.channels = 2;
+    spec.freq = 48000;
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "-f") == 0 && argv[i+1]) {
+            ++i;
+            for (f = 0; f < SDL_arraysize(formats); ++f) {
+                if (SDL_strcasecmp(argv[i], formats[f].name) == 0) {
+                    spec.format = formats[f].format;
+                    break;
+                }
+            }
+            if (f == SDL_arraysize(formats)) {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (SDL_strcmp(argv[i], "-r") == 0 && argv[i+1]) {
+            spec.freq = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "-c") == 0 && argv[i+1]) {
+            spec.channels = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "-o") == 0 && argv[i+1]) {
+            output = argv[++i];
+        } else if (SDL_strcmp(argv[i], "-l") == 0 && argv[i+1]) {
+            if (add_list(argv[++i]) < 0) {
+                return 1;
+            }
+        } else if (SDL_strcmp(argv[i], "-v") == 0) {
+            verbose = SDL_TRUE;
+        } else if (argv[i][0] == '-') {
+            Usage(argv[0]);
+            return 1;
+        } else if (add_sound(argv[i]) < 0) {
+            return 1;
+        }
+    }
+    if (!output || spec.freq <= 0 || spec.channels <= 0) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    /* IDs are positions in the index, which is sorted by name */
+    SDL_qsort(sounds, num_sounds, sizeof(*sounds), compare_sounds);
+    for (i = 1; i < num_sounds; ++i) {
+        if (SDL_strcmp(sounds[i - 1].name, sounds[i].name) == 0) {
+            SDL_Log("Two sounds are named %s: %s and %s\n", sounds[i].name, sounds[i - 1].path, sounds[i].path);
+            return 1;
+        }
+    }
+
+    if (Mix_OpenAudioHeadless(&spec) < 0) {
+        SDL_Log("Couldn't open the mixer: %s\n", Mix_GetError());
+        return 1;
+    }
+    /* Hints like SDL_MIXER_HINT_FLOAT_MIXING can change what chunks hold */
+    Mix_QuerySpec(&spec.freq, &format, &spec.channels);
+    spec.format = format;
+    /* ...and the bank holds plain samples in that format */
+    SDL_SetHintWithPriority(SDL_MIXER_HINT_NATIVE_RATE_CHUNKS, "0", SDL_HINT_OVERRIDE);
+    SDL_SetHintWithPriority(SDL_MIXER_HINT_COMPACT_CHUNKS, "0", SDL_HINT_OVERRIDE);
+    for (i = 0; i < num_sounds; ++i) {
+        sounds[i].chunk = Mix_LoadWAV(sounds[i].path);
+        if (!sounds[i].chunk) {
+            SDL_Log("Couldn't load %s: %s\n", sounds[i].path, Mix_GetError());
+            goto done;
+        }
+        total += sounds[i].chunk->alen;
+        if (verbose) {
+            printf("%d\t%s\n", i, sounds[i].name);
+        }
+    }
+    if (write_bank(output, &spec) < 0) {
+        goto done;
+    }
+    SDL_Log("Wrote %d sounds, %" SDL_PRIu64 " bytes of samples, to %s\n", num_sounds, total, output);
+    result = 0;
+
+done:
+    for (i = 0; i < num_sounds; ++i) {
+        Mix_FreeChunk(sounds[i].chunk);
+        SDL_free(sounds[i].name);
+        SDL_free(sounds[i].path);
+    }
+    SDL_free(sounds);
+    Mix_CloseAudio();
+    SDL_Quit();
+    return result;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
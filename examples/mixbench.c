@@ -0,0 +1,283 @@
+/*
+  MIXBENCH:  A benchmark for the SDL mixer library.
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+/*
+ * Renders a synthetic workload with Mix_RenderAudio() (no audio device
+ * needed) across a sweep of output formats, channel layouts, voice counts,
+ * chunk types and effects, and prints one JSON object per configuration on
+ * stdout, so results can be collected and compared across releases.
+ *
+ * ns_per_frame is the wall time to mix one output sample frame, and
+ * voices_per_core is how many such voices a single core could keep mixing
+ * in real time at that rate.
+ */
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+#include <SDL3_mixer/SDL_mixer.h>
+
+#include <stdio.h>
+
+#define BENCH_FREQUENCY     48000
+#define ONESHOT_SECONDS     2           /* one-shot chunks outlast the timed render */
+#define LOOP_FRAMES         1000        /* short, so looping voices wrap often */
+
+typedef enum
+{
+    EFFECT_NONE,
+    EFFECT_POSITION,
+    EFFECT_DISTANCE,
+    EFFECT_REVERSE_STEREO
+} BenchEffect;
+
+static const char *effect_names[] = { "none", "position", "distance", "reverse_stereo" };
+
+static const struct
+{
+    SDL_AudioFormat format;
+    const char *name;
+} formats[] = {
+    { SDL_AUDIO_U8, "U8" },
+    { SDL_AUDIO_S16, "S16" },
+    { SDL_AUDIO_S32, "S32" },
+    { SDL_AUDIO_F32, "F32" }
+};
+
+static const int layouts[] = { 2, 4, 6 };
+static const int voice_counts[] = { 1, 8, 32, 128, 512 };
+static const int quick_voice_counts[] = { 8, 128 };
+
+
+/* Make a chunk holding a sine tone in the mixer's format */
+static Mix_Chunk *make_tone(int frames, float hz)
+{
+    SDL_AudioSpec src, dst;
+    int format_int, channels, freq;
+    Uint16 format;
+    float *samples;
+    Uint8 *converted = NULL;
+    int converted_len = 0;
+    int i, c;
+    Mix_Chunk *chunk;
+
+    Mix_QuerySpec(&freq, &format, &channels);
+    format_int = format;
+
+    samples = (float *)SDL_malloc((size_t)frames * channels * sizeof(float));
+    if (!samples) {
+        return NULL;
+    }
+    for (i = 0; i < frames; ++i) {
+        float v = 0.25f * (float)SDL_sin(2.0 * 3.14159265358979 * hz * i / freq);
+        for (c = 0; c < channels; ++c) {
+            samples[i * channels + c] = v;
+        }
+    }
+
+    src.format = SDL_AUDIO_F32;
+    src.channels = channels;
+    src.freq = freq;
+    dst.format = (SDL_AudioFormat)format_int;
+    dst.channels = channels;
+    dst.freq = freq;
+    if (SDL_ConvertAudioSamples(&src, (const Uint8 *)samples, frames * channels * (int)sizeof(float),
+                                &dst, &converted, &converted_len) < 0) {
+        SDL_free(samples);
+        return NULL;
+    }
+    SDL_free(samples);
+
+    chunk = Mix_QuickLoad_RAW(converted, (Uint32)converted_len);
+    if (!chunk) {
+        SDL_free(converted);
+        return NULL;
+    }
+    chunk->allocated = 1;   /* let Mix_FreeChunk() free the samples */
+    return chunk;
+}
+
+/* The effect functions return zero on error */
+static SDL_bool apply_effect(int channel, BenchEffect effect)
+{
+    switch (effect) {
+    case EFFECT_POSITION:
+        return Mix_SetPosition(channel, (Sint16)((channel * 37) % 360), (Uint8)(channel % 200)) ? SDL_TRUE : SDL_FALSE;
+    case EFFECT_DISTANCE:
+        return Mix_SetDistance(channel, (Uint8)(64 + channel % 128)) ? SDL_TRUE : SDL_FALSE;
+    case EFFECT_REVERSE_STEREO:
+        return Mix_SetReverseStereo(channel, 1) ? SDL_TRUE : SDL_FALSE;
+    default:
+        return SDL_TRUE;
+    }
+}
+
+/* Time one configuration; returns 0 and fills in ns_per_frame, or -1 if
+   the configuration isn't supported (for example, an effect that needs
+   stereo). */
+static int run_case(Mix_Chunk *chunk, int voices, SDL_bool looping, BenchEffect effect,
+                    void *buffer, int frames, double *ns_per_frame)
+{
+    Uint64 start, elapsed;
+    int i, ok = 0;
+
+    Mix_AllocateChannels(voices);
+    for (i = 0; i < voices; ++i) {
+        if (Mix_PlayChannel(i, chunk, looping ? -1 : 0) < 0 || !apply_effect(i, effect)) {
+            ok = -1;
+            break;
+        }
+    }
+
+    if (ok == 0) {
+        /* Warm up caches and lazily built tables, then measure */
+        Mix_RenderAudio(buffer, frames / 8);
+        start = SDL_GetPerformanceCounter();
+        if (Mix_RenderAudio(buffer, frames) < 0) {
+            ok = -1;
+        }
+        elapsed = SDL_GetPerformanceCounter() - start;
+        *ns_per_frame = ((double)elapsed * 1e9 / (double)SDL_GetPerformanceFrequency()) / frames;
+    }
+
+    Mix_HaltChannel(-1);
+    for (i = 0; i < voices; ++i) {
+        Mix_UnregisterAllEffects(i);
+    }
+    return ok;
+}
+
+static void Usage(char *argv0)
+{
+    SDL_Log("Usage: %s [-q] [-t threads] [-F] [-s seconds]\n", argv0);
+    SDL_Log("  -q          quick run: fewer voice counts, stereo S16 and F32 only\n");
+    SDL_Log("  -t threads  set SDL_MIXER_HINT_MIX_THREADS\n");
+    SDL_Log("  -F          set SDL_MIXER_HINT_FLOAT_MIXING\n");
+    SDL_Log("  -s seconds  audio to render per configuration (default 1)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    SDL_bool quick = SDL_FALSE;
+    const char *threads = "0";
+    SDL_bool float_mix = SDL_FALSE;
+    int seconds = 1;
+    int frames;
+    const int *counts = voice_counts;
+    int num_counts = (int)SDL_arraysize(voice_counts);
+    size_t f, l, v;
+    int i, loop, effect;
+    void *buffer;
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "-q") == 0) {
+            quick = SDL_TRUE;
+        } else if (SDL_strcmp(argv[i], "-t") == 0 && argv[i+1]) {
+            threads = argv[++i];
+        } else if (SDL_strcmp(argv[i], "-F") == 0) {
+            float_mix = SDL_TRUE;
+        } else if (SDL_strcmp(argv[i], "-s") == 0 && argv[i+1]) {
+            seconds = SDL_atoi(argv[++i]);
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (seconds <= 0) {
+        seconds = 1;
+    }
+    if (quick) {
+        counts = quick_voice_counts;
+        num_counts = (int)SDL_arraysize(quick_voice_counts);
+    }
+    frames = seconds * BENCH_FREQUENCY;
+
+    SDL_SetHint(SDL_MIXER_HINT_MIX_THREADS, threads);
+    SDL_SetHint(SDL_MIXER_HINT_FLOAT_MIXING, float_mix ? "1" : "0");
+
+    /* Big enough for the widest format and layout */
+    buffer = SDL_malloc((size_t)frames * 6 * sizeof(float));
+    if (!buffer) {
+        SDL_Log("Out of memory\n");
+        return 1;
+    }
+
+    for (f = 0; f < SDL_arraysize(formats); ++f) {
+        for (l = 0; l < SDL_arraysize(layouts); ++l) {
+            SDL_AudioSpec spec;
+            Mix_Chunk *oneshot, *looped;
+
+            if (quick && (layouts[l] != 2 || (formats[f].format != SDL_AUDIO_S16 && formats[f].format != SDL_AUDIO_F32))) {
+                continue;
+            }
+
+            spec.format = formats[f].format;
+            spec.channels = layouts[l];
+            spec.freq = BENCH_FREQUENCY;
+            if (Mix_OpenAudioHeadless(&spec) < 0) {
+                SDL_Log("Couldn't open %s/%d: %s\n", formats[f].name, layouts[l], Mix_GetError());
+                continue;
+            }
+
+            oneshot = make_tone(ONESHOT_SECONDS * BENCH_FREQUENCY * seconds, 440.0f);
+            looped = make_tone(LOOP_FRAMES, 480.0f);
+            if (!oneshot || !looped) {
+                SDL_Log("Couldn't create test chunks: %s\n", Mix_GetError());
+                Mix_FreeChunk(oneshot);
+                Mix_FreeChunk(looped);
+                Mix_CloseAudio();
+                continue;
+            }
+
+            for (v = 0; v < (size_t)num_counts; ++v) {
+                for (loop = 0; loop <= 1; ++loop) {
+                    for (effect = EFFECT_NONE; effect <= EFFECT_REVERSE_STEREO; ++effect) {
+                        double ns_per_frame = 0.0;
+                        int voices = counts[v];
+
+                        if (run_case(loop ? looped : oneshot, voices, loop ? SDL_TRUE : SDL_FALSE,
+                                     (BenchEffect)effect, buffer, frames, &ns_per_frame) < 0) {
+                            continue;
+                        }
+                        printf("{\"format\":\"%s\",\"channels\":%d,\"freq\":%d,\"voices\":%d,"
+                               "\"chunk\":\"%s\",\"effect\":\"%s\",\"mix_threads\":%d,\"float_mixing\":%d,"
+                               "\"ns_per_frame\":%.3f,\"voices_per_core\":%.1f}\n",
+                               formats[f].name, layouts[l], BENCH_FREQUENCY, voices,
+                               loop ? "looping" : "oneshot", effect_names[effect],
+                               SDL_atoi(threads), float_mix ? 1 : 0,
+                               ns_per_frame, (1e9 / BENCH_FREQUENCY) / ns_per_frame * voices);
+                        fflush(stdout);
+                    }
+                }
+            }
+
+            Mix_FreeChunk(oneshot);
+            Mix_FreeChunk(looped);
+            Mix_CloseAudio();
+        }
+    }
+
+    SDL_free(buffer);
+    Mix_Quit();
+    SDL_Quit();
+    return 0;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -267,6 +267,205 @@ typedef enum {
  */
 typedef struct _Mix_Music Mix_Music;
 
+/**
+ * A hint that makes SDL_mixer mix in a 32-bit float bus.
+ *
+ * By default, SDL_mixer mixes each channel straight into a buffer in the
+ * audio device's format, which clips the mix every time a channel is added.
+ * If this hint is set to "1" when Mix_OpenAudio() is called, music, channels,
+ * effects and the postmix callback all work on native-endian SDL_AUDIO_F32
+ * data instead, and the finished mix is clipped and converted to the device
+ * format exactly once per callback.
+ *
+ * While this is enabled, Mix_QuerySpec() reports SDL_AUDIO_F32, and data
+ * passed to Mix_QuickLoad_WAV() or Mix_QuickLoad_RAW() must be in that
+ * format.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_FLOAT_MIXING "SDL_MIXER_FLOAT_MIXING"
+
+/**
+ * A hint for the number of worker threads used to mix channels.
+ *
+ * By default, every channel is mixed on the audio device's thread. If this
+ * hint is set to a number greater than zero when Mix_OpenAudio() is called,
+ * SDL_mixer starts that many worker threads, and whenever enough channels are
+ * playing at once, it splits them between the workers and the audio thread.
+ * Each thread mixes its channels and runs their effects into a buffer of its
+ * own, and these are added together in a fixed order, so the output doesn't
+ * depend on thread timing. With only a few channels playing, everything is
+ * mixed on the audio thread as usual.
+ *
+ * While this is enabled, channel effects registered with Mix_RegisterEffect()
+ * may be called from any of these threads (never for the same channel at
+ * once), and Mix_ChannelFinished() callbacks for channels that ran out of
+ * data are made after the whole buffer has been mixed, so a sound started
+ * from that callback begins with the next buffer.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_MIX_THREADS "SDL_MIXER_MIX_THREADS"
+
+/**
+ * A hint to keep SDL_mixer from allocating memory while mixing.
+ *
+ * If this hint is set to "1" when Mix_OpenAudio() is called, SDL_mixer sets
+ * aside all of its mixing buffers up front, for the mixer itself, for any
+ * worker threads and for music decoding, and then mixes in blocks of at most
+ * 4096 sample frames, however much audio the device asks for at once.
+ *
+ * In debug builds, any SDL_malloc(), SDL_calloc() or SDL_realloc() that
+ * SDL_mixer itself makes on the audio thread during mixing, on a worker
+ * thread, or on the thread started for SDL_MIXER_HINT_MIX_AHEAD, is also
+ * logged as a warning, which helps track down decoders and effects that
+ * allocate. SDL's memory functions are left alone, so allocations made inside
+ * SDL, by the application's callbacks, or by third-party decoder libraries
+ * can't be seen this way.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_REALTIME "SDL_MIXER_REALTIME"
+
+/**
+ * A hint to keep loaded chunks at their own sample rate.
+ *
+ * By default, Mix_LoadWAV_RW() converts every chunk to the mixer's format,
+ * channels and sample rate as it loads it. If this hint is set to "1" when a
+ * chunk is loaded, the chunk is converted to the mixer's format and channels
+ * only, and it is resampled as it plays instead. This saves memory for sounds
+ * recorded at a lower rate than the device's, and such chunks stay valid if
+ * the audio device is reopened at a different rate (but the same format and
+ * channels).
+ *
+ * The `abuf` of a chunk loaded this way holds samples at the source's rate,
+ * not the mixer's, which matters to apps that read it directly.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_NATIVE_RATE_CHUNKS "SDL_MIXER_NATIVE_RATE_CHUNKS"
+
+/**
+ * A hint for the number of threads used for asynchronous loading.
+ *
+ * The threads are started by the first asynchronous load (see
+ * Mix_LoadWAVAsync()), so this should be set before that. The default is a
+ * single thread, so loads complete in priority order; "0" uses one thread
+ * per CPU core, at most 16.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_LOAD_THREADS "SDL_MIXER_LOAD_THREADS"
+
+/**
+ * A hint naming a directory to cache loaded chunks in, decoded and converted.
+ *
+ * By default, Mix_LoadWAV_RW() decodes and converts every file each time it's
+ * loaded. If this hint is set to an existing, writable directory when a chunk
+ * is loaded, the result is also written to a file in that directory, and
+ * later loads of the same file for the same audio format, by this process or
+ * the next, map that file into memory instead of decoding anything. Such
+ * chunks play straight from the mapping, like those from Mix_LoadWAVMapped().
+ *
+ * Cache files are found by a hash of the source file's contents, the audio
+ * device's format, channels and rate, SDL_MIXER_HINT_NATIVE_RATE_CHUNKS, the
+ * available chunk decoders and the SDL and SDL_mixer versions, and every
+ * cached file repeats these so they can be checked. Changing any of them
+ * simply misses the cache, so nothing needs to be invalidated by hand; the
+ * app can delete old files whenever it wants, as long as no chunk loaded
+ * from them is in use.
+ *
+ * Loads from the cache still read the whole source to hash it, so this pays
+ * off for compressed files and for files in another format than the device,
+ * and costs a little for WAV files that need no conversion.
+ *
+ * This also applies to everything else that loads with Mix_LoadWAV_RW(), like
+ * Mix_LoadWAVCached(), Mix_LoadWAVAsync() and Mix_LoadWAVBatch(). It's
+ * available on platforms where Mix_LoadWAVMapped() is.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_PCM_CACHE_DIR "SDL_MIXER_PCM_CACHE_DIR"
+
+/**
+ * A hint controlling how compactly loaded chunks hold their samples.
+ *
+ * By default, Mix_LoadWAV_RW() converts chunks to the audio device's format,
+ * so they can be mixed as they are. With float or 32-bit mixing, that's 4
+ * bytes per sample, which adds up for games with many sounds. The hint can
+ * be set to:
+ *
+ * - "s16": chunks are kept as 16-bit samples, half the size, and widened to
+ *   the device's format as they're mixed. This only makes a difference if
+ *   the device's format is SDL_AUDIO_F32 or SDL_AUDIO_S32, and loses nothing
+ *   for sources that are 16-bit or less.
+ * - "adpcm": chunks are encoded as IMA ADPCM, about a quarter of the size of
+ *   16-bit samples, and decoded as they play like those from
+ *   Mix_LoadCompressedWAV(). This is lossy, and such chunks get a decoder
+ *   each time they're played and ignore Mix_SetChannelPlaybackRate(). It
+ *   needs WAV support, and they're never written to
+ *   SDL_MIXER_HINT_PCM_CACHE_DIR.
+ *
+ * Any other value, or leaving the hint unset, stores chunks in the device's
+ * format. The hint is checked as each chunk is loaded, including by
+ * Mix_LoadWAVMapped(), which still plays 16-bit WAV files straight from the
+ * mapping with "s16". Chunks put together by the app with Mix_QuickLoad_RAW()
+ * and friends are unaffected.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_COMPACT_CHUNKS "SDL_MIXER_COMPACT_CHUNKS"
+
+/**
+ * A hint for how many milliseconds of music to decode ahead of playback.
+ *
+ * By default, music is decoded in the audio callback as it's needed, so a
+ * slow disk read or an expensive stretch of a MOD or MIDI file can make the
+ * audio device run dry. If this hint is set to a number of milliseconds when
+ * the audio device is opened, music is decoded that far ahead on a thread
+ * of its own, and the audio callback only copies it out.
+ *
+ * Playing, halting, seeking, jumping or starting another track throws away
+ * whatever was decoded ahead, so these take effect immediately. Volume
+ * changes and fades are applied as the music is played, and are immediate
+ * too. Mix_GetMusicPosition() reports the position being heard, not the
+ * position of the decoder.
+ *
+ * Larger values ride out longer stalls, and cost
+ * `frequency * channels * bytes per sample * milliseconds / 1000` bytes of
+ * memory. This doesn't apply to music played by an external command or
+ * native MIDI, which don't go through the audio callback, or to
+ * Mix_HookMusic().
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_MUSIC_DECODE_AHEAD "SDL_MIXER_MUSIC_DECODE_AHEAD"
+
+/**
+ * A hint for how many milliseconds of audio to mix ahead of the device.
+ *
+ * By default, everything is mixed in the audio device's callback as it asks
+ * for more, so the worst case cost of a mix has to fit in one device
+ * period. If this hint is set to a number of milliseconds when the audio
+ * device is opened, a thread of its own mixes that far ahead instead, in
+ * blocks of up to 4096 frames, and the device only copies out what's been
+ * mixed.
+ *
+ * This is a trade of latency for robustness: everything the app does, from
+ * Mix_PlayChannel() to volume changes, is heard that much later, and in
+ * exchange a mix can take that much longer than a device period without an
+ * underrun. Use timed commands (see Mix_SubmitCommands() and
+ * Mix_GetMixedFrames()) for sounds that have to start on a particular
+ * frame.
+ *
+ * In this mode Mix_LockAudio() locks the mixer thread out, rather than the
+ * device. This has no effect with Mix_OpenAudioHeadless(), where the app
+ * drives the mixing.
+ *
+ * \since This hint is available since SDL_mixer 3.0.0.
+ */
+#define SDL_MIXER_HINT_MIX_AHEAD "SDL_MIXER_MIX_AHEAD"
+
 /**
  * Open an audio device for playback.
  *
@@ -322,6 +521,60 @@ typedef struct _Mix_Music Mix_Music;
  */
 extern DECLSPEC int SDLCALL Mix_OpenAudio(SDL_AudioDeviceID devid, const SDL_AudioSpec *spec);
 
+/**
+ * Open the mixer without an audio device, to render audio on demand.
+ *
+ * This sets up SDL_mixer exactly like Mix_OpenAudio() does, but no audio
+ * device is opened and nothing is mixed until the app calls
+ * Mix_RenderAudio(). This is useful for rendering to a file, on a server,
+ * or in automated tests on machines without sound hardware; mixing runs as
+ * fast as the CPU allows.
+ *
+ * Unlike Mix_OpenAudio(), `spec` is used as-is: it is the format that
+ * Mix_RenderAudio() produces. The SDL audio subsystem does not need to be
+ * initialized.
+ *
+ * In this mode, channel fades, expiry and pauses are timed by the amount of
+ * audio rendered rather than by SDL_GetTicks(), so the output is the same no
+ * matter how fast or slow it is rendered. Music played through an external
+ * command or the system's native MIDI player is not part of the mix.
+ *
+ * If the mixer is already open, it is closed first. Close it with
+ * Mix_CloseAudio() when done.
+ *
+ * \param spec the audio format to render in.
+ * \returns 0 if successful, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_RenderAudio
+ * \sa Mix_CloseAudio
+ */
+extern DECLSPEC int SDLCALL Mix_OpenAudioHeadless(const SDL_AudioSpec *spec);
+
+/**
+ * Mix the next piece of audio into a buffer.
+ *
+ * This runs the same mixing as the audio callback does for a device (music,
+ * channels, effects and the postmix callback) and writes `frames` sample
+ * frames to `buffer`, in the format given to Mix_OpenAudioHeadless().
+ * `buffer` must hold `frames` times the frame size (bytes per sample times
+ * channels) bytes.
+ *
+ * This may only be used after Mix_OpenAudioHeadless(). Callbacks such as
+ * Mix_ChannelFinished() run on the calling thread, from inside this
+ * function.
+ *
+ * \param buffer the buffer to fill.
+ * \param frames the number of sample frames to render.
+ * \returns 0 if successful, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_OpenAudioHeadless
+ */
+extern DECLSPEC int SDLCALL Mix_RenderAudio(void *buffer, int frames);
+
 /**
  * Suspend or resume the whole audio output.
  *
@@ -380,7 +633,7 @@ extern DECLSPEC int SDLCALL Mix_QuerySpec(int *frequency, Uint16 *format, int *c
  *
  * \param numchans the new number of channels, or < 0 to query current channel
  *                 count.
- * \returns the new number of allocated channels.
+ * \returns the new number of allocated channels, or -1 on error.
  *
  * \since This function is available since SDL_mixer 3.0.0.
  */
@@ -468,6 +721,203 @@ extern DECLSPEC Mix_Chunk * SDLCALL Mix_LoadWAV_RW(SDL_RWops *src, SDL_bool free
  */
 extern DECLSPEC Mix_Chunk * SDLCALL Mix_LoadWAV(const char *file);
 
+/**
+ * Load a compressed audio file into a chunk that is decoded as it plays.
+ *
+ * Mix_LoadWAV_RW() decodes a whole file up front, so a few minutes of stereo
+ * audio can take tens of megabytes. This function instead keeps the file's
+ * encoded bytes in memory, and every time the chunk is played, the channel
+ * gets a decoder of its own that decodes just what's needed as it mixes. The
+ * chunk works with Mix_PlayChannel(), looping, fading and effects like any
+ * other, and many channels can play it at once.
+ *
+ * Any format the music decoders support works, except MIDI; formats are
+ * detected the same way as for Mix_LoadMUS_RW(), and the decoders must be
+ * available, just as they are for music.
+ *
+ * Some things differ from a regular chunk:
+ *
+ * - `abuf` and `alen` hold the encoded file, not samples.
+ * - Starting the chunk on a channel creates a decoder, which allocates
+ *   memory, and the channel finishing or being halted frees it.
+ * - Mix_SetChannelPlaybackRate() has no effect on it.
+ * - Decoding costs CPU time on every callback, so this is best used for
+ *   long sounds like ambience and voice-over, not frequent short effects.
+ *
+ * Such chunks stay valid if the audio device is reopened in another format.
+ *
+ * \param src an SDL_RWops that data will be read from.
+ * \param freesrc SDL_TRUE to close/free the SDL_RWops before returning,
+ *                SDL_FALSE to leave it open.
+ * \returns a new chunk, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadCompressedWAV
+ * \sa Mix_FreeChunk
+ */
+extern DECLSPEC Mix_Chunk * SDLCALL Mix_LoadCompressedWAV_RW(SDL_RWops *src, SDL_bool freesrc);
+
+/**
+ * Load a compressed audio file into a chunk that is decoded as it plays.
+ *
+ * This is equivalent to calling:
+ *
+ * ```c
+ * Mix_LoadCompressedWAV_RW(SDL_RWFromFile(file, "rb"), SDL_TRUE);
+ * ```
+ *
+ * \param file the filesystem path to load data from.
+ * \returns a new chunk, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadCompressedWAV_RW
+ * \sa Mix_FreeChunk
+ */
+extern DECLSPEC Mix_Chunk * SDLCALL Mix_LoadCompressedWAV(const char *file);
+
+/**
+ * Load a WAV file into a chunk that plays straight from a memory mapping.
+ *
+ * The file is mapped into memory read-only instead of being read. If it holds
+ * uncompressed samples in exactly the format of the audio device, the chunk
+ * points directly into the mapping, so loading takes about as long as opening
+ * the file no matter how large it is. Pages are read from disk the first time
+ * they're played, and the operating system shares them between every process
+ * that maps the same file.
+ *
+ * Unlike Mix_QuickLoad_WAV(), the file is fully validated: every RIFF chunk
+ * up to the samples must be within the file, and the format must be 8-bit
+ * unsigned, 16-bit or 32-bit signed, or 32-bit float PCM. If
+ * SDL_MIXER_HINT_NATIVE_RATE_CHUNKS is enabled, the sample rate doesn't have
+ * to match the device's either.
+ *
+ * Files in any other format, or that can't be played from the mapping, are
+ * loaded and converted just like Mix_LoadWAV() would, and the mapping is
+ * released before returning.
+ *
+ * Some things to keep in mind about a mapped chunk:
+ *
+ * - The file must not be truncated or rewritten while the chunk exists; on
+ *   most platforms, reading pages that are gone crashes the app.
+ * - The first time each part of the chunk is played, the audio thread may
+ *   wait for the disk. With SDL_MIXER_HINT_REALTIME, prefer Mix_LoadWAV() for
+ *   sounds that must never stall.
+ * - If the audio device is reopened in another format, the chunk stays in the
+ *   old one, like any other loaded chunk.
+ *
+ * Memory mapping is available on Windows and Unix-like platforms; elsewhere
+ * this function fails.
+ *
+ * \param file the filesystem path of the WAV file.
+ * \returns a new chunk, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadWAV
+ * \sa Mix_FreeChunk
+ */
+extern DECLSPEC Mix_Chunk * SDLCALL Mix_LoadWAVMapped(const char *file);
+
+/**
+ * Load a file into a chunk shared with everyone else who loads it.
+ *
+ * This works like Mix_LoadWAV(), except that the chunk is kept in a cache,
+ * keyed by the file's path and the mixer's current format: loading the same
+ * path again returns the same chunk, without touching the disk, and adds a
+ * reference to it. Mix_FreeChunk() drops a reference, and a chunk that no
+ * one holds any more stays loaded while the cache is within its budget (see
+ * Mix_SetChunkCacheBudget()), so it can be picked up again cheaply.
+ *
+ * Since the chunk is shared, its volume and contents are too. Freeing a
+ * cached chunk doesn't halt the channels playing it, as other users may be;
+ * it is halted when the cache actually frees it.
+ *
+ * \param file the filesystem path to load data from.
+ * \returns a new or shared chunk, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadWAVCached_RW
+ * \sa Mix_FreeChunk
+ */
+extern DECLSPEC Mix_Chunk * SDLCALL Mix_LoadWAVCached(const char *file);
+
+/**
+ * Load data from an SDL_RWops into a chunk shared with everyone else who
+ * loads the same data.
+ *
+ * This is like Mix_LoadWAVCached(), but the cache is keyed by a hash of the
+ * data itself, so the whole SDL_RWops is always read. It is then only
+ * decoded if nothing identical has been cached.
+ *
+ * \param src an SDL_RWops that data will be read from.
+ * \param freesrc SDL_TRUE to close/free the SDL_RWops before returning,
+ *                SDL_FALSE to leave it open.
+ * \returns a new or shared chunk, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadWAVCached
+ * \sa Mix_FreeChunk
+ */
+extern DECLSPEC Mix_Chunk * SDLCALL Mix_LoadWAVCached_RW(SDL_RWops *src, SDL_bool freesrc);
+
+/**
+ * Set how much memory the chunk cache may hold.
+ *
+ * Whenever the chunks in the cache add up to more than this many bytes, the
+ * ones nobody holds a reference to are freed, least recently loaded first.
+ * Chunks in use are never freed, so the cache can go over budget.
+ *
+ * The default budget is 0, which frees every cached chunk as soon as its last
+ * reference is dropped.
+ *
+ * \param bytes the most memory to keep unused chunks loaded in.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC void SDLCALL Mix_SetChunkCacheBudget(Uint64 bytes);
+
+/**
+ * Free every cached chunk that nobody holds a reference to.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC void SDLCALL Mix_FlushChunkCache(void);
+
+/**
+ * Chunk cache statistics, as reported by Mix_GetChunkCacheStats().
+ *
+ * \since This struct is available since SDL_mixer 3.0.0.
+ */
+typedef struct Mix_ChunkCacheStats {
+    Uint64 hits;            /**< Loads that found their chunk in the cache */
+    Uint64 misses;          /**< Loads that had to decode */
+    Uint64 evictions;       /**< Unused chunks freed to stay within budget */
+    int entries;            /**< Chunks in the cache */
+    int unreferenced;       /**< ...of which nobody holds a reference */
+    Uint64 bytes;           /**< Memory used by the chunks in the cache */
+    Uint64 budget;          /**< The budget set with Mix_SetChunkCacheBudget() */
+} Mix_ChunkCacheStats;
+
+/**
+ * Get statistics on the chunk cache.
+ *
+ * \param stats filled in with the statistics.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC void SDLCALL Mix_GetChunkCacheStats(Mix_ChunkCacheStats *stats);
+
+/**
+ * Reset the chunk cache's hit, miss and eviction counts to zero.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC void SDLCALL Mix_ResetChunkCacheStats(void);
+
 
 /**
  * Load a supported audio format into a music object.
@@ -561,44 +1011,391 @@ extern DECLSPEC Mix_Music * SDLCALL Mix_LoadMUS_RW(SDL_RWops *src, SDL_bool free
  * fly. Also, crucially, there are as many channels for chunks as the app can
  * allocate, but SDL_mixer only offers a single "music" channel.
  *
- * This function loads music data, and lets the application specify the type
- * of music being loaded, which might be useful if SDL_mixer cannot figure it
- * out from the data stream itself.
+ * This function loads music data, and lets the application specify the type
+ * of music being loaded, which might be useful if SDL_mixer cannot figure it
+ * out from the data stream itself.
+ *
+ * Currently, the following types are supported:
+ *
+ * - `MUS_NONE` (SDL_mixer should guess, based on the data)
+ * - `MUS_WAV` (Microsoft WAV files)
+ * - `MUS_MOD` (Various tracker formats)
+ * - `MUS_MID` (MIDI files)
+ * - `MUS_OGG` (Ogg Vorbis files)
+ * - `MUS_MP3` (MP3 files)
+ * - `MUS_FLAC` (FLAC files)
+ * - `MUS_OPUS` (Opus files)
+ * - `MUS_WAVPACK` (WavPack files)
+ *
+ * If `freesrc` is SDL_TRUE, the RWops will be closed before returning,
+ * whether this function succeeds or not. SDL_mixer reads everything it needs
+ * from the RWops during this call in any case.
+ *
+ * As a convenience, there is a function to read files from disk without
+ * having to deal with SDL_RWops: `Mix_LoadMUS("filename.mp3")` will manage
+ * those details for you (but not let you specify the music type explicitly)..
+ *
+ * When done with this music, the app should dispose of it with a call to
+ * Mix_FreeMusic().
+ *
+ * \param src an SDL_RWops that data will be read from.
+ * \param type the type of audio data provided by `src`.
+ * \param freesrc SDL_TRUE to close/free the SDL_RWops before returning,
+ *                SDL_FALSE to leave it open.
+ * \returns a new music object, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_FreeMusic
+ */
+extern DECLSPEC Mix_Music * SDLCALL Mix_LoadMUSType_RW(SDL_RWops *src, Mix_MusicType type, SDL_bool freesrc);
+
+/**
+ * A handle to a chunk or music being loaded in the background.
+ *
+ * \since This struct is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadWAVAsync
+ * \sa Mix_FreeAsyncLoad
+ */
+typedef struct Mix_AsyncLoad Mix_AsyncLoad;
+
+/**
+ * The state of an asynchronous load.
+ *
+ * \since This enum is available since SDL_mixer 3.0.0.
+ */
+typedef enum {
+    MIX_ASYNC_LOAD_PENDING,     /**< Waiting for a loader thread */
+    MIX_ASYNC_LOAD_RUNNING,     /**< Being loaded */
+    MIX_ASYNC_LOAD_DONE,        /**< Loaded successfully */
+    MIX_ASYNC_LOAD_FAILED,      /**< Failed, see Mix_GetAsyncLoadError() */
+    MIX_ASYNC_LOAD_CANCELED     /**< Canceled before it started */
+} Mix_AsyncLoadStatus;
+
+/**
+ * This is the format of a callback that reports that an asynchronous load
+ * has finished, successfully or not.
+ *
+ * It is called from a loader thread, and holds up the loads behind it, so
+ * keep it short. It is not called for canceled loads. It may call
+ * Mix_FreeAsyncLoad() on the handle it is given.
+ */
+typedef void (SDLCALL *Mix_AsyncLoadDone_t)(void *udata, Mix_AsyncLoad *load);
+
+/**
+ * Load a file into a chunk in the background.
+ *
+ * This queues up a Mix_LoadWAV() call to be run on a loader thread, and
+ * returns right away with a handle to the load. The app can then poll the
+ * handle with Mix_GetAsyncLoadStatus(), block on it with Mix_WaitAsyncLoad(),
+ * or get a callback when it is done; in any case, Mix_GetAsyncLoadChunk()
+ * then returns the chunk, which from then on belongs to the app, to free
+ * with Mix_FreeChunk() as usual.
+ *
+ * Loads with a higher `priority` run before those with a lower one, and loads
+ * of the same priority run in the order they were queued. Loads still
+ * waiting can be canceled with Mix_CancelAsyncLoad().
+ *
+ * Every handle must be freed with Mix_FreeAsyncLoad(). Mix_CloseAudio()
+ * cancels the loads still waiting, and waits for any that are running.
+ *
+ * \param file the filesystem path to load data from.
+ * \param priority the priority of this load, higher loads first.
+ * \param callback the function to call when the load is done, or NULL.
+ * \param udata an opaque pointer passed to `callback`.
+ * \returns a handle to the load, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadWAVAsync_RW
+ * \sa Mix_LoadMUSAsync
+ * \sa Mix_FreeAsyncLoad
+ */
+extern DECLSPEC Mix_AsyncLoad * SDLCALL Mix_LoadWAVAsync(const char *file, int priority, Mix_AsyncLoadDone_t callback, void *udata);
+
+/**
+ * Load data from an SDL_RWops into a chunk in the background.
+ *
+ * This is like Mix_LoadWAVAsync(), but loads with Mix_LoadWAV_RW(). The app
+ * must not use `src` until the load has finished or was canceled. If
+ * `freesrc` is SDL_TRUE, it is closed when the load is done with it, even if
+ * this function fails or the load is canceled.
+ *
+ * \param src an SDL_RWops that data will be read from.
+ * \param freesrc SDL_TRUE to close/free the SDL_RWops when done with it.
+ * \param priority the priority of this load, higher loads first.
+ * \param callback the function to call when the load is done, or NULL.
+ * \param udata an opaque pointer passed to `callback`.
+ * \returns a handle to the load, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_AsyncLoad * SDLCALL Mix_LoadWAVAsync_RW(SDL_RWops *src, SDL_bool freesrc, int priority, Mix_AsyncLoadDone_t callback, void *udata);
+
+/**
+ * Load a file into a music object in the background.
+ *
+ * This is like Mix_LoadWAVAsync(), but loads with Mix_LoadMUS(); get the
+ * result with Mix_GetAsyncLoadMusic().
+ *
+ * \param file the filesystem path to load data from.
+ * \param priority the priority of this load, higher loads first.
+ * \param callback the function to call when the load is done, or NULL.
+ * \param udata an opaque pointer passed to `callback`.
+ * \returns a handle to the load, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_AsyncLoad * SDLCALL Mix_LoadMUSAsync(const char *file, int priority, Mix_AsyncLoadDone_t callback, void *udata);
+
+/**
+ * Load data from an SDL_RWops into a music object in the background.
+ *
+ * This is like Mix_LoadWAVAsync_RW(), but loads with Mix_LoadMUS_RW(); get
+ * the result with Mix_GetAsyncLoadMusic().
+ *
+ * \param src an SDL_RWops that data will be read from.
+ * \param freesrc SDL_TRUE to close/free the SDL_RWops when done with it.
+ * \param priority the priority of this load, higher loads first.
+ * \param callback the function to call when the load is done, or NULL.
+ * \param udata an opaque pointer passed to `callback`.
+ * \returns a handle to the load, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_AsyncLoad * SDLCALL Mix_LoadMUSAsync_RW(SDL_RWops *src, SDL_bool freesrc, int priority, Mix_AsyncLoadDone_t callback, void *udata);
+
+/**
+ * Get the state of an asynchronous load, without waiting.
+ *
+ * \param load the load to query.
+ * \returns the state of the load.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_AsyncLoadStatus SDLCALL Mix_GetAsyncLoadStatus(Mix_AsyncLoad *load);
+
+/**
+ * Wait for an asynchronous load to finish, or be canceled.
+ *
+ * \param load the load to wait for.
+ * \returns the final state of the load.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_AsyncLoadStatus SDLCALL Mix_WaitAsyncLoad(Mix_AsyncLoad *load);
+
+/**
+ * Cancel an asynchronous load that hasn't started yet.
+ *
+ * A load that is already running can't be canceled; wait for it, or free the
+ * handle to have its result freed when it is done.
+ *
+ * \param load the load to cancel.
+ * \returns 0 if the load was canceled, -1 if it had already started.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_CancelAsyncLoad(Mix_AsyncLoad *load);
+
+/**
+ * Get the chunk an asynchronous load produced.
+ *
+ * \param load a load started with Mix_LoadWAVAsync() or
+ *             Mix_LoadWAVAsync_RW().
+ * \returns the chunk, or NULL if the load isn't done or failed.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_Chunk * SDLCALL Mix_GetAsyncLoadChunk(Mix_AsyncLoad *load);
+
+/**
+ * Get the music an asynchronous load produced.
+ *
+ * \param load a load started with Mix_LoadMUSAsync() or
+ *             Mix_LoadMUSAsync_RW().
+ * \returns the music, or NULL if the load isn't done or failed.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_Music * SDLCALL Mix_GetAsyncLoadMusic(Mix_AsyncLoad *load);
+
+/**
+ * Get the reason an asynchronous load failed.
+ *
+ * SDL's error message is kept per thread, so a loader thread's error is
+ * saved with the load instead.
+ *
+ * \param load the load to query.
+ * \returns a message valid until the handle is freed, or NULL if the load
+ *          didn't fail.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC const char * SDLCALL Mix_GetAsyncLoadError(Mix_AsyncLoad *load);
+
+/**
+ * Free an asynchronous load handle.
+ *
+ * A finished load's chunk or music belongs to the app, and isn't freed. A
+ * load that hasn't started is canceled, and one that is running has its
+ * result freed when it finishes.
+ *
+ * \param load the handle to free.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC void SDLCALL Mix_FreeAsyncLoad(Mix_AsyncLoad *load);
+
+/**
+ * One item of a batch for Mix_LoadWAVBatch().
+ *
+ * Set either `file`, or `src` and `freesrc`; the function fills in `chunk`,
+ * and `error` if it couldn't load the item.
+ *
+ * \since This struct is available since SDL_mixer 3.0.0.
+ */
+typedef struct Mix_ChunkLoad {
+    const char *file;       /**< A file to load, or NULL to load from `src` */
+    SDL_RWops *src;         /**< An SDL_RWops to load from, if `file` is NULL */
+    SDL_bool freesrc;       /**< SDL_TRUE to close/free `src` once loaded */
+    Mix_Chunk *chunk;       /**< The chunk that was loaded, or NULL on error */
+    char error[128];        /**< Why the item failed, or an empty string */
+} Mix_ChunkLoad;
+
+/**
+ * Load many chunks at once, on several threads.
+ *
+ * This loads every item the same way Mix_LoadWAV() or Mix_LoadWAV_RW() would,
+ * but spreads the items over `threads` threads, including the calling one,
+ * and returns when all of them are done. Each item's result depends only on
+ * the item itself, so the output is the same whatever the number of threads.
+ * Each thread loads one item at a time, so at most `threads` items are being
+ * decoded and converted at once; memory use beyond the loaded chunks
+ * themselves doesn't grow with the size of the batch.
+ *
+ * Items that fail don't stop the others; check each item's `chunk` and
+ * `error`. The chunks belong to the app, to free with Mix_FreeChunk().
+ *
+ * \param items the items to load.
+ * \param count the number of items.
+ * \param threads the number of threads to use, or 0 for one per CPU core.
+ * \returns the number of items loaded successfully, or -1 if the arguments
+ *          are invalid.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_LoadWAVAsync
+ */
+extern DECLSPEC int SDLCALL Mix_LoadWAVBatch(Mix_ChunkLoad *items, int count, int threads);
+
+/**
+ * The opaque data type for a sound bank.
+ *
+ * \since This datatype is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_OpenBank
+ */
+typedef struct Mix_Bank Mix_Bank;
+
+/**
+ * Open a sound bank: many sounds packed in one file, ready to play.
+ *
+ * A bank holds any number of sounds, already converted to one PCM format,
+ * each with a unique name, and is made offline by the mixbank tool in the
+ * examples directory. Opening it maps the file into memory, checks its index,
+ * and makes a chunk for every sound, all in one allocation. If the bank is in
+ * the audio device's format, those chunks point straight into the mapping,
+ * so opening a bank of thousands of sounds takes about as long as opening a
+ * single file, and the operating system shares its pages between every
+ * process that plays it. Pages are read from disk as they're first played.
+ *
+ * If the bank was built for another format, every sound is converted when
+ * the bank is opened; this works, but gives up the speed, so build banks for
+ * the format passed to Mix_OpenAudio().
+ *
+ * The chunks belong to the bank: they are valid until Mix_CloseBank(), which
+ * halts any channels playing them. Calling Mix_FreeChunk() on one only halts
+ * the channels playing it. The file must not be changed while it's open.
+ *
+ * Memory mapping is available on Windows and Unix-like platforms; elsewhere
+ * this function fails.
+ *
+ * \param file the filesystem path of the bank.
+ * \returns a new sound bank, or NULL on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_CloseBank
+ * \sa Mix_FindBankChunk
+ * \sa Mix_GetBankChunk
+ */
+extern DECLSPEC Mix_Bank * SDLCALL Mix_OpenBank(const char *file);
+
+/**
+ * Close a sound bank, halting and freeing all its chunks.
+ *
+ * \param bank the bank to close, or NULL.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_OpenBank
+ */
+extern DECLSPEC void SDLCALL Mix_CloseBank(Mix_Bank *bank);
+
+/**
+ * Get the number of sounds in a bank.
+ *
+ * Sounds have IDs from 0 to one less than this, in order of their names.
+ *
+ * \param bank the bank to query.
+ * \returns the number of sounds, or -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_GetNumBankChunks(const Mix_Bank *bank);
+
+/**
+ * Find the ID of a sound in a bank by its name.
+ *
+ * Names are matched exactly, with a binary search; an app that plays sounds
+ * often should look up their IDs once, and use Mix_GetBankChunk() after that.
+ *
+ * \param bank the bank to search.
+ * \param name the name the sound was given when the bank was built.
+ * \returns the sound's ID, or -1 if there's no such sound.
  *
- * Currently, the following types are supported:
+ * \since This function is available since SDL_mixer 3.0.0.
  *
- * - `MUS_NONE` (SDL_mixer should guess, based on the data)
- * - `MUS_WAV` (Microsoft WAV files)
- * - `MUS_MOD` (Various tracker formats)
- * - `MUS_MID` (MIDI files)
- * - `MUS_OGG` (Ogg Vorbis files)
- * - `MUS_MP3` (MP3 files)
- * - `MUS_FLAC` (FLAC files)
- * - `MUS_OPUS` (Opus files)
- * - `MUS_WAVPACK` (WavPack files)
+ * \sa Mix_GetBankChunk
+ */
+extern DECLSPEC int SDLCALL Mix_FindBankChunk(const Mix_Bank *bank, const char *name);
+
+/**
+ * Get the chunk for a sound in a bank.
  *
- * If `freesrc` is SDL_TRUE, the RWops will be closed before returning,
- * whether this function succeeds or not. SDL_mixer reads everything it needs
- * from the RWops during this call in any case.
+ * \param bank the bank the sound is in.
+ * \param id the sound's ID.
+ * \returns the chunk, owned by the bank, or NULL if the ID is invalid.
  *
- * As a convenience, there is a function to read files from disk without
- * having to deal with SDL_RWops: `Mix_LoadMUS("filename.mp3")` will manage
- * those details for you (but not let you specify the music type explicitly)..
+ * \since This function is available since SDL_mixer 3.0.0.
  *
- * When done with this music, the app should dispose of it with a call to
- * Mix_FreeMusic().
+ * \sa Mix_FindBankChunk
+ */
+extern DECLSPEC Mix_Chunk * SDLCALL Mix_GetBankChunk(Mix_Bank *bank, int id);
+
+/**
+ * Get the name of a sound in a bank.
  *
- * \param src an SDL_RWops that data will be read from.
- * \param type the type of audio data provided by `src`.
- * \param freesrc SDL_TRUE to close/free the SDL_RWops before returning,
- *                SDL_FALSE to leave it open.
- * \returns a new music object, or NULL on error.
+ * \param bank the bank the sound is in.
+ * \param id the sound's ID.
+ * \returns the name, valid until the bank is closed, or NULL if the ID is
+ *          invalid.
  *
  * \since This function is available since SDL_mixer 3.0.0.
- *
- * \sa Mix_FreeMusic
  */
-extern DECLSPEC Mix_Music * SDLCALL Mix_LoadMUSType_RW(SDL_RWops *src, Mix_MusicType type, SDL_bool freesrc);
+extern DECLSPEC const char * SDLCALL Mix_GetBankChunkName(const Mix_Bank *bank, int id);
 
 /**
  * Load a WAV file from memory as quickly as possible.
@@ -1031,7 +1828,7 @@ extern DECLSPEC void SDLCALL Mix_SetPostMix(void (SDLCALL *mix_func)(void *udata
  *
  * The data written to by the callback is in the format that the audio device
  * was opened in, and upon return from the callback, SDL_mixer will mix any
- * playing chunks (but not music!) into the buffer. The callback cannot resize
+ * playing music streams and chunks (but not music!) into the buffer. The callback cannot resize
  * the buffer (so you must be prepared to provide exactly the amount of data
  * demanded or leave it as silence).
  *
@@ -1077,6 +1874,30 @@ extern DECLSPEC void SDLCALL Mix_HookMusic(void (SDLCALL *mix_func)(void *udata,
  */
 extern DECLSPEC void SDLCALL Mix_HookMusicFinished(void (SDLCALL *music_finished)(void));
 
+/**
+ * Set a callback that runs when a music stream has stopped playing.
+ *
+ * This callback will fire when the music on a stream has completed, has
+ * finished fading out, or has been explicitly stopped from a call to
+ * Mix_HaltMusicStream(), with the number of the stream. Like the callback
+ * set with Mix_HookMusicFinished(), it might fire from the audio callback,
+ * and it is legal to start new music on the stream from it.
+ *
+ * Do not call SDL_LockAudio() from this callback; you will either be inside
+ * the audio callback, or SDL_mixer will explicitly lock the audio before
+ * calling your callback.
+ *
+ * A NULL pointer will disable the callback.
+ *
+ * \param stream_finished the callback function to become the new
+ *                        notification mechanism.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_PlayMusicStream
+ */
+extern DECLSPEC void SDLCALL Mix_HookMusicStreamFinished(void (SDLCALL *stream_finished)(int stream));
+
 /**
  * Get a pointer to the user data for the current music hook.
  *
@@ -1655,6 +2476,42 @@ extern DECLSPEC int SDLCALL Mix_PlayChannel(int channel, Mix_Chunk *chunk, int l
  */
 extern DECLSPEC int SDLCALL Mix_PlayChannelTimed(int channel, Mix_Chunk *chunk, int loops, int ticks);
 
+/**
+ * Play part of an audio chunk on a specific channel.
+ *
+ * This is Mix_PlayChannelTimed() for the `length` sample frames of `chunk`
+ * that start `offset` frames in, so many short sounds can be packed into one
+ * chunk (an "audio atlas") and played separately, without copying them or
+ * creating a chunk for each. A sample frame is one sample for every channel
+ * the audio device was opened with.
+ *
+ * The region is played and looped on its own: each loop starts over at
+ * `offset`, and nothing outside the region is ever mixed. The chunk stays
+ * in use for as long as the channel plays, and Mix_FreeChunk() halts the
+ * channel as usual.
+ *
+ * Compressed chunks, like those from Mix_LoadCompressedWAV(), can't be
+ * played in part.
+ *
+ * \param channel the channel on which to play the region, or -1 for the
+ *                first free channel.
+ * \param chunk the chunk with the region to play.
+ * \param offset the first sample frame of the region.
+ * \param length the number of sample frames in the region, or -1 for the
+ *               rest of the chunk.
+ * \param loops the number of times the region should loop, -1 to loop (not
+ *              actually) infinitely.
+ * \param ticks the maximum number of milliseconds to play the region, or -1
+ *              for no limit.
+ * \returns which channel was used to play the sound, or -1 if the region is
+ *          outside the chunk or the sound could not be played.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_PlayChannelTimed
+ */
+extern DECLSPEC int SDLCALL Mix_PlayChannelRegion(int channel, Mix_Chunk *chunk, int offset, int length, int loops, int ticks);
+
 /**
  * Play a new music object.
  *
@@ -1744,6 +2601,65 @@ extern DECLSPEC int SDLCALL Mix_FadeInMusic(Mix_Music *music, int loops, int ms)
  */
 extern DECLSPEC int SDLCALL Mix_FadeInMusicPos(Mix_Music *music, int loops, int ms, double position);
 
+/**
+ * Queue a music object to play right after the current music, without a
+ * gap.
+ *
+ * Starting music with Mix_PlayMusic() from the Mix_HookMusicFinished()
+ * callback opens and starts decoding it just as the previous music ends,
+ * which can be heard as a gap. Queued music is started, and its first few
+ * thousand sample frames decoded, by this function, on the calling thread;
+ * when the current music ends, the mixer carries on with the queued music
+ * in the same audio buffer, without a single silent frame.
+ *
+ * Any number of music objects can be queued, and they play in turn. Load
+ * them ahead of time, for example with Mix_LoadMUSAsync(), so opening the
+ * file doesn't stall the app either. If no music is playing, this plays
+ * `music` right away, like Mix_PlayMusic().
+ *
+ * The Mix_HookMusicFinished() callback still runs whenever music ends, after
+ * the queued music has taken over, so Mix_PlayingMusic() is true in it if
+ * anything was queued. Halting the music, or a fade out finishing, clears
+ * the queue. Queued music takes over at the music's volume, without fading
+ * in. Only music that SDL_mixer decodes itself can be queued, which leaves
+ * out native MIDI and Mix_SetMusicCMD().
+ *
+ * \param music the music object to queue.
+ * \param loops the number of times the music should loop, or -1 to loop
+ *              infinitely.
+ * \returns 0 on success, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_ClearMusicQueue
+ * \sa Mix_GetMusicQueueLength
+ */
+extern DECLSPEC int SDLCALL Mix_QueueMusic(Mix_Music *music, int loops);
+
+/**
+ * Get the number of music objects waiting in the music queue.
+ *
+ * This goes down by one each time queued music takes over, so an app can
+ * poll it to keep the queue topped up.
+ *
+ * \returns the number of music objects queued with Mix_QueueMusic() that
+ *          haven't started playing yet.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_GetMusicQueueLength(void);
+
+/**
+ * Remove everything from the music queue.
+ *
+ * The current music keeps playing, and stops when it ends as usual.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_QueueMusic
+ */
+extern DECLSPEC void SDLCALL Mix_ClearMusicQueue(void);
+
 /**
  * Play an audio chunk on a specific channel, fading in the audio.
  *
@@ -1884,6 +2800,36 @@ extern DECLSPEC int SDLCALL Mix_Volume(int channel, int volume);
  */
 extern DECLSPEC int SDLCALL Mix_VolumeChunk(Mix_Chunk *chunk, int volume);
 
+/**
+ * Set the playback rate of the sound playing on a specific channel.
+ *
+ * A rate of 1.0 plays a chunk at normal speed, 2.0 plays it twice as fast
+ * and an octave higher, 0.5 half as fast and an octave lower, and so on, up
+ * to 16.0. The sound is resampled as it is mixed, so this needs no extra
+ * copies of the chunk.
+ *
+ * The rate applies to the current sound only: every time a chunk starts
+ * playing on a channel, that channel's rate goes back to 1.0. To play a sound
+ * at a different rate from the start, call this right after
+ * Mix_PlayChannel() while holding Mix_LockAudio(), or queue both with
+ * Mix_SubmitCommands().
+ *
+ * Chunks loaded with Mix_LoadCompressedWAV_RW() are decoded straight into
+ * the mix, so they always play at 1.0, and setting another rate on a
+ * channel playing one fails.
+ *
+ * If the specified channel is -1, this function sets the rate for all
+ * channels, except those playing compressed chunks.
+ *
+ * \param channel the channel to change, or -1 for all channels.
+ * \param rate the new playback rate, greater than 0.0 and at most 16.0.
+ * \returns 0 on success, -1 on error (an invalid channel or rate, or a
+ *          channel playing a compressed chunk).
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_SetChannelPlaybackRate(int channel, float rate);
+
 /**
  * Set the volume for the music channel.
  *
@@ -2129,6 +3075,237 @@ extern DECLSPEC int SDLCALL Mix_FadeOutMusic(int ms);
  */
 extern DECLSPEC Mix_Fading SDLCALL Mix_FadingMusic(void);
 
+/**
+ * Dynamically change the number of music streams.
+ *
+ * Music streams play Mix_Music objects alongside the music started with
+ * Mix_PlayMusic(), each streaming from its source with a volume, a fade and
+ * a position of its own, so several pieces of music can be layered or cross
+ * faded without decoding any of them into a chunk. Music streams are
+ * numbered from zero, and SDL_mixer allocates two of them when the audio
+ * device is opened.
+ *
+ * If decreasing the number of streams, any upper streams currently playing
+ * are stopped, calling any callback specified by
+ * Mix_HookMusicStreamFinished() for each of them.
+ *
+ * \param numstreams the new number of music streams, or < 0 to query the
+ *                   current count.
+ * \returns the new number of allocated music streams.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_AllocateMusicStreams(int numstreams);
+
+/**
+ * Play a new music object on a music stream.
+ *
+ * Whatever was playing on the stream is halted first, without calling the
+ * callback set with Mix_HookMusicStreamFinished(). A music object can only
+ * play in one place at a time, so this fails if `music` is playing on
+ * another stream or with Mix_PlayMusic(). Only music that SDL_mixer decodes
+ * itself can play on a stream, which leaves out native MIDI and
+ * Mix_SetMusicCMD().
+ *
+ * Music streams are mixed after the music, in the audio callback. They are
+ * paused on their own, with Mix_PauseMusicStream(), rather than by
+ * Mix_PauseMusic(), and keep playing while Mix_HookMusic() replaces the
+ * music. Only one MIDI file can play at a time, so this fails for MIDI music
+ * while other MIDI music is playing or queued, on a music stream or not.
+ *
+ * \param stream the music stream to play on.
+ * \param music the new music object to play.
+ * \param loops the number of times the music should loop, or -1 to loop
+ *              infinitely.
+ * \returns 0 on success, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_FadeInMusicStream
+ * \sa Mix_HaltMusicStream
+ */
+extern DECLSPEC int SDLCALL Mix_PlayMusicStream(int stream, Mix_Music *music, int loops);
+
+/**
+ * Play a new music object on a music stream, fading it in.
+ *
+ * This works like Mix_PlayMusicStream(), but the music starts silent and its
+ * volume rises linearly to the stream's volume over `ms` milliseconds. The
+ * fade is counted in sample frames as the stream is mixed, and applied to
+ * every frame, so it doesn't depend on the size of the audio buffer.
+ *
+ * \param stream the music stream to play on.
+ * \param music the new music object to play.
+ * \param loops the number of times the music should loop, or -1 to loop
+ *              infinitely.
+ * \param ms the number of milliseconds to spend fading in.
+ * \returns 0 on success, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_CrossFadeMusicStreams
+ */
+extern DECLSPEC int SDLCALL Mix_FadeInMusicStream(int stream, Mix_Music *music, int loops, int ms);
+
+/**
+ * Cross fade from one music stream to new music on another.
+ *
+ * This starts `music` fading in on stream `to` and stream `from` fading out,
+ * over the same `ms` milliseconds and starting on the same sample frame. If
+ * nothing is playing on `from`, the music just fades in. To cross fade at an
+ * exact point in the mix, queue MIX_COMMAND_PLAY_MUSIC_STREAM and
+ * MIX_COMMAND_FADE_OUT_MUSIC_STREAM with the same `frame` instead.
+ *
+ * \param from the music stream to fade out.
+ * \param to the music stream to play `music` on.
+ * \param music the new music object to play.
+ * \param loops the number of times the music should loop, or -1 to loop
+ *              infinitely.
+ * \param ms the number of milliseconds the cross fade takes.
+ * \returns 0 on success, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_FadeInMusicStream
+ * \sa Mix_FadeOutMusicStream
+ */
+extern DECLSPEC int SDLCALL Mix_CrossFadeMusicStreams(int from, int to, Mix_Music *music, int loops, int ms);
+
+/**
+ * Halt a music stream after fading it out for a specified time.
+ *
+ * The stream fades from its current level to silence over `ms`
+ * milliseconds, counted in sample frames, and halts on the frame the fade
+ * ends, calling any callback specified by Mix_HookMusicStreamFinished().
+ *
+ * \param stream the music stream to fade out.
+ * \param ms number of milliseconds to fade before halting the stream.
+ * \returns 0 on success (including if nothing was playing on the stream), -1
+ *          if `stream` is out of range.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_FadeOutMusicStream(int stream, int ms);
+
+/**
+ * Halt a music stream.
+ *
+ * This calls any callback specified by Mix_HookMusicStreamFinished() if
+ * something was playing on the stream.
+ *
+ * \param stream the music stream to halt.
+ * \returns 0 on success (including if nothing was playing on the stream), -1
+ *          if `stream` is out of range.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_HaltMusicStream(int stream);
+
+/**
+ * Set the volume of a music stream.
+ *
+ * The stream keeps its volume from one music object to the next; fades go
+ * from and to this volume. The music's own volume, as set with
+ * Mix_VolumeMusic(), doesn't apply to music streams.
+ *
+ * \param stream the music stream to change.
+ * \param volume the new volume, between 0 and MIX_MAX_VOLUME, or -1 to
+ *               query.
+ * \returns the previous volume, or -1 if `stream` is out of range.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_VolumeMusicStream(int stream, int volume);
+
+/**
+ * Pause a music stream.
+ *
+ * The stream keeps its position and fade, and continues from there when
+ * resumed. Pausing the music with Mix_PauseMusic() doesn't pause music
+ * streams, and this doesn't pause the music. Playing new music on the stream
+ * unpauses it.
+ *
+ * \param stream the music stream to pause, or -1 for all of them.
+ * \returns 0 on success, -1 if `stream` is out of range.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_ResumeMusicStream
+ */
+extern DECLSPEC int SDLCALL Mix_PauseMusicStream(int stream);
+
+/**
+ * Resume a paused music stream.
+ *
+ * It is legal to resume a stream that isn't paused; it causes no effect.
+ *
+ * \param stream the music stream to resume, or -1 for all of them.
+ * \returns 0 on success, -1 if `stream` is out of range.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_PauseMusicStream
+ */
+extern DECLSPEC int SDLCALL Mix_ResumeMusicStream(int stream);
+
+/**
+ * Query whether a music stream is paused.
+ *
+ * \param stream the music stream to query, or -1 for all of them.
+ * \returns 1 if music is playing on the stream and paused, 0 otherwise. If
+ *          `stream` is -1, return the number of paused music streams.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_PausedMusicStream(int stream);
+
+/**
+ * Check the playing status of a music stream.
+ *
+ * \param stream the music stream to query, or -1 for all of them.
+ * \returns non-zero if the stream is playing, zero otherwise. If `stream` is
+ *          -1, return the number of music streams playing.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_PlayingMusicStream(int stream);
+
+/**
+ * Query the fading status of a music stream.
+ *
+ * \param stream the music stream to query.
+ * \returns the current fading status of the stream.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_Fading SDLCALL Mix_FadingMusicStream(int stream);
+
+/**
+ * Get the music object playing on a music stream.
+ *
+ * The object can be passed to Mix_GetMusicPosition(), Mix_GetMusicVolume()
+ * and the tag functions to query the stream.
+ *
+ * \param stream the music stream to query.
+ * \returns the music object playing on the stream, or NULL if there is none.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC Mix_Music * SDLCALL Mix_GetMusicStreamMusic(int stream);
+
+/**
+ * Set the current position in a music stream, in seconds.
+ *
+ * This works like Mix_SetMusicPosition(), for the music on a music stream.
+ *
+ * \param stream the music stream to seek.
+ * \param position the new position, in seconds (as a double).
+ * \returns 0 on success, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_SetMusicStreamPosition(int stream, double position);
+
 /**
  * Query the fading status of a channel.
  *
@@ -2640,6 +3817,222 @@ extern DECLSPEC const char* SDLCALL Mix_GetTimidityCfg(void);
  */
 extern DECLSPEC Mix_Chunk * SDLCALL Mix_GetChunk(int channel);
 
+/**
+ * The kinds of command that can be queued with Mix_SubmitCommands().
+ *
+ * Each one does the same thing as the function it names, using the fields
+ * of Mix_Command listed next to it, and its result is that function's return
+ * value (0 for functions that don't return anything).
+ *
+ * \since This enum is available since SDL_mixer 3.0.0.
+ */
+typedef enum {
+    MIX_COMMAND_PLAY_CHANNEL,       /**< Mix_FadeInChannelTimed(): channel, chunk, loops, ms, ticks */
+    MIX_COMMAND_HALT_CHANNEL,       /**< Mix_HaltChannel(): channel */
+    MIX_COMMAND_EXPIRE_CHANNEL,     /**< Mix_ExpireChannel(): channel, ticks */
+    MIX_COMMAND_FADE_OUT_CHANNEL,   /**< Mix_FadeOutChannel(): channel, ms */
+    MIX_COMMAND_PAUSE_CHANNEL,      /**< Mix_Pause(): channel */
+    MIX_COMMAND_RESUME_CHANNEL,     /**< Mix_Resume(): channel */
+    MIX_COMMAND_VOLUME_CHANNEL,     /**< Mix_Volume(): channel, volume */
+    MIX_COMMAND_PLAYBACK_RATE_CHANNEL, /**< Mix_SetChannelPlaybackRate(): channel, rate */
+    MIX_COMMAND_VOLUME_MUSIC,       /**< Mix_VolumeMusic(): volume */
+    MIX_COMMAND_PAUSE_MUSIC,        /**< Mix_PauseMusic() */
+    MIX_COMMAND_RESUME_MUSIC,       /**< Mix_ResumeMusic() */
+    MIX_COMMAND_HALT_MUSIC,         /**< Mix_HaltMusic() */
+    MIX_COMMAND_FADE_OUT_MUSIC,     /**< Mix_FadeOutMusic(): ms */
+    MIX_COMMAND_PLAY_MUSIC_STREAM,  /**< Mix_FadeInMusicStream(): channel as the stream, music, loops, ms */
+    MIX_COMMAND_FADE_OUT_MUSIC_STREAM, /**< Mix_FadeOutMusicStream(): channel as the stream, ms */
+    MIX_COMMAND_HALT_MUSIC_STREAM,  /**< Mix_HaltMusicStream(): channel as the stream */
+    MIX_COMMAND_VOLUME_MUSIC_STREAM /**< Mix_VolumeMusicStream(): channel as the stream, volume */
+} Mix_CommandType;
+
+/**
+ * A command for Mix_SubmitCommands().
+ *
+ * Fields a command type doesn't use are ignored. For
+ * MIX_COMMAND_PLAY_CHANNEL, an `ms` of zero or less plays the chunk without
+ * fading in, and a `ticks` of -1 plays it without a time limit.
+ *
+ * A `frame` of zero runs the command at the start of the next buffer that's
+ * mixed. Otherwise the command waits until the mix reaches that frame, as
+ * counted by Mix_GetMixedFrames(), and runs exactly there, splitting the
+ * buffer being mixed if need be; a frame that has already passed runs at
+ * the start of the next buffer. Up to 256 commands can wait for their
+ * frame at once; any more are dropped, setting an error and reporting -1
+ * to the Mix_SubmitCommands() callback.
+ *
+ * \since This struct is available since SDL_mixer 3.0.0.
+ */
+typedef struct Mix_Command {
+    Mix_CommandType type;
+    int channel;
+    Mix_Chunk *chunk;
+    int loops;
+    int ms;
+    int ticks;
+    int volume;
+    float rate;
+    Uint64 frame;
+    Mix_Music *music;
+} Mix_Command;
+
+/**
+ * This is the format of a callback that reports the results of commands
+ * queued with Mix_SubmitCommands().
+ *
+ * It is called once for every command in the batch, in order, right after
+ * the command runs. `index` is the position of the command in the array
+ * that was submitted, and `result` is what the equivalent function returned;
+ * for MIX_COMMAND_PLAY_CHANNEL that is the channel that was picked, or -1.
+ *
+ * This runs from the audio callback (or from Mix_FreeChunk() or
+ * Mix_CloseAudio(), which run any commands still waiting). Keep it short,
+ * and DO NOT EVER call SDL_LockAudio() from it!
+ */
+typedef void (SDLCALL *Mix_CommandDone_t)(void *udata, int index, int result);
+
+/**
+ * Queue a batch of channel and music commands for the audio callback.
+ *
+ * Unlike Mix_PlayChannel(), Mix_HaltChannel(), etc, this does not lock the
+ * audio device, so game threads never wait on the mixer: the commands go
+ * into a lock-free queue that the audio callback empties at the start of
+ * each buffer it mixes. Any number of threads may submit at once.
+ *
+ * All the commands in a batch run in the same audio callback, in order,
+ * after any batch submitted earlier. The results arrive asynchronously,
+ * through `callback`. The one exception is when the music is decoded ahead
+ * (see SDL_MIXER_HINT_MUSIC_DECODE_AHEAD): a command that pauses, resumes,
+ * halts or fades out the music waits for a later buffer if the decoding
+ * thread is busy, and the music and music stream commands after it wait
+ * with it, so they still run in order.
+ *
+ * The queue holds a fixed number of commands; if there isn't room for the
+ * whole batch, nothing is queued and this function fails, and the app can
+ * try again later. The same goes for a batch that plays a compressed chunk
+ * (see Mix_LoadCompressedWAV_RW()), since starting its decoder isn't safe
+ * in the audio callback. Chunks named by queued commands must stay loaded
+ * until the commands have run; Mix_FreeChunk() runs anything still waiting
+ * before it frees the chunk. Music objects named by queued commands must stay
+ * loaded until the commands have run too, and starting one on a music
+ * stream opens it from the audio callback.
+ *
+ * The existing functions keep working and may be mixed freely with queued
+ * commands.
+ *
+ * Mix_CloseAudio() runs whatever was queued before it started closing the
+ * device; commands that arrive while it closes report -1 instead, so every
+ * command queued gets its result.
+ *
+ * \param commands an array of commands to run.
+ * \param count the number of commands in the array.
+ * \param callback the function to call with each command's result, or NULL.
+ * \param udata an opaque pointer passed to `callback`.
+ * \returns 0 if the commands were queued, -1 on error (for example, if the
+ *          queue is full). Call Mix_GetError() for more information.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ */
+extern DECLSPEC int SDLCALL Mix_SubmitCommands(const Mix_Command *commands, int count, Mix_CommandDone_t callback, void *udata);
+
+/**
+ * Get the number of sample frames mixed since the audio device was opened.
+ *
+ * This is the clock for the `frame` of a Mix_Command: a command for frame
+ * `Mix_GetMixedFrames() + n` starts `n` frames into the mix from now. Since
+ * the mix is played continuously, that's also a fixed point in the output,
+ * however the mixing itself is scheduled.
+ *
+ * The mix runs ahead of what's being heard, by the audio device's buffer and
+ * with SDL_MIXER_HINT_MIX_AHEAD by the lookahead too, so a command that needs
+ * to line up with sound already playing should be timed against the frame
+ * that sound was started at, rather than against the current count.
+ *
+ * \returns the number of frames mixed so far, or 0 if the audio device isn't
+ *          open.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_SubmitCommands
+ */
+extern DECLSPEC Uint64 SDLCALL Mix_GetMixedFrames(void);
+
+/**
+ * The number of buckets in Mix_PerfStats::callback_histogram.
+ *
+ * \since This macro is available since SDL_mixer 3.0.0.
+ */
+#define MIX_PERF_HISTOGRAM_BUCKETS  16
+
+/**
+ * Mixer performance counters, as reported by Mix_GetPerfStats().
+ *
+ * Times are in nanoseconds and accumulate from when the counters were
+ * enabled or last reset; one "callback" is one pass of the mixer, whether
+ * for the audio device or for Mix_RenderAudio().
+ *
+ * \since This struct is available since SDL_mixer 3.0.0.
+ */
+typedef struct Mix_PerfStats {
+    Uint64 callbacks;           /**< Number of callbacks measured */
+    Uint64 bytes_mixed;         /**< Bytes of audio mixed, in the mixer's format */
+    Uint64 callback_ns_min;     /**< Shortest callback */
+    Uint64 callback_ns_max;     /**< Longest callback */
+    Uint64 callback_ns_total;   /**< All callbacks; divide by `callbacks` for the average */
+    Uint64 callback_histogram[MIX_PERF_HISTOGRAM_BUCKETS]; /**< Bucket n counts callbacks that took 2^n to 2^(n+1) microseconds; the first also counts anything shorter, the last anything longer */
+    Uint64 music_ns;            /**< Decoding and mixing music, including Mix_HookMusic() */
+    Uint64 channel_effects_ns;  /**< Running effects registered on channels */
+    Uint64 postmix_ns;          /**< Running posteffects and the Mix_SetPostMix() callback */
+    Uint64 deadline_misses;     /**< Callbacks that took longer than the audio they produced lasts */
+    int active_voices;          /**< Channels playing during the last callback */
+    int max_active_voices;      /**< Most channels playing in any one callback */
+} Mix_PerfStats;
+
+/**
+ * Turn the mixer performance counters on or off.
+ *
+ * The counters are off by default, and then cost next to nothing. While on,
+ * the mixer reads a high resolution timer a few times per callback.
+ * Turning them off keeps the values collected so far.
+ *
+ * This may be called from any thread at any time.
+ *
+ * \param enable SDL_TRUE to collect counters, SDL_FALSE to stop.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_GetPerfStats
+ */
+extern DECLSPEC void SDLCALL Mix_EnablePerfStats(SDL_bool enable);
+
+/**
+ * Get a consistent copy of the mixer performance counters.
+ *
+ * This doesn't lock the audio device; it may be called from any thread,
+ * while the mixer is running.
+ *
+ * \param stats filled in with the current counters.
+ * \returns 0 on success, -1 on error.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_EnablePerfStats
+ * \sa Mix_ResetPerfStats
+ */
+extern DECLSPEC int SDLCALL Mix_GetPerfStats(Mix_PerfStats *stats);
+
+/**
+ * Set the mixer performance counters back to zero.
+ *
+ * This may be called from any thread; the counters are cleared before the
+ * next callback is recorded.
+ *
+ * \since This function is available since SDL_mixer 3.0.0.
+ *
+ * \sa Mix_GetPerfStats
+ */
+extern DECLSPEC void SDLCALL Mix_ResetPerfStats(void);
+
 /**
  * Close the mixer, halting all playing audio.
  *
@@ -0,0 +1,539 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+/* Asynchronous and batch chunk and music loading.
+ *
+ * Requests wait on a queue in priority order, and a few loader threads
+ * take them off the front and run the ordinary loading functions. One lock
+ * protects the queue and the state of every request; the loading itself
+ * runs without it.
+ *
+ * Batches don't use the queue: Mix_LoadWAVBatch() starts threads of its own,
+ * which take items in order off a shared counter until there are none left.
+ */
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "async_load.h"
+
+/* Most loader threads, see SDL_MIXER_HINT_LOAD_THREADS */
+#define MAX_LOAD_THREADS    16
+
+/* Most threads for one Mix_LoadWAVBatch(), including the caller's */
+#define MAX_BATCH_THREADS   64
+
+struct Mix_AsyncLoad
+{
+    SDL_bool is_music;
+    char *file;                 /* load from this, or from 'src' */
+    SDL_RWops *src;
+    SDL_bool freesrc;
+    int priority;
+    Mix_AsyncLoadDone_t callback;
+    void *udata;
+
+    Mix_AsyncLoadStatus status;
+    Mix_Chunk *chunk;
+    Mix_Music *music;
+    char *error;
+    SDL_bool in_callback;       /* the callback may still be using it */
+    SDL_bool released;          /* the app is done with the handle */
+    struct Mix_AsyncLoad *next;
+};
+
+static SDL_Mutex *load_lock = NULL;
+static SDL_Condition *load_queued = NULL;
+static SDL_Condition *load_finished = NULL;
+static Mix_AsyncLoad *load_queue = NULL;
+static SDL_Thread *load_threads[MAX_LOAD_THREADS];
+static int num_load_threads = 0;
+static SDL_bool load_quit = SDL_FALSE;
+
+typedef struct
+{
+    Mix_ChunkLoad *items;
+    int count;
+    SDL_AtomicInt next;
+    SDL_AtomicInt loaded;
+} BatchLoad;
+
+
+static void free_request(Mix_AsyncLoad *load)
+{
+    if (load->src && load->freesrc) {
+        SDL_RWclose(load->src);
+    }
+    SDL_free(load->file);
+    SDL_free(load->error);
+    SDL_free(load);
+}
+
+/* The app let go of the handle, so nobody will ever pick up the result */
+static void free_unclaimed(Mix_AsyncLoad *load)
+{
+    if (load->chunk) {
+        Mix_FreeChunk(load->chunk);
+    }
+    if (load->music) {
+        Mix_FreeMusic(load->music);
+    }
+    free_request(load);
+}
+
+static void run_request(Mix_AsyncLoad *load)
+{
+    SDL_RWops *src = load->src;
+
+    /* The loaders take care of the source */
+    load->src = NULL;
+    if (load->is_music) {
+        if (load->file) {
+            load->music = Mix_LoadMUS(load->file);
+        } else {
+            load->music = Mix_LoadMUS_RW(src, load->freesrc);
+        }
+    } else {
+        if (load->file) {
+            load->chunk = Mix_LoadWAV(load->file);
+        } else {
+            load->chunk = Mix_LoadWAV_RW(src, load->freesrc);
+        }
+    }
+    if (!load->chunk && !load->music) {
+        load->error = SDL_strdup(Mix_GetError());
+    }
+}
+
+static int SDLCALL load_thread(void *data)
+{
+    Mix_AsyncLoad *load;
+
+    (void)data;
+
+    SDL_LockMutex(load_lock);
+    while (!load_quit) {
+        load = load_queue;
+        if (!load) {
+            SDL_WaitCondition(load_queued, load_lock);
+            continue;
+        }
+        load_queue = load->next;
+        load->next = NULL;
+        load->status = MIX_ASYNC_LOAD_RUNNING;
+        SDL_UnlockMutex(load_lock);
+
+        run_request(load);
+
+        SDL_LockMutex(load_lock);
+        load->status = (load->chunk || load->music) ? MIX_ASYNC_LOAD_DONE : MIX_ASYNC_LOAD_FAILED;
+        SDL_BroadcastCondition(load_finished);
+        if (load->released) {
+            free_unclaimed(load);
+            continue;
+        }
+        if (load->callback) {
+            load->in_callback = SDL_TRUE;
+            SDL_UnlockMutex(load_lock);
+            load->callback(load->udata, load);
+            SDL_LockMutex(load_lock);
+            load->in_callback = SDL_FALSE;
+            if (load->released) {
+                free_request(load);
+            }
+        }
+    }
+    SDL_UnlockMutex(load_lock);
+    return 0;
+}
+
+/* MAKE SURE you hold load_lock before calling this! */
+static int start_load_threads(void)
+{
+    const char *hint;
+    int count = 1;
+
+    hint = SDL_GetHint(SDL_MIXER_HINT_LOAD_THREADS);
+    if (hint && *hint) {
+        count = SDL_atoi(hint);
+        if (count <= 0) {
+            count = SDL_GetCPUCount();
+        }
+    }
+    count = SDL_clamp(count, 1, MAX_LOAD_THREADS);
+
+    while (num_load_threads < count) {
+        SDL_Thread *thread = SDL_CreateThread(load_thread, "SDL_mixer loader", NULL);
+        if (!thread) {
+            break;
+        }
+        load_threads[num_load_threads++] = thread;
+    }
+    return (num_load_threads > 0) ? 0 : -1;
+}
+
+static Mix_AsyncLoad *queue_request(SDL_bool is_music, const char *file, SDL_RWops *src, SDL_bool freesrc,
+                                    int priority, Mix_AsyncLoadDone_t callback, void *udata)
+{
+    Mix_AsyncLoad *load, **prev;
+
+    if (!file && !src) {
+        Mix_SetError("Nothing to load");
+        return NULL;
+    }
+    if (!load_lock) {
+        Mix_SetError("Audio device hasn't been opened");
+        if (src && freesrc) {
+            SDL_RWclose(src);
+        }
+        return NULL;
+    }
+
+    load = (Mix_AsyncLoad *)SDL_calloc(1, sizeof(*load));
+    if (!load) {
+        Mix_OutOfMemory();
+        if (src && freesrc) {
+            SDL_RWclose(src);
+        }
+        return NULL;
+    }
+    load->is_music = is_music;
+    load->src = src;
+    load->freesrc = freesrc;
+    load->priority = priority;
+    load->callback = callback;
+    load->udata = udata;
+    load->status = MIX_ASYNC_LOAD_PENDING;
+    if (file) {
+        load->file = SDL_strdup(file);
+        if (!load->file) {
+            free_request(load);
+            Mix_OutOfMemory();
+            return NULL;
+        }
+    }
+
+    SDL_LockMutex(load_lock);
+    if (start_load_threads() < 0) {
+        SDL_UnlockMutex(load_lock);
+        free_request(load);
+        return NULL;
+    }
+    /* After everything of the same or a higher priority */
+    for (prev = &load_queue; *prev && (*prev)->priority >= priority; prev = &(*prev)->next) {
+    }
+    load->next = *prev;
+    *prev = load;
+    SDL_SignalCondition(load_queued);
+    SDL_UnlockMutex(load_lock);
+
+    return load;
+}
+
+/* MAKE SURE you hold load_lock before calling this! */
+static SDL_bool dequeue_request(Mix_AsyncLoad *load)
+{
+    Mix_AsyncLoad **prev;
+
+    for (prev = &load_queue; *prev; prev = &(*prev)->next) {
+        if (*prev == load) {
+            *prev = load->next;
+            load->next = NULL;
+            return SDL_TRUE;
+        }
+    }
+    return SDL_FALSE;
+}
+
+int _Mix_InitAsyncLoad(void)
+{
+    load_lock = SDL_CreateMutex();
+    load_queued = SDL_CreateCondition();
+    load_finished = SDL_CreateCondition();
+    if (!load_lock || !load_queued || !load_finished) {
+        _Mix_QuitAsyncLoad();
+        return -1;
+    }
+    load_quit = SDL_FALSE;
+    return 0;
+}
+
+void _Mix_QuitAsyncLoad(void)
+{
+    Mix_AsyncLoad *load;
+    int i;
+
+    if (load_lock) {
+        SDL_LockMutex(load_lock);
+        while (load_queue) {
+            load = load_queue;
+            load_queue = load->next;
+            load->next = NULL;
+            load->status = MIX_ASYNC_LOAD_CANCELED;
+            if (load->src && load->freesrc) {
+                SDL_RWclose(load->src);
+            }
+            load->src = NULL;
+        }
+        load_quit = SDL_TRUE;
+        SDL_BroadcastCondition(load_queued);
+        SDL_BroadcastCondition(load_finished);
+        SDL_UnlockMutex(load_lock);
+    }
+
+    for (i = 0; i < num_load_threads; ++i) {
+        SDL_WaitThread(load_threads[i], NULL);
+    }
+    num_load_threads = 0;
+
+    /* Every request left is finished, so the handles work without the lock */
+    if (load_finished) {
+        SDL_DestroyCondition(load_finished);
+        load_finished = NULL;
+    }
+    if (load_queued) {
+        SDL_DestroyCondition(load_queued);
+        load_queued = NULL;
+    }
+    if (load_lock) {
+        SDL_DestroyMutex(load_lock);
+        load_lock = NULL;
+    }
+}
+
+Mix_AsyncLoad *Mix_LoadWAVAsync(const char *file, int priority, Mix_AsyncLoadDone_t callback, void *udata)
+{
+    return queue_request(SDL_FALSE, file, NULL, SDL_FALSE, priority, callback, udata);
+}
+
+Mix_AsyncLoad *Mix_LoadWAVAsync_RW(SDL_RWops *src, SDL_bool freesrc, int priority, Mix_AsyncLoadDone_t callback, void *udata)
+{
+    return queue_request(SDL_FALSE, NULL, src, freesrc, priority, callback, udata);
+}
+
+Mix_AsyncLoad *Mix_LoadMUSAsync(const char *file, int priority, Mix_AsyncLoadDone_t callback, void *udata)
+{
+    return queue_request(SDL_TRUE, file, NULL, SDL_FALSE, priority, callback, udata);
+}
+
+Mix_AsyncLoad *Mix_LoadMUSAsync_RW(SDL_RWops *src, SDL_bool freesrc, int priority, Mix_AsyncLoadDone_t callback, void *udata)
+{
+    return queue_request(SDL_TRUE, NULL, src, freesrc, priority, callback, udata);
+}
+
+Mix_AsyncLoadStatus Mix_GetAsyncLoadStatus(Mix_AsyncLoad *load)
+{
+    Mix_AsyncLoadStatus status;
+
+    if (!load) {
+        return MIX_ASYNC_LOAD_FAILED;
+    }
+    SDL_LockMutex(load_lock);
+    status = load->status;
+    SDL_UnlockMutex(load_lock);
+    return status;
+}
+
+Mix_AsyncLoadStatus Mix_WaitAsyncLoad(Mix_AsyncLoad *load)
+{
+    Mix_AsyncLoadStatus status;
+
+    if (!load) {
+        return MIX_ASYNC_LOAD_FAILED;
+    }
+    SDL_LockMutex(load_lock);
+    while (load->status == MIX_ASYNC_LOAD_PENDING || load->status == MIX_ASYNC_LOAD_RUNNING) {
+        SDL_WaitCondition(load_finished, load_lock);
+    }
+    status = load->status;
+    SDL_UnlockMutex(load_lock);
+    return status;
+}
+
+int Mix_CancelAsyncLoad(Mix_AsyncLoad *load)
+{
+    int result = -1;
+
+    if (!load) {
+        return Mix_SetError("Tried to cancel a NULL load");
+    }
+    SDL_LockMutex(load_lock);
+    if (load->status == MIX_ASYNC_LOAD_PENDING && dequeue_request(load)) {
+        load->status = MIX_ASYNC_LOAD_CANCELED;
+        if (load->src && load->freesrc) {
+            SDL_RWclose(load->src);
+        }
+        load->src = NULL;
+        SDL_BroadcastCondition(load_finished);
+        result = 0;
+    } else if (load->status == MIX_ASYNC_LOAD_CANCELED) {
+        result = 0;
+    } else {
+        Mix_SetError("The load has already started");
+    }
+    SDL_UnlockMutex(load_lock);
+    return result;
+}
+
+Mix_Chunk *Mix_GetAsyncLoadChunk(Mix_AsyncLoad *load)
+{
+    Mix_Chunk *chunk = NULL;
+
+    if (load) {
+        SDL_LockMutex(load_lock);
+        if (load->status == MIX_ASYNC_LOAD_DONE) {
+            chunk = load->chunk;
+        }
+        SDL_UnlockMutex(load_lock);
+    }
+    return chunk;
+}
+
+Mix_Music *Mix_GetAsyncLoadMusic(Mix_AsyncLoad *load)
+{
+    Mix_Music *music = NULL;
+
+    if (load) {
+        SDL_LockMutex(load_lock);
+        if (load->status == MIX_ASYNC_LOAD_DONE) {
+            music = load->music;
+        }
+        SDL_UnlockMutex(load_lock);
+    }
+    return music;
+}
+
+const char *Mix_GetAsyncLoadError(Mix_AsyncLoad *load)
+{
+    const char *error = NULL;
+
+    if (load) {
+        SDL_LockMutex(load_lock);
+        if (load->status == MIX_ASYNC_LOAD_FAILED) {
+            error = load->error ? load->error : "Out of memory";
+        } else if (load->status == MIX_ASYNC_LOAD_CANCELED) {
+            error = "Canceled";
+        }
+        SDL_UnlockMutex(load_lock);
+    }
+    return error;
+}
+
+void Mix_FreeAsyncLoad(Mix_AsyncLoad *load)
+{
+    if (!load) {
+        return;
+    }
+    SDL_LockMutex(load_lock);
+    if (load->status == MIX_ASYNC_LOAD_PENDING) {
+        dequeue_request(load);
+        load->status = MIX_ASYNC_LOAD_CANCELED;
+    }
+    if (load->status == MIX_ASYNC_LOAD_RUNNING || load->in_callback) {
+        /* The loader thread frees it when it's done with it */
+        load->released = SDL_TRUE;
+    } else {
+        /* A finished load's chunk or music belongs to the app */
+        free_request(load);
+    }
+    SDL_UnlockMutex(load_lock);
+}
+
+static void run_batch(BatchLoad *batch)
+{
+    Mix_ChunkLoad *item;
+    int i;
+
+    for (;;) {
+        i = SDL_AtomicAdd(&batch->next, 1);
+        if (i >= batch->count) {
+            break;
+        }
+        item = &batch->items[i];
+        if (item->file) {
+            item->chunk = Mix_LoadWAV(item->file);
+        } else if (item->src) {
+            item->chunk = Mix_LoadWAV_RW(item->src, item->freesrc);
+        } else {
+            item->chunk = NULL;
+            Mix_SetError("Nothing to load");
+        }
+        if (item->chunk) {
+            item->error[0] = '\0';
+            SDL_AtomicAdd(&batch->loaded, 1);
+        } else {
+            SDL_strlcpy(item->error, Mix_GetError(), sizeof(item->error));
+        }
+    }
+}
+
+static int SDLCALL batch_thread(void *data)
+{
+    run_batch((BatchLoad *)data);
+    return 0;
+}
+
+int Mix_LoadWAVBatch(Mix_ChunkLoad *items, int count, int threads)
+{
+    BatchLoad batch;
+    SDL_Thread **workers = NULL;
+    int i, num_workers = 0;
+
+    if (count < 0 || (!items && count > 0)) {
+        return Mix_SetError("Invalid batch");
+    }
+
+    batch.items = items;
+    batch.count = count;
+    SDL_AtomicSet(&batch.next, 0);
+    SDL_AtomicSet(&batch.loaded, 0);
+
+    if (threads <= 0) {
+        threads = SDL_GetCPUCount();
+    }
+    threads = SDL_min(SDL_min(threads, count), MAX_BATCH_THREADS);
+
+    /* This thread does its share, so start one fewer */
+    if (threads > 1) {
+        workers = (SDL_Thread **)SDL_malloc((threads - 1) * sizeof(*workers));
+        if (workers) {
+            for (i = 0; i < threads - 1; ++i) {
+                workers[num_workers] = SDL_CreateThread(batch_thread, "SDL_mixer batch", &batch);
+                if (!workers[num_workers]) {
+                    break;
+                }
+                ++num_workers;
+            }
+        }
+    }
+
+    run_batch(&batch);
+
+    for (i = 0; i < num_workers; ++i) {
+        SDL_WaitThread(workers[i], NULL);
+    }
+    SDL_free(workers);
+
+    return SDL_AtomicGet(&batch.loaded);
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,38 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef ASYNC_LOAD_H_
+#define ASYNC_LOAD_H_
+
+/* Background loading for Mix_LoadWAVAsync() and friends.
+ *
+ * The loader threads start with the first request, and are stopped by
+ * _Mix_QuitAsyncLoad(), which cancels everything still waiting and lets
+ * the loads in progress finish first.
+ */
+
+extern int _Mix_InitAsyncLoad(void);
+extern void _Mix_QuitAsyncLoad(void);
+
+#endif /* ASYNC_LOAD_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,595 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+/* Channel allocation and group bookkeeping.
+ *
+ * Free channels are kept in a two-level bitmap: one bit per channel, and a
+ * summary with one bit per non-empty word, so finding the lowest free
+ * channel touches a handful of words even with thousands of channels.
+ * Every tag gets the same kind of bitmap for its free members, plus a list
+ * of its busy members in start order, which answers Mix_GroupOldest() and
+ * Mix_GroupNewer() from the ends of the list.
+ *
+ * Busy channels are also packed into a dense array, so the mixer only
+ * visits the voices that are actually sounding instead of every allocated
+ * channel.
+ */
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "channel_index.h"
+
+typedef struct
+{
+    Uint32 *bits;       /* one bit per channel */
+    Uint32 *summary;    /* one bit per non-empty word of 'bits' */
+} ChannelSet;
+
+typedef struct
+{
+    int tag;
+    int members;
+    int oldest;         /* busy members, in start order */
+    int newest;
+    ChannelSet free;
+} ChannelGroup;
+
+typedef struct
+{
+    int tag;
+    ChannelGroup *group;    /* NULL if the channel is untagged */
+    SDL_bool busy;
+    int active_slot;        /* position in active[] while busy */
+    Uint64 serial;          /* start order, to merge into a group's list */
+    int older;              /* all busy channels, in start order */
+    int newer;
+    int group_older;        /* busy channels of the same group, in start order */
+    int group_newer;
+} ChannelEntry;
+
+static ChannelEntry *entries = NULL;
+static int num_entries = 0;
+static int max_entries = 0;     /* room in the arrays and sets, which only grow */
+static int set_words = 0;
+static int summary_words = 0;
+static ChannelSet free_channels = { NULL, NULL };
+static int oldest_busy = -1;
+static int newest_busy = -1;
+static Uint64 start_serial = 0;
+
+/* Busy channels, densely packed in no particular order */
+static int *active = NULL;
+static int num_active = 0;
+static int *active_snapshot = NULL;
+
+/* Sorted by tag, so lookups are a binary search */
+static ChannelGroup **groups = NULL;
+static int num_groups = 0;
+
+
+static int lowest_bit(Uint32 x)
+{
+    return SDL_MostSignificantBitIndex32(x & (~x + 1));
+}
+
+static void set_insert(ChannelSet *set, int channel)
+{
+    int word = channel >> 5;
+
+    set->bits[word] |= (1u << (channel & 31));
+    set->summary[word >> 5] |= (1u << (word & 31));
+}
+
+static void set_remove(ChannelSet *set, int channel)
+{
+    int word = channel >> 5;
+
+    set->bits[word] &= ~(1u << (channel & 31));
+    if (!set->bits[word]) {
+        set->summary[word >> 5] &= ~(1u << (word & 31));
+    }
+}
+
+/* Find the lowest channel in the set that is >= 'from', or -1 */
+static int set_first(const ChannelSet *set, int from)
+{
+    int word, sword;
+    Uint32 bits;
+
+    if (from < 0) {
+        from = 0;
+    }
+    if (from >= num_entries) {
+        return -1;
+    }
+
+    word = from >> 5;
+    bits = set->bits[word] & (~0u << (from & 31));
+    if (bits) {
+        return (word << 5) + lowest_bit(bits);
+    }
+
+    ++word;
+    sword = word >> 5;
+    if (sword >= summary_words) {
+        return -1;
+    }
+    bits = set->summary[sword] & (~0u << (word & 31));
+    for (;;) {
+        if (bits) {
+            word = (sword << 5) + lowest_bit(bits);
+            return (word << 5) + lowest_bit(set->bits[word]);
+        }
+        if (++sword >= summary_words) {
+            return -1;
+        }
+        bits = set->summary[sword];
+    }
+}
+
+/* Grow a set from 'old_words' and 'old_summary_words' to 'words' and
+   'new_summary_words', clearing the new words. On failure the set still
+   holds its old contents, maybe with more room than it needs. */
+static int set_resize(ChannelSet *set, int words, int new_summary_words, int old_words, int old_summary_words)
+{
+    Uint32 *bits, *summary;
+
+    bits = (Uint32 *)SDL_realloc(set->bits, (size_t)SDL_max(words, 1) * sizeof(Uint32));
+    if (!bits) {
+        return Mix_OutOfMemory();
+    }
+    set->bits = bits;
+    summary = (Uint32 *)SDL_realloc(set->summary, (size_t)SDL_max(new_summary_words, 1) * sizeof(Uint32));
+    if (!summary) {
+        return Mix_OutOfMemory();
+    }
+    set->summary = summary;
+
+    if (words > old_words) {
+        SDL_memset(&set->bits[old_words], 0, (size_t)(words - old_words) * sizeof(Uint32));
+    }
+    if (new_summary_words > old_summary_words) {
+        SDL_memset(&set->summary[old_summary_words], 0, (size_t)(new_summary_words - old_summary_words) * sizeof(Uint32));
+    }
+    return 0;
+}
+
+static void set_free(ChannelSet *set)
+{
+    SDL_free(set->bits);
+    SDL_free(set->summary);
+    set->bits = NULL;
+    set->summary = NULL;
+}
+
+static int find_group_slot(int tag, SDL_bool *found)
+{
+    int lo = 0, hi = num_groups;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (groups[mid]->tag < tag) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = (lo < num_groups && groups[lo]->tag == tag);
+    return lo;
+}
+
+static ChannelGroup *find_group(int tag)
+{
+    SDL_bool found;
+    int slot = find_group_slot(tag, &found);
+    return found ? groups[slot] : NULL;
+}
+
+static ChannelGroup *create_group(int tag)
+{
+    SDL_bool found;
+    int slot = find_group_slot(tag, &found);
+    ChannelGroup *group;
+    void *ptr;
+
+    if (found) {
+        return groups[slot];
+    }
+
+    ptr = SDL_realloc(groups, (size_t)(num_groups + 1) * sizeof(*groups));
+    if (!ptr) {
+        Mix_OutOfMemory();
+        return NULL;
+    }
+    groups = (ChannelGroup **)ptr;
+
+    group = (ChannelGroup *)SDL_calloc(1, sizeof(*group));
+    if (!group) {
+        Mix_OutOfMemory();
+        return NULL;
+    }
+    group->tag = tag;
+    group->oldest = -1;
+    group->newest = -1;
+    if (set_resize(&group->free, set_words, summary_words, 0, 0) < 0) {
+        set_free(&group->free);
+        SDL_free(group);
+        return NULL;
+    }
+
+    SDL_memmove(&groups[slot + 1], &groups[slot], (size_t)(num_groups - slot) * sizeof(*groups));
+    groups[slot] = group;
+    ++num_groups;
+    return group;
+}
+
+static void destroy_group(ChannelGroup *group)
+{
+    SDL_bool found;
+    int slot = find_group_slot(group->tag, &found);
+
+    if (found) {
+        SDL_memmove(&groups[slot], &groups[slot + 1], (size_t)(num_groups - slot - 1) * sizeof(*groups));
+        --num_groups;
+    }
+    set_free(&group->free);
+    SDL_free(group);
+}
+
+static void unlink_group_busy(int channel)
+{
+    ChannelEntry *entry = &entries[channel];
+    ChannelGroup *group = entry->group;
+
+    if (entry->group_older >= 0) {
+        entries[entry->group_older].group_newer = entry->group_newer;
+    } else {
+        group->oldest = entry->group_newer;
+    }
+    if (entry->group_newer >= 0) {
+        entries[entry->group_newer].group_older = entry->group_older;
+    } else {
+        group->newest = entry->group_older;
+    }
+    entry->group_older = entry->group_newer = -1;
+}
+
+/* Insert into the group's list by start serial; usually this is the tail */
+static void link_group_busy(int channel)
+{
+    ChannelEntry *entry = &entries[channel];
+    ChannelGroup *group = entry->group;
+    int older = group->newest;
+
+    while (older >= 0 && entries[older].serial > entry->serial) {
+        older = entries[older].group_older;
+    }
+    entry->group_older = older;
+    if (older >= 0) {
+        entry->group_newer = entries[older].group_newer;
+        entries[older].group_newer = channel;
+    } else {
+        entry->group_newer = group->oldest;
+        group->oldest = channel;
+    }
+    if (entry->group_newer >= 0) {
+        entries[entry->group_newer].group_older = channel;
+    } else {
+        group->newest = channel;
+    }
+}
+
+static void unlink_busy(int channel)
+{
+    ChannelEntry *entry = &entries[channel];
+
+    if (entry->older >= 0) {
+        entries[entry->older].newer = entry->newer;
+    } else {
+        oldest_busy = entry->newer;
+    }
+    if (entry->newer >= 0) {
+        entries[entry->newer].older = entry->older;
+    } else {
+        newest_busy = entry->older;
+    }
+    entry->older = entry->newer = -1;
+
+    if (entry->group) {
+        unlink_group_busy(channel);
+    }
+}
+
+static void link_busy(int channel)
+{
+    ChannelEntry *entry = &entries[channel];
+
+    entry->serial = ++start_serial;
+    entry->older = newest_busy;
+    entry->newer = -1;
+    if (newest_busy >= 0) {
+        entries[newest_busy].newer = channel;
+    } else {
+        oldest_busy = channel;
+    }
+    newest_busy = channel;
+
+    if (entry->group) {
+        link_group_busy(channel);
+    }
+}
+
+void _Mix_ChannelStarted(int channel)
+{
+    ChannelEntry *entry;
+
+    if (channel < 0 || channel >= num_entries) {
+        return;
+    }
+    entry = &entries[channel];
+
+    if (entry->busy) {
+        unlink_busy(channel);
+    } else {
+        entry->busy = SDL_TRUE;
+        entry->active_slot = num_active;
+        active[num_active++] = channel;
+        set_remove(&free_channels, channel);
+        if (entry->group) {
+            set_remove(&entry->group->free, channel);
+        }
+    }
+    link_busy(channel);
+}
+
+void _Mix_ChannelStopped(int channel)
+{
+    ChannelEntry *entry;
+
+    if (channel < 0 || channel >= num_entries) {
+        return;
+    }
+    entry = &entries[channel];
+
+    if (!entry->busy) {
+        return;
+    }
+    unlink_busy(channel);
+    entry->busy = SDL_FALSE;
+    if (entry->active_slot != --num_active) {
+        int moved = active[num_active];
+        active[entry->active_slot] = moved;
+        entries[moved].active_slot = entry->active_slot;
+    }
+    entry->active_slot = -1;
+    set_insert(&free_channels, channel);
+    if (entry->group) {
+        set_insert(&entry->group->free, channel);
+    }
+}
+
+SDL_bool _Mix_ChannelIsBusy(int channel)
+{
+    if (channel < 0 || channel >= num_entries) {
+        return SDL_FALSE;
+    }
+    return entries[channel].busy;
+}
+
+int _Mix_SetChannelTag(int channel, int tag)
+{
+    ChannelEntry *entry;
+    ChannelGroup *group = NULL;
+
+    if (channel < 0 || channel >= num_entries) {
+        return Mix_SetError("Invalid channel number");
+    }
+    entry = &entries[channel];
+
+    if (entry->tag == tag) {
+        return 0;
+    }
+    if (tag != -1) {
+        group = create_group(tag);
+        if (!group) {
+            return -1;
+        }
+    }
+
+    /* Leave the old group */
+    if (entry->group) {
+        ChannelGroup *old = entry->group;
+        if (entry->busy) {
+            unlink_group_busy(channel);
+        } else {
+            set_remove(&old->free, channel);
+        }
+        entry->group = NULL;
+        if (--old->members == 0) {
+            destroy_group(old);
+        }
+    }
+
+    /* ... and join the new one */
+    entry->tag = tag;
+    if (group) {
+        entry->group = group;
+        ++group->members;
+        if (entry->busy) {
+            link_group_busy(channel);
+        } else {
+            set_insert(&group->free, channel);
+        }
+    }
+    return 0;
+}
+
+int _Mix_ResizeChannelIndex(int numchans)
+{
+    int i;
+
+    /* Make room first, so that failing leaves the index as it was */
+    if (numchans > max_entries) {
+        int words = (numchans + 31) / 32;
+        int new_summary_words = (words + 31) / 32;
+        void *ptr;
+
+        if (set_resize(&free_channels, words, new_summary_words, set_words, summary_words) < 0) {
+            return -1;
+        }
+        for (i = 0; i < num_groups; ++i) {
+            if (set_resize(&groups[i]->free, words, new_summary_words, set_words, summary_words) < 0) {
+                return -1;
+            }
+        }
+
+        ptr = SDL_realloc(entries, (size_t)numchans * sizeof(*entries));
+        if (!ptr) {
+            return Mix_OutOfMemory();
+        }
+        entries = (ChannelEntry *)ptr;
+        ptr = SDL_realloc(active, (size_t)numchans * sizeof(*active));
+        if (!ptr) {
+            return Mix_OutOfMemory();
+        }
+        active = (int *)ptr;
+        ptr = SDL_realloc(active_snapshot, (size_t)numchans * sizeof(*active_snapshot));
+        if (!ptr) {
+            return Mix_OutOfMemory();
+        }
+        active_snapshot = (int *)ptr;
+
+        set_words = words;
+        summary_words = new_summary_words;
+        max_entries = numchans;
+    }
+
+    /* Retire the channels that are going away */
+    for (i = numchans; i < num_entries; ++i) {
+        _Mix_ChannelStopped(i);
+        _Mix_SetChannelTag(i, -1);
+        set_remove(&free_channels, i);
+    }
+
+    /* New channels start out free and untagged */
+    for (i = num_entries; i < numchans; ++i) {
+        ChannelEntry *entry = &entries[i];
+        entry->tag = -1;
+        entry->group = NULL;
+        entry->busy = SDL_FALSE;
+        entry->active_slot = -1;
+        entry->serial = 0;
+        entry->older = entry->newer = -1;
+        entry->group_older = entry->group_newer = -1;
+        set_insert(&free_channels, i);
+    }
+    num_entries = numchans;
+    return 0;
+}
+
+void _Mix_FreeChannelIndex(void)
+{
+    int i;
+
+    for (i = 0; i < num_groups; ++i) {
+        set_free(&groups[i]->free);
+        SDL_free(groups[i]);
+    }
+    SDL_free(groups);
+    groups = NULL;
+    num_groups = 0;
+
+    set_free(&free_channels);
+    SDL_free(entries);
+    entries = NULL;
+    num_entries = 0;
+    SDL_free(active);
+    active = NULL;
+    num_active = 0;
+    SDL_free(active_snapshot);
+    active_snapshot = NULL;
+    max_entries = 0;
+    set_words = 0;
+    summary_words = 0;
+    oldest_busy = -1;
+    newest_busy = -1;
+}
+
+const int *_Mix_SnapshotActiveChannels(int *count)
+{
+    if (num_active > 0) {
+        SDL_memcpy(active_snapshot, active, (size_t)num_active * sizeof(*active));
+    }
+    *count = num_active;
+    return active_snapshot;
+}
+
+int _Mix_FindFreeChannel(int from)
+{
+    return set_first(&free_channels, from);
+}
+
+int _Mix_GroupFirstFree(int tag)
+{
+    ChannelGroup *group;
+
+    if (tag == -1) {
+        return set_first(&free_channels, 0);
+    }
+    group = find_group(tag);
+    return group ? set_first(&group->free, 0) : -1;
+}
+
+int _Mix_GroupSize(int tag)
+{
+    ChannelGroup *group;
+
+    if (tag == -1) {
+        return num_entries;
+    }
+    group = find_group(tag);
+    return group ? group->members : 0;
+}
+
+int _Mix_GroupOldestBusy(int tag)
+{
+    ChannelGroup *group;
+
+    if (tag == -1) {
+        return oldest_busy;
+    }
+    group = find_group(tag);
+    return group ? group->oldest : -1;
+}
+
+int _Mix_GroupNewestBusy(int tag)
+{
+    ChannelGroup *group;
+
+    if (tag == -1) {
+        return newest_busy;
+    }
+    group = find_group(tag);
+    return group ? group->newest : -1;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,65 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CHANNEL_INDEX_H_
+#define CHANNEL_INDEX_H_
+
+/* Bookkeeping of busy/free channels, tags and start order, so that
+ * channel allocation and the Mix_Group* queries don't have to scan
+ * every allocated channel.
+ *
+ * MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling
+ * any of these, or that you're in the audio callback.
+ */
+
+#include <SDL3/SDL_stdinc.h>
+
+/* Resize the index to 'numchans' channels; new channels are free and untagged.
+ * Only growing can fail, and then the index is left as it was.
+ */
+extern int _Mix_ResizeChannelIndex(int numchans);
+extern void _Mix_FreeChannelIndex(void);
+
+/* A channel started playing (or restarted); it becomes the newest one */
+extern void _Mix_ChannelStarted(int channel);
+/* A channel stopped playing; does nothing if it wasn't busy */
+extern void _Mix_ChannelStopped(int channel);
+extern SDL_bool _Mix_ChannelIsBusy(int channel);
+
+extern int _Mix_SetChannelTag(int channel, int tag);
+
+/* Copy of the busy channels, stable while the caller starts and stops
+ * channels; valid until the next call or resize.
+ */
+extern const int *_Mix_SnapshotActiveChannels(int *count);
+
+/* First free channel numbered 'from' or higher, or -1 */
+extern int _Mix_FindFreeChannel(int from);
+
+/* Group queries, 'tag' of -1 meaning all the channels */
+extern int _Mix_GroupFirstFree(int tag);
+extern int _Mix_GroupSize(int tag);
+extern int _Mix_GroupOldestBusy(int tag);
+extern int _Mix_GroupNewestBusy(int tag);
+
+#endif /* CHANNEL_INDEX_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
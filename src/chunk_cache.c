@@ -0,0 +1,412 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+/* A cache of loaded chunks, shared by everyone who loads the same sound.
+ *
+ * Entries live on a list in least recently used order, most recent first.
+ * Entries nobody holds a reference to stay loaded while the cache is within
+ * its budget, and are freed oldest first when it isn't. Loads and frees are
+ * rare next to mixing, so the list is simply searched.
+ *
+ * Closing the audio device frees the entries nobody holds, but the ones
+ * still in use stay until their last Mix_FreeChunk(), so the cache lock
+ * outlives the device and is reused when the device is opened again.
+ */
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "mixer.h"
+#include "chunk_cache.h"
+#include "utils.h"
+
+typedef struct CacheEntry
+{
+    Uint64 hash;            /* of the path, or of the data */
+    Uint64 size;            /* of the data, 0 for a path */
+    char *path;             /* NULL if keyed by data */
+    int freq;               /* the mixer setup the chunk was loaded for */
+    Uint16 format;
+    int channels;
+    SDL_bool native_rate;
+    int compact;            /* MIX_COMPACT_*, see SDL_MIXER_HINT_COMPACT_CHUNKS */
+
+    Mix_Chunk *chunk;
+    int refcount;
+    struct CacheEntry *prev;
+    struct CacheEntry *next;
+} CacheEntry;
+
+static SDL_Mutex *cache_lock = NULL;
+static SDL_bool cache_open = SDL_FALSE;
+static CacheEntry *cache_head = NULL;     /* most recently used */
+static CacheEntry *cache_tail = NULL;     /* least recently used */
+static Uint64 cache_budget = 0;
+static Mix_ChunkCacheStats cache_stats;
+
+
+static Uint64 chunk_bytes(const Mix_Chunk *chunk)
+{
+    return (Uint64)chunk->alen + sizeof(*chunk);
+}
+
+static void init_key(CacheEntry *key, Uint64 hash, Uint64 size, const char *path)
+{
+    SDL_zerop(key);
+    key->hash = hash;
+    key->size = size;
+    key->path = (char *)path;
+    Mix_QuerySpec(&key->freq, &key->format, &key->channels);
+    key->native_rate = SDL_GetHintBoolean(SDL_MIXER_HINT_NATIVE_RATE_CHUNKS, SDL_FALSE);
+    key->compact = _Mix_CompactChunks();
+}
+
+static SDL_bool same_key(const CacheEntry *a, const CacheEntry *b)
+{
+    if (a->hash != b->hash || a->size != b->size ||
+        a->freq != b->freq || a->format != b->format ||
+        a->channels != b->channels || a->native_rate != b->native_rate ||
+        a->compact != b->compact) {
+        return SDL_FALSE;
+    }
+    if (!a->path || !b->path) {
+        return (!a->path && !b->path) ? SDL_TRUE : SDL_FALSE;
+    }
+    return (SDL_strcmp(a->path, b->path) == 0) ? SDL_TRUE : SDL_FALSE;
+}
+
+static void unlink_entry(CacheEntry *entry)
+{
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        cache_head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache_tail = entry->prev;
+    }
+    entry->prev = entry->next = NULL;
+}
+
+static void push_entry(CacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache_head;
+    if (cache_head) {
+        cache_head->prev = entry;
+    } else {
+        cache_tail = entry;
+    }
+    cache_head = entry;
+}
+
+static void remove_entry(CacheEntry *entry)
+{
+    unlink_entry(entry);
+    --cache_stats.entries;
+    if (!entry->refcount) {
+        --cache_stats.unreferenced;
+    }
+    cache_stats.bytes -= chunk_bytes(entry->chunk);
+    entry->chunk->allocated &= ~MIX_CHUNK_CACHED;
+}
+
+/* Take unreferenced entries off the list, oldest first, until the cache is
+   within 'budget'. The caller frees their chunks once it has let go of the
+   cache lock, since freeing a chunk locks the audio device. */
+static CacheEntry *evict_entries(Uint64 budget)
+{
+    CacheEntry *entry, *prev, *evicted = NULL;
+
+    for (entry = cache_tail; entry && cache_stats.bytes > budget; entry = prev) {
+        prev = entry->prev;
+        if (entry->refcount) {
+            continue;
+        }
+        remove_entry(entry);
+        ++cache_stats.evictions;
+        entry->next = evicted;
+        evicted = entry;
+    }
+    return evicted;
+}
+
+static void free_entries(CacheEntry *entry)
+{
+    while (entry) {
+        CacheEntry *next = entry->next;
+        Mix_FreeChunk(entry->chunk);
+        SDL_free(entry->path);
+        SDL_free(entry);
+        entry = next;
+    }
+}
+
+/* Returns the cached chunk for 'key' with a new reference, or NULL */
+static Mix_Chunk *find_chunk(const CacheEntry *key)
+{
+    CacheEntry *entry;
+
+    for (entry = cache_head; entry; entry = entry->next) {
+        if (same_key(entry, key)) {
+            if (!entry->refcount++) {
+                --cache_stats.unreferenced;
+            }
+            unlink_entry(entry);
+            push_entry(entry);
+            ++cache_stats.hits;
+            return entry->chunk;
+        }
+    }
+    ++cache_stats.misses;
+    return NULL;
+}
+
+/* Add a newly loaded chunk, or if someone else cached the same thing while
+   it was loading, free it and return theirs. */
+static Mix_Chunk *add_chunk(const CacheEntry *key, Mix_Chunk *chunk)
+{
+    CacheEntry *entry, *evicted;
+
+    SDL_LockMutex(cache_lock);
+    for (entry = cache_head; entry; entry = entry->next) {
+        if (same_key(entry, key)) {
+            if (!entry->refcount++) {
+                --cache_stats.unreferenced;
+            }
+            SDL_UnlockMutex(cache_lock);
+            Mix_FreeChunk(chunk);
+            return entry->chunk;
+        }
+    }
+
+    entry = (CacheEntry *)SDL_malloc(sizeof(*entry));
+    if (!entry) {
+        /* It just won't be shared */
+        SDL_UnlockMutex(cache_lock);
+        return chunk;
+    }
+    *entry = *key;
+    entry->path = NULL;
+    if (key->path) {
+        entry->path = SDL_strdup(key->path);
+        if (!entry->path) {
+            SDL_UnlockMutex(cache_lock);
+            SDL_free(entry);
+            return chunk;
+        }
+    }
+    entry->chunk = chunk;
+    entry->refcount = 1;
+    chunk->allocated |= MIX_CHUNK_CACHED;
+    push_entry(entry);
+    ++cache_stats.entries;
+    cache_stats.bytes += chunk_bytes(chunk);
+
+    evicted = evict_entries(cache_budget);
+    SDL_UnlockMutex(cache_lock);
+
+    free_entries(evicted);
+    return chunk;
+}
+
+int _Mix_InitChunkCache(void)
+{
+    if (!cache_lock) {
+        cache_lock = SDL_CreateMutex();
+        if (!cache_lock) {
+            return -1;
+        }
+    }
+    SDL_LockMutex(cache_lock);
+    cache_open = SDL_TRUE;
+    SDL_UnlockMutex(cache_lock);
+    return 0;
+}
+
+void _Mix_QuitChunkCache(void)
+{
+    CacheEntry *evicted;
+
+    if (!cache_lock) {
+        return;
+    }
+
+    SDL_LockMutex(cache_lock);
+    cache_open = SDL_FALSE;
+    /* What's left is still in use, and is freed by its last Mix_FreeChunk() */
+    evicted = evict_entries(0);
+    SDL_UnlockMutex(cache_lock);
+
+    free_entries(evicted);
+}
+
+void _Mix_ReleaseCachedChunk(Mix_Chunk *chunk)
+{
+    CacheEntry *entry, *evicted = NULL;
+
+    SDL_LockMutex(cache_lock);
+    for (entry = cache_head; entry; entry = entry->next) {
+        if (entry->chunk == chunk) {
+            if (entry->refcount > 0 && !--entry->refcount) {
+                ++cache_stats.unreferenced;
+                /* Nothing is kept around once the audio device is closed */
+                evicted = evict_entries(cache_open ? cache_budget : 0);
+            }
+            break;
+        }
+    }
+    SDL_UnlockMutex(cache_lock);
+
+    free_entries(evicted);
+}
+
+Mix_Chunk *Mix_LoadWAVCached(const char *file)
+{
+    CacheEntry key;
+    Mix_Chunk *chunk;
+
+    if (!file) {
+        Mix_SetError("Mix_LoadWAVCached with NULL file");
+        return NULL;
+    }
+    if (!cache_lock || !cache_open) {
+        Mix_SetError("Audio device hasn't been opened");
+        return NULL;
+    }
+
+    init_key(&key, _Mix_HashBytes(MIX_HASH_INIT, file, SDL_strlen(file)), 0, file);
+    SDL_LockMutex(cache_lock);
+    chunk = find_chunk(&key);
+    SDL_UnlockMutex(cache_lock);
+    if (chunk) {
+        return chunk;
+    }
+
+    chunk = Mix_LoadWAV(file);
+    if (!chunk) {
+        return NULL;
+    }
+    return add_chunk(&key, chunk);
+}
+
+Mix_Chunk *Mix_LoadWAVCached_RW(SDL_RWops *src, SDL_bool freesrc)
+{
+    CacheEntry key;
+    Mix_Chunk *chunk;
+    void *data;
+    size_t size;
+
+    if (!src) {
+        Mix_SetError("Mix_LoadWAVCached_RW with NULL src");
+        return NULL;
+    }
+    if (!cache_lock || !cache_open) {
+        Mix_SetError("Audio device hasn't been opened");
+        if (freesrc) {
+            SDL_RWclose(src);
+        }
+        return NULL;
+    }
+
+    /* The data has to be read to be hashed, so load it from memory after */
+    data = SDL_LoadFile_RW(src, &size, freesrc);
+    if (!data) {
+        return NULL;
+    }
+
+    init_key(&key, _Mix_HashBytes(MIX_HASH_INIT, data, size), (Uint64)size, NULL);
+    SDL_LockMutex(cache_lock);
+    chunk = find_chunk(&key);
+    SDL_UnlockMutex(cache_lock);
+    if (chunk) {
+        SDL_free(data);
+        return chunk;
+    }
+
+    chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data, size), SDL_TRUE);
+    SDL_free(data);
+    if (!chunk) {
+        return NULL;
+    }
+    return add_chunk(&key, chunk);
+}
+
+void Mix_SetChunkCacheBudget(Uint64 bytes)
+{
+    CacheEntry *evicted = NULL;
+
+    if (cache_lock) {
+        SDL_LockMutex(cache_lock);
+    }
+    cache_budget = bytes;
+    if (cache_lock) {
+        evicted = evict_entries(cache_budget);
+        SDL_UnlockMutex(cache_lock);
+    }
+    free_entries(evicted);
+}
+
+void Mix_FlushChunkCache(void)
+{
+    CacheEntry *evicted;
+
+    if (!cache_lock) {
+        return;
+    }
+    SDL_LockMutex(cache_lock);
+    evicted = evict_entries(0);
+    SDL_UnlockMutex(cache_lock);
+    free_entries(evicted);
+}
+
+void Mix_GetChunkCacheStats(Mix_ChunkCacheStats *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (cache_lock) {
+        SDL_LockMutex(cache_lock);
+    }
+    *stats = cache_stats;
+    stats->budget = cache_budget;
+    if (cache_lock) {
+        SDL_UnlockMutex(cache_lock);
+    }
+}
+
+void Mix_ResetChunkCacheStats(void)
+{
+    if (cache_lock) {
+        SDL_LockMutex(cache_lock);
+    }
+    cache_stats.hits = 0;
+    cache_stats.misses = 0;
+    cache_stats.evictions = 0;
+    if (cache_lock) {
+        SDL_UnlockMutex(cache_lock);
+    }
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,42 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef CHUNK_CACHE_H_
+#define CHUNK_CACHE_H_
+
+/* The shared chunk cache behind Mix_LoadWAVCached().
+ *
+ * Cached chunks have MIX_CHUNK_CACHED set in 'allocated', and
+ * Mix_FreeChunk() hands them back here instead of freeing them.
+ */
+
+#include <SDL3_mixer/SDL_mixer.h>
+
+extern int _Mix_InitChunkCache(void);
+/* Frees every chunk nobody holds; the rest become ordinary chunks */
+extern void _Mix_QuitChunkCache(void);
+
+extern void _Mix_ReleaseCachedChunk(Mix_Chunk *chunk);
+
+#endif /* CHUNK_CACHE_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
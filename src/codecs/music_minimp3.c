@@ -28,6 +28,12 @@
 #define MINIMP3_NO_STDIO
 #include "minimp3/minimp3_ex.h"
 
+/* Instead of scanning the whole file for the seek index when it's opened,
+ * we index a few more frames each time we decode a chunk, and whatever is
+ * still missing when we seek past the end of the index.
+ */
+#define MINIMP3_INDEX_FRAMES    64
+#define MINIMP3_INDEX_BUF_SIZE  (2 * MINIMP3_BUF_SIZE)
 
 typedef struct {
     struct mp3file_t file;
@@ -43,6 +49,17 @@ typedef struct {
     uint64_t second_length;
     int channels;
 
+    /* The seek index, built as we go */
+    mp3dec_t index_dec;
+    mp3d_sample_t index_pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+    Uint8 index_buf[MINIMP3_INDEX_BUF_SIZE];
+    size_t index_filled, index_consumed;
+    uint64_t index_pos;
+    uint64_t index_samples;
+    int index_decoded;
+    SDL_bool index_eof;
+    SDL_bool index_done;
+
     Mix_MusicMetaTags tags;
 } MiniMP3_Music;
 
@@ -62,6 +79,110 @@ static int MiniMP3_SeekCB(uint64_t position, void *context)
     return 0;
 }
 
+/* Read more of the file into the index buffer, leaving the read position
+ * of the decoder where it was.
+ */
+static int MINIMP3_FillIndexBuffer(MiniMP3_Music *music)
+{
+    Sint64 pos = MP3_RWtell(&music->file);
+    size_t space, amount;
+
+    SDL_memmove(music->index_buf, music->index_buf + music->index_consumed, music->index_filled - music->index_consumed);
+    music->index_filled -= music->index_consumed;
+    music->index_pos += music->index_consumed;
+    music->index_consumed = 0;
+
+    space = sizeof(music->index_buf) - music->index_filled;
+    if (MP3_RWseek(&music->file, (Sint64)(music->index_pos + music->index_filled), SDL_RW_SEEK_SET) < 0) {
+        return -1;
+    }
+    amount = MP3_RWread(&music->file, music->index_buf + music->index_filled, 1, space);
+    if (MP3_RWseek(&music->file, pos, SDL_RW_SEEK_SET) < 0) {
+        return -1;
+    }
+    music->index_filled += amount;
+    if (amount < space) {
+        music->index_eof = SDL_TRUE;
+        mp3dec_skip_id3v1(music->index_buf, &music->index_filled);
+    }
+    return 0;
+}
+
+/* Add frames to the seek index until it reaches 'position' (in samples of
+ * all channels) or 'max_frames' more frames are indexed, -1 for no limit.
+ * The frames are counted the same way mp3dec_load_index() counts them.
+ */
+static int MINIMP3_BuildIndex(MiniMP3_Music *music, uint64_t position, int max_frames)
+{
+    mp3dec_index_t *index = &music->dec.index;
+
+    while (!music->index_done && max_frames != 0) {
+        int free_format_bytes = 0, frame_size = 0;
+        int skip;
+        size_t remaining;
+        const uint8_t *hdr;
+        mp3dec_frame_t *frame;
+
+        if (index->num_frames > 0 && index->frames[index->num_frames - 1].sample >= position) {
+            break;
+        }
+
+        if (!music->index_eof && (music->index_filled - music->index_consumed) < MINIMP3_BUF_SIZE) {
+            /* keep at least 10 consecutive frames in the buffer, like minimp3 */
+            if (MINIMP3_FillIndexBuffer(music) < 0) {
+                return -1;
+            }
+        }
+
+        remaining = music->index_filled - music->index_consumed;
+        skip = mp3d_find_frame(music->index_buf + music->index_consumed, (int)remaining, &free_format_bytes, &frame_size);
+        if (skip && !frame_size) {
+            music->index_consumed += skip;
+            continue;
+        }
+        if (!frame_size) {
+            /* That's the whole file, so now we know exactly how long it is */
+            music->index_done = SDL_TRUE;
+            if (!music->dec.vbr_tag_found) {
+                music->dec.samples = music->index_samples;
+            }
+            break;
+        }
+        hdr = music->index_buf + music->index_consumed + skip;
+
+        if (index->num_frames + 1 > index->capacity) {
+            size_t capacity = index->capacity ? index->capacity * 2 : 4096;
+            /* mp3dec_ex_close() frees the index with free() */
+            mp3dec_frame_t *frames = (mp3dec_frame_t *)realloc(index->frames, capacity * sizeof(*frames));
+            if (!frames) {
+                return SDL_OutOfMemory();
+            }
+            index->frames = frames;
+            index->capacity = capacity;
+        }
+        frame = &index->frames[index->num_frames++];
+        frame->offset = music->index_pos + music->index_consumed + skip;
+        frame->sample = music->index_samples;
+
+        if (!music->index_decoded && index->num_frames < 256) {
+            /* The first frames of a cut stream may not decode until the bit
+             * reservoir fills, so count what they actually decode to.
+             */
+            mp3dec_frame_info_t info;
+            music->index_decoded = mp3dec_decode_frame(&music->index_dec, hdr, (int)(remaining - skip), music->index_pcm, &info);
+            music->index_samples += (uint64_t)music->index_decoded * info.channels;
+        } else {
+            music->index_samples += (uint64_t)hdr_frame_samples(hdr) * (HDR_IS_MONO(hdr) ? 1 : 2);
+        }
+
+        music->index_consumed += skip + frame_size;
+        if (max_frames > 0) {
+            --max_frames;
+        }
+    }
+    return 0;
+}
+
 static int MINIMP3_Seek(void *context, double position);
 
 static void *MINIMP3_CreateFromRW(SDL_RWops *src, SDL_bool freesrc)
@@ -95,12 +216,18 @@ static void *MINIMP3_CreateFromRW(SDL_RWops *src, SDL_bool freesrc)
 
     MP3_RWseek(&music->file, 0, SDL_RW_SEEK_SET);
 
-    if (mp3dec_ex_open_cb(&music->dec, &music->io, MP3D_SEEK_TO_SAMPLE) != 0) {
+    /* Only read the first frame (and any Xing/VBRI header) here; we build
+     * the seek index ourselves, so mp3dec_ex_seek() never has to scan.
+     */
+    if (mp3dec_ex_open_cb(&music->dec, &music->io, MP3D_SEEK_TO_SAMPLE | MP3D_DO_NOT_SCAN) != 0) {
         mp3dec_ex_close(&music->dec);
         SDL_free(music);
         Mix_SetError("music_minimp3: corrupt mp3 file (bad stream).");
         return NULL;
     }
+    music->dec.indexes_built = 1;
+    mp3dec_init(&music->index_dec);
+    music->index_pos = music->dec.start_offset;
 
     file_spec.format = SDL_AUDIO_S16;
     file_spec.channels = (Uint8)music->dec.info.channels;
@@ -177,6 +304,11 @@ static int MINIMP3_GetSome(void *context, void *data, int bytes, SDL_bool *done)
         if (SDL_PutAudioStreamData(music->stream, music->buffer, (int)amount * sizeof(mp3d_sample_t)) < 0) {
             return -1;
         }
+        if (!music->index_done) {
+            if (MINIMP3_BuildIndex(music, (uint64_t)-1, MINIMP3_INDEX_FRAMES) < 0) {
+                return -1;
+            }
+        }
     } else {
         if (music->play_count == 1) {
             music->play_count = 0;
@@ -208,6 +340,12 @@ static int MINIMP3_Seek(void *context, double position)
     if (destpos % music->channels != 0) {
         destpos -= destpos % music->channels;
     }
+    if (destpos > 0) {
+        /* The index has to reach the new position before minimp3 can use it */
+        if (MINIMP3_BuildIndex(music, destpos + music->dec.start_delay, -1) < 0) {
+            return -1;
+        }
+    }
     mp3dec_ex_seek(&music->dec, destpos);
     return 0;
 }
@@ -221,7 +359,24 @@ static double MINIMP3_Tell(void *context)
 static double MINIMP3_Duration(void *context)
 {
     MiniMP3_Music *music = (MiniMP3_Music *)context;
-    return (double)music->dec.samples / music->second_length;
+    uint64_t length, indexed;
+
+    if (music->dec.vbr_tag_found || music->index_done) {
+        return (double)music->dec.samples / music->second_length;
+    }
+
+    /* Estimate the rest from what we've indexed so far, or from the
+     * bitrate of the first frame if we haven't indexed anything yet.
+     */
+    length = (uint64_t)music->file.length - music->dec.start_offset;
+    indexed = music->index_pos + music->index_consumed - music->dec.start_offset;
+    if (indexed > 0 && music->index_samples > 0) {
+        return ((double)music->index_samples * length / indexed) / music->second_length;
+    }
+    if (music->dec.info.bitrate_kbps > 0) {
+        return (double)length * 8 / (music->dec.info.bitrate_kbps * 1000);
+    }
+    return 0.0;
 }
 
 static const char* MINIMP3_GetMetaTag(void *context, Mix_MusicMetaTag tag_type)
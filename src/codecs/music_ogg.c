@@ -198,6 +198,7 @@ static void OGG_Delete(void *context);
 static int OGG_UpdateSection(OGG_music *music)
 {
     SDL_AudioSpec srcspec;
+    int buffer_size;
     vorbis_info *vi;
 
     vi = vorbis.ov_info(&music->vf, -1);
@@ -210,29 +211,30 @@ static int OGG_UpdateSection(OGG_music *music)
     }
     SDL_memcpy(&music->vi, vi, sizeof(*vi));
 
-    if (music->buffer) {
-        SDL_free(music->buffer);
-        music->buffer = NULL;
-    }
-
-    if (music->stream) {
-        SDL_DestroyAudioStream(music->stream);
-        music->stream = NULL;
-    }
-
     srcspec.format = SDL_AUDIO_S16;
     srcspec.channels = vi->channels;
     srcspec.freq = (int)vi->rate;
-    music->stream = SDL_CreateAudioStream(&srcspec, &music_spec);
-    if (!music->stream) {
-        return -1;
+    /* Reuse what we have, so a new section doesn't have to allocate */
+    if (music->stream) {
+        if (SDL_SetAudioStreamFormat(music->stream, &srcspec, NULL) < 0) {
+            return -1;
+        }
+    } else {
+        music->stream = SDL_CreateAudioStream(&srcspec, &music_spec);
+        if (!music->stream) {
+            return -1;
+        }
     }
 
-    music->buffer_size = 4096/*music_spec.samples*/ * (int)sizeof(Sint16) * vi->channels;
-    music->buffer = (char *)SDL_malloc((size_t)music->buffer_size);
-    if (!music->buffer) {
-        return -1;
+    buffer_size = 4096/*music_spec.samples*/ * (int)sizeof(Sint16) * vi->channels;
+    if (buffer_size > music->buffer_size || !music->buffer) {
+        char *buffer = (char *)SDL_realloc(music->buffer, (size_t)buffer_size);
+        if (!buffer) {
+            return -1;
+        }
+        music->buffer = buffer;
     }
+    music->buffer_size = buffer_size;
     return 0;
 }
 
@@ -124,6 +124,7 @@ static int OGG_UpdateSection(OGG_music *music)
 {
     stb_vorbis_info vi;
     SDL_AudioSpec srcspec;
+    int buffer_size;
 
     vi = stb_vorbis_get_info(music->vf);
 
@@ -132,33 +133,34 @@ static int OGG_UpdateSection(OGG_music *music)
     }
     SDL_memcpy(&music->vi, &vi, sizeof(vi));
 
-    if (music->buffer) {
-        SDL_free(music->buffer);
-        music->buffer = NULL;
-    }
-
-    if (music->stream) {
-        SDL_DestroyAudioStream(music->stream);
-        music->stream = NULL;
-    }
-
     srcspec.format = SDL_AUDIO_F32;
     srcspec.channels = vi.channels;
     srcspec.freq = (int)vi.sample_rate;
-    music->stream = SDL_CreateAudioStream(&srcspec, &music_spec);
-    if (!music->stream) {
-        return -1;
+    /* Reuse what we have, so a new section doesn't have to allocate */
+    if (music->stream) {
+        if (SDL_SetAudioStreamFormat(music->stream, &srcspec, NULL) < 0) {
+            return -1;
+        }
+    } else {
+        music->stream = SDL_CreateAudioStream(&srcspec, &music_spec);
+        if (!music->stream) {
+            return -1;
+        }
     }
 
-    music->buffer_size = 4096/*music_spec.samples*/ * (int)sizeof(float) * vi.channels;
-    if (music->buffer_size <= 0) {
+    buffer_size = 4096/*music_spec.samples*/ * (int)sizeof(float) * vi.channels;
+    if (buffer_size <= 0) {
         return -1;
     }
 
-    music->buffer = (char *)SDL_malloc((size_t)music->buffer_size);
-    if (!music->buffer) {
-        return -1;
+    if (buffer_size > music->buffer_size || !music->buffer) {
+        char *buffer = (char *)SDL_realloc(music->buffer, (size_t)buffer_size);
+        if (!buffer) {
+            return -1;
+        }
+        music->buffer = buffer;
     }
+    music->buffer_size = buffer_size;
     return 0;
 }
 
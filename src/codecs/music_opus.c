@@ -170,6 +170,7 @@ static int OPUS_UpdateSection(OPUS_music *music)
 {
     const OpusHead *op_info;
     SDL_AudioSpec srcspec;
+    int buffer_size;
 
     op_info = opus.op_head(music->of, -1);
     if (!op_info) {
@@ -181,29 +182,30 @@ static int OPUS_UpdateSection(OPUS_music *music)
     }
     music->op_info = op_info;
 
-    if (music->buffer) {
-        SDL_free(music->buffer);
-        music->buffer = NULL;
-    }
-
-    if (music->stream) {
-        SDL_DestroyAudioStream(music->stream);
-        music->stream = NULL;
-    }
-
     srcspec.format = SDL_AUDIO_S16;
     srcspec.channels = op_info->channel_count;
     srcspec.freq = 48000;
-    music->stream = SDL_CreateAudioStream(&srcspec, &music_spec);
-    if (!music->stream) {
-        return -1;
+    /* Reuse what we have, so a new section doesn't have to allocate */
+    if (music->stream) {
+        if (SDL_SetAudioStreamFormat(music->stream, &srcspec, NULL) < 0) {
+            return -1;
+        }
+    } else {
+        music->stream = SDL_CreateAudioStream(&srcspec, &music_spec);
+        if (!music->stream) {
+            return -1;
+        }
     }
 
-    music->buffer_size = (int)4096/*music_spec.samples*/ * (int)sizeof(opus_int16) * op_info->channel_count;
-    music->buffer = (char *)SDL_malloc((size_t)music->buffer_size);
-    if (!music->buffer) {
-        return -1;
+    buffer_size = (int)4096/*music_spec.samples*/ * (int)sizeof(opus_int16) * op_info->channel_count;
+    if (buffer_size > music->buffer_size || !music->buffer) {
+        char *buffer = (char *)SDL_realloc(music->buffer, (size_t)buffer_size);
+        if (!buffer) {
+            return -1;
+        }
+        music->buffer = buffer;
     }
+    music->buffer_size = buffer_size;
     return 0;
 }
 
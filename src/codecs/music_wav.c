@@ -85,6 +85,7 @@ typedef struct {
     Sint64 start;
     Sint64 stop;
     Sint64 samplesize;
+    Uint32 fact_frames;     /* length of ADPCM data from the 'fact' chunk, or 0 */
     Uint8 *buffer;
     size_t buflen;
     size_t buffered;
@@ -114,6 +115,7 @@ typedef struct {
 #define DATA        0x61746164      /* "data" */
 #define SMPL        0x6c706d73      /* "smpl" */
 #define LIST        0x5453494c      /* "LIST" */
+#define FACT        0x74636166      /* "fact" */
 #define ID3_        0x20336469      /* "id3 " */
 #define UNKNOWN_CODE    0x0000
 #define PCM_CODE        0x0001      /* WAVE_FORMAT_PCM */
@@ -800,26 +802,28 @@ static int IMA_ADPCM_Init(ADPCM_DecoderState *state, const Uint8 *chunk_data, Ui
     return 0;
 }
 
+static const Sint8 IMA_ADPCM_index_table_4b[16] = {
+    -1, -1, -1, -1,
+    2, 4, 6, 8,
+    -1, -1, -1, -1,
+    2, 4, 6, 8
+};
+
+static const Uint16 IMA_ADPCM_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
+    143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
+    449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
+    1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+    22385, 24623, 27086, 29794, 32767
+};
+
 static Sint16 IMA_ADPCM_ProcessNibble(Sint8 *cindex, Sint16 lastsample, Uint8 nybble)
 {
     const Sint32 max_audioval = 32767;
     const Sint32 min_audioval = -32768;
-    const Sint8 index_table_4b[16] = {
-        -1, -1, -1, -1,
-        2, 4, 6, 8,
-        -1, -1, -1, -1,
-        2, 4, 6, 8
-    };
-    const Uint16 step_table[89] = {
-        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
-        34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
-        143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
-        449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
-        1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
-        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
-        9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
-        22385, 24623, 27086, 29794, 32767
-    };
     Uint32 step;
     Sint32 sample, delta;
     Sint8 index = *cindex;
@@ -832,10 +836,10 @@ static Sint16 IMA_ADPCM_ProcessNibble(Sint8 *cindex, Sint16 lastsample, Uint8 ny
     }
 
     /* explicit cast to avoid gcc warning about using 'char' as array index */
-    step = step_table[(size_t)index];
+    step = IMA_ADPCM_step_table[(size_t)index];
 
     /* Update index value */
-    *cindex = index + index_table_4b[nybble];
+    *cindex = index + IMA_ADPCM_index_table_4b[nybble];
 
     /* This calculation uses shifts and additions because multiplications were
      * much slower back then. Sadly, this can't just be replaced with an actual
@@ -974,6 +978,125 @@ static int IMA_ADPCM_DecodeBlockData(ADPCM_DecoderState *state)
     return retval;
 }
 
+/* Pick the nibble that gets closest to 'sample' from 'lastsample', and
+ * advance the channel state exactly the way the decoder will.
+ */
+static Uint8 IMA_ADPCM_EncodeSample(Sint8 *cindex, Sint16 *lastsample, Sint16 sample)
+{
+    Sint8 index = *cindex;
+    Sint32 step, diff;
+    Uint8 nybble = 0;
+
+    if (index > 88) {
+        index = 88;
+    } else if (index < 0) {
+        index = 0;
+    }
+    step = IMA_ADPCM_step_table[(size_t)index];
+
+    diff = (Sint32)sample - *lastsample;
+    if (diff < 0) {
+        nybble = 0x08;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        nybble |= 0x04;
+        diff -= step;
+    }
+    if (diff >= (step >> 1)) {
+        nybble |= 0x02;
+        diff -= step >> 1;
+    }
+    if (diff >= (step >> 2)) {
+        nybble |= 0x01;
+    }
+
+    *lastsample = IMA_ADPCM_ProcessNibble(cindex, *lastsample, nybble);
+    return nybble;
+}
+
+void *WAV_EncodeIMAADPCM(const Sint16 *samples, Uint32 frames, int channels, int freq, size_t *size)
+{
+    const size_t blocksize = (size_t)IMA_ADPCM_ENCODE_BLOCK * channels;
+    const Uint32 samplesperblock = (IMA_ADPCM_ENCODE_BLOCK - 4) * 2 + 1;
+    const Uint32 blocks = (frames + samplesperblock - 1) / samplesperblock;
+    const size_t headersize = 12 + 8 + 20 + 8 + 4 + 8;
+    Sint8 cindex[8];
+    Sint16 last[8];
+    Uint8 *wav, *dst;
+    Uint32 b, frame, f;
+    size_t datasize;
+    int c, i;
+
+    if (channels <= 0 || channels > (int)SDL_arraysize(cindex)) {
+        Mix_SetError("Unsupported number of channels for IMA ADPCM");
+        return NULL;
+    }
+    datasize = (size_t)blocks * blocksize;
+    if (datasize > SDL_MAX_UINT32 - headersize) {
+        Mix_SetError("Audio data too large for IMA ADPCM");
+        return NULL;
+    }
+    wav = (Uint8 *)SDL_malloc(headersize + datasize);
+    if (!wav) {
+        Mix_OutOfMemory();
+        return NULL;
+    }
+
+    /* A minimal RIFF WAVE header, with wSamplesPerBlock, and a fact chunk
+       with the real number of frames, since the last block is padded */
+    dst = wav;
+    SDL_memcpy(dst, "RIFF", 4);
+    *(Uint32 *)(dst + 4) = SDL_SwapLE32((Uint32)(headersize + datasize - 8));
+    SDL_memcpy(dst + 8, "WAVEfmt ", 8);
+    *(Uint32 *)(dst + 16) = SDL_SwapLE32(20);
+    *(Uint16 *)(dst + 20) = SDL_SwapLE16(IMA_ADPCM_CODE);
+    *(Uint16 *)(dst + 22) = SDL_SwapLE16((Uint16)channels);
+    *(Uint32 *)(dst + 24) = SDL_SwapLE32((Uint32)freq);
+    *(Uint32 *)(dst + 28) = SDL_SwapLE32((Uint32)(((Uint64)freq * blocksize) / samplesperblock));
+    *(Uint16 *)(dst + 32) = SDL_SwapLE16((Uint16)blocksize);
+    *(Uint16 *)(dst + 34) = SDL_SwapLE16(4);
+    *(Uint16 *)(dst + 36) = SDL_SwapLE16(2);
+    *(Uint16 *)(dst + 38) = SDL_SwapLE16((Uint16)samplesperblock);
+    SDL_memcpy(dst + 40, "fact", 4);
+    *(Uint32 *)(dst + 44) = SDL_SwapLE32(4);
+    *(Uint32 *)(dst + 48) = SDL_SwapLE32(frames);
+    SDL_memcpy(dst + 52, "data", 4);
+    *(Uint32 *)(dst + 56) = SDL_SwapLE32((Uint32)datasize);
+    dst += headersize;
+
+    /* The last block is padded out with the last frame */
+    SDL_zeroa(cindex);
+    for (b = 0; b < blocks; ++b) {
+        frame = b * samplesperblock;
+        for (c = 0; c < channels; ++c) {
+            last[c] = samples[frame * channels + c];
+            dst[0] = (Uint8)((Uint16)last[c] & 0xFF);
+            dst[1] = (Uint8)((Uint16)last[c] >> 8);
+            dst[2] = (Uint8)cindex[c];
+            dst[3] = 0;
+            dst += 4;
+        }
+        /* Eight samples per channel at a time, interleaved four bytes each */
+        for (f = 1; f < samplesperblock; f += 8) {
+            for (c = 0; c < channels; ++c) {
+                for (i = 0; i < 8; ++i) {
+                    Uint32 n = SDL_min(frame + f + i, frames - 1);
+                    Uint8 nybble = IMA_ADPCM_EncodeSample(&cindex[c], &last[c], samples[n * channels + c]);
+                    if (i & 1) {
+                        dst[i / 2] |= (Uint8)(nybble << 4);
+                    } else {
+                        dst[i / 2] = nybble;
+                    }
+                }
+                dst += 4;
+            }
+        }
+    }
+    *size = headersize + datasize;
+    return wav;
+}
+
 static void ADPCM_Cleanup(ADPCM_DecoderState *state)
 {
     if (state->ddata) {
@@ -1003,6 +1126,7 @@ static int fetch_adpcm(void *context, int length, int (*DecodeBlockHeader)(ADPCM
 
     while (left > 0) {
         if (state->output.read == state->output.pos) {
+            Sint64 offset = SDL_RWtell(music->src) - music->start;
             size_t bytesread = SDL_RWread(music->src, state->block.data, state->blocksize);
             if (bytesread == 0) {
                 break;
@@ -1020,6 +1144,15 @@ static int fetch_adpcm(void *context, int length, int (*DecodeBlockHeader)(ADPCM
             if (DecodeBlockData(state) < 0) {
                 return -1;
             }
+
+            if (music->fact_frames) {
+                /* Drop the padding at the end of the last block */
+                Sint64 first = (offset / (Sint64)state->blocksize) * (Sint64)state->samplesperblock;
+                Sint64 frames = SDL_max((Sint64)music->fact_frames - first, 0);
+                if ((Sint64)state->output.pos > frames * state->channels) {
+                    state->output.pos = (size_t)(frames * state->channels);
+                }
+            }
         }
         len = SDL_min(left, (state->output.pos - state->output.read) * sizeof(Sint16));
         SDL_memcpy(dst, &state->output.data[state->output.read], len);
@@ -1029,7 +1162,7 @@ static int fetch_adpcm(void *context, int length, int (*DecodeBlockHeader)(ADPCM
     }
     music->buffered = (state->output.pos - state->output.read) * sizeof(Sint16);
 
-    return length;
+    return (int)(length - left);
 }
 
 static int fetch_ms_adpcm(void *context, int length)
@@ -1303,7 +1436,9 @@ static double WAV_Duration(void *context)
 {
     WAV_Music *music = (WAV_Music *)context;
     Sint64 samples;
-    if (music->encoding == MS_ADPCM_CODE || music->encoding == IMA_ADPCM_CODE) {
+    if (music->fact_frames) {
+        samples = music->fact_frames;
+    } else if (music->encoding == MS_ADPCM_CODE || music->encoding == IMA_ADPCM_CODE) {
         samples = (((music->stop - music->start) * music->adpcm_state.samplesperblock) / music->adpcm_state.blocksize);
     } else {
         samples = (music->stop - music->start) / music->samplesize;
@@ -1486,6 +1621,20 @@ static SDL_bool ParseDATA(WAV_Music *wave, Uint32 chunk_length)
     return SDL_TRUE;
 }
 
+static SDL_bool ParseFACT(WAV_Music *wave, Uint32 chunk_length)
+{
+    Sint64 next = SDL_RWtell(wave->src) + chunk_length;
+    Uint32 frames;
+
+    /* The number of sample frames, for compressed data */
+    if (chunk_length >= 4 && SDL_ReadU32LE(wave->src, &frames)) {
+        wave->fact_frames = frames;
+    }
+    if (SDL_RWseek(wave->src, next, SDL_RW_SEEK_SET) < 0)
+        return SDL_FALSE;
+    return SDL_TRUE;
+}
+
 static SDL_bool AddLoopPoint(WAV_Music *wave, Uint32 play_count, Uint32 start, Uint32 stop)
 {
     WAVLoopPoint *loop;
@@ -1682,6 +1831,10 @@ static SDL_bool LoadWAVMusic(WAV_Music *wave)
             if (!ParseLIST(wave, chunk_length))
                 return SDL_FALSE;
             break;
+        case FACT:
+            if (!ParseFACT(wave, chunk_length))
+                return SDL_FALSE;
+            break;
         case ID3_:
             if (!ParseID3(wave, chunk_length))
                 return SDL_FALSE;
@@ -1709,6 +1862,18 @@ static SDL_bool LoadWAVMusic(WAV_Music *wave)
         return SDL_FALSE;
     }
 
+    /* Only trust the 'fact' chunk of ADPCM data if it ends in the last block */
+    if (wave->encoding == MS_ADPCM_CODE || wave->encoding == IMA_ADPCM_CODE) {
+        const Sint64 blocksize = (Sint64)wave->adpcm_state.blocksize;
+        const Sint64 samplesperblock = (Sint64)wave->adpcm_state.samplesperblock;
+        const Sint64 frames = ((wave->stop - wave->start + blocksize - 1) / blocksize) * samplesperblock;
+        if ((Sint64)wave->fact_frames <= frames - samplesperblock || (Sint64)wave->fact_frames > frames) {
+            wave->fact_frames = 0;
+        }
+    } else {
+        wave->fact_frames = 0;
+    }
+
     return SDL_TRUE;
 }
 
@@ -25,4 +25,11 @@
 
 extern Mix_MusicInterface Mix_MusicInterface_WAV;
 
+/* Bytes per channel in an IMA ADPCM block made by WAV_EncodeIMAADPCM() */
+#define IMA_ADPCM_ENCODE_BLOCK  256
+
+/* Encode native endian S16 samples into an IMA ADPCM WAV file in memory,
+   for SDL_MIXER_HINT_COMPACT_CHUNKS. The file is freed with SDL_free(). */
+extern void *WAV_EncodeIMAADPCM(const Sint16 *samples, Uint32 frames, int channels, int freq, size_t *size);
+
 /* vi: set ts=4 sw=4 expandtab: */
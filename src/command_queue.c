@@ -0,0 +1,185 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+/* Commands submitted with Mix_SubmitCommands().
+ *
+ * This is a bounded ring in the style of Dmitry Vyukov's MPMC queue: every
+ * slot carries a sequence number that says whether it is free for the
+ * position a producer wants to write, or holds the position the consumer
+ * wants to read next. Producers claim a run of slots for a whole batch
+ * with one compare-and-swap on the write position, fill them in, and then
+ * publish them last-to-first, so the consumer, which stops at the first
+ * unpublished slot, sees either all of a batch or none of it.
+ *
+ * Producers don't take the audio lock, so closing the queue clears
+ * 'queue_open' and then waits for the producers already inside
+ * _Mix_PushCommands() to leave before freeing the slots. Whatever they
+ * queued after the mixer last ran the commands is failed then, so that
+ * nobody waits forever for its callback.
+ */
+
+#include <SDL3/SDL.h>
+
+#include "command_queue.h"
+
+/* Must be a power of two */
+#define MIX_COMMAND_QUEUE_SIZE  1024
+
+typedef struct
+{
+    SDL_AtomicInt sequence;
+    Mix_Command command;
+    int index;
+    Mix_CommandDone_t callback;
+    void *udata;
+} CommandSlot;
+
+static CommandSlot *slots = NULL;
+static SDL_AtomicInt write_pos;
+static Uint32 read_pos = 0;     /* only touched by the consumer */
+static SDL_AtomicInt queue_open;
+static SDL_AtomicInt producers;
+
+
+int _Mix_InitCommandQueue(void)
+{
+    int i;
+
+    if (!slots) {
+        slots = (CommandSlot *)SDL_calloc(MIX_COMMAND_QUEUE_SIZE, sizeof(*slots));
+        if (!slots) {
+            return Mix_OutOfMemory();
+        }
+    }
+    for (i = 0; i < MIX_COMMAND_QUEUE_SIZE; ++i) {
+        SDL_AtomicSet(&slots[i].sequence, i);
+    }
+    SDL_AtomicSet(&write_pos, 0);
+    read_pos = 0;
+    SDL_AtomicSet(&queue_open, 1);
+    return 0;
+}
+
+void _Mix_QuitCommandQueue(void)
+{
+    Mix_Command command;
+    Mix_CommandDone_t callback;
+    void *udata;
+    int index;
+
+    SDL_AtomicSet(&queue_open, 0);
+    while (SDL_AtomicGet(&producers) > 0) {
+        SDL_Delay(1);
+    }
+    while (_Mix_PopCommand(&command, &index, &callback, &udata)) {
+        if (callback) {
+            Mix_SetError("The audio device was closed before the command ran");
+            callback(udata, index, -1);
+        }
+    }
+    SDL_free(slots);
+    slots = NULL;
+}
+
+static int push_commands(const Mix_Command *commands, int count, Mix_CommandDone_t callback, void *udata)
+{
+    Uint32 pos;
+    int i;
+
+    if (count > MIX_COMMAND_QUEUE_SIZE) {
+        return Mix_SetError("Too many commands in one batch (at most %d)", MIX_COMMAND_QUEUE_SIZE);
+    }
+
+    for (;;) {
+        Uint32 last;
+        Sint32 diff;
+
+        pos = (Uint32)SDL_AtomicGet(&write_pos);
+        last = pos + (Uint32)count - 1;
+        /* The consumer frees slots in order, so if the last slot of the run
+           is free for us, all of the ones before it are too. */
+        diff = (Sint32)((Uint32)SDL_AtomicGet(&slots[last & (MIX_COMMAND_QUEUE_SIZE - 1)].sequence) - last);
+        if (diff < 0) {
+            return Mix_SetError("Command queue is full");
+        }
+        if (diff == 0 && SDL_AtomicCAS(&write_pos, (int)pos, (int)(pos + (Uint32)count))) {
+            break;
+        }
+        /* Another producer got there first, try again */
+    }
+
+    for (i = 0; i < count; ++i) {
+        CommandSlot *slot = &slots[(pos + (Uint32)i) & (MIX_COMMAND_QUEUE_SIZE - 1)];
+        slot->command = commands[i];
+        slot->index = i;
+        slot->callback = callback;
+        slot->udata = udata;
+    }
+    for (i = count - 1; i >= 0; --i) {
+        Uint32 p = pos + (Uint32)i;
+        SDL_AtomicSet(&slots[p & (MIX_COMMAND_QUEUE_SIZE - 1)].sequence, (int)(p + 1));
+    }
+    return 0;
+}
+
+int _Mix_PushCommands(const Mix_Command *commands, int count, Mix_CommandDone_t callback, void *udata)
+{
+    int retval;
+
+    /* Announce ourselves before looking at 'queue_open', so that either we
+       see the queue closed or _Mix_QuitCommandQueue() waits for us. */
+    SDL_AtomicAdd(&producers, 1);
+    if (!SDL_AtomicGet(&queue_open)) {
+        retval = Mix_SetError("Audio device hasn't been opened");
+    } else if (count <= 0) {
+        retval = 0;
+    } else {
+        retval = push_commands(commands, count, callback, udata);
+    }
+    SDL_AtomicAdd(&producers, -1);
+    return retval;
+}
+
+SDL_bool _Mix_PopCommand(Mix_Command *command, int *index, Mix_CommandDone_t *callback, void **udata)
+{
+    CommandSlot *slot;
+
+    if (!slots) {
+        return SDL_FALSE;
+    }
+    slot = &slots[read_pos & (MIX_COMMAND_QUEUE_SIZE - 1)];
+    if ((Uint32)SDL_AtomicGet(&slot->sequence) != read_pos + 1) {
+        return SDL_FALSE;
+    }
+
+    *command = slot->command;
+    *index = slot->index;
+    *callback = slot->callback;
+    *udata = slot->udata;
+
+    /* Hand the slot back for the producer one lap ahead */
+    SDL_AtomicSet(&slot->sequence, (int)(read_pos + MIX_COMMAND_QUEUE_SIZE));
+    ++read_pos;
+    return SDL_TRUE;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,49 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef COMMAND_QUEUE_H_
+#define COMMAND_QUEUE_H_
+
+/* A bounded lock-free queue of Mix_Command batches.
+ *
+ * Any thread may push without taking the audio lock; only one thread may
+ * pop at a time, which the mixer guarantees by popping with the audio lock
+ * held (normally from inside the audio callback).
+ */
+
+#include <SDL3_mixer/SDL_mixer.h>
+
+extern int _Mix_InitCommandQueue(void);
+/* Close the queue, reporting -1 for every command still in it */
+extern void _Mix_QuitCommandQueue(void);
+
+/* Queue the whole batch, or nothing if there isn't room for all of it */
+extern int _Mix_PushCommands(const Mix_Command *commands, int count, Mix_CommandDone_t callback, void *udata);
+
+/* Take the oldest queued command; returns SDL_FALSE if the queue is empty.
+ * A batch only becomes visible here once all of it has been queued.
+ */
+extern SDL_bool _Mix_PopCommand(Mix_Command *command, int *index, Mix_CommandDone_t *callback, void **udata);
+
+#endif /* COMMAND_QUEUE_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
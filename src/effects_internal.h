@@ -28,6 +28,8 @@
 
 #include <SDL3_mixer/SDL_mixer.h>
 
+#include "rt_check.h"
+
 extern int _Mix_effects_max_speed;
 extern void *_Eff_volume_table;
 void *_Eff_build_volume_table_u8(void);
@@ -0,0 +1,147 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define MIX_HAVE_MMAP
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(_WIN32)
+
+const Uint8 *_Mix_MapFile(const char *file, size_t *size)
+{
+    WCHAR *wfile;
+    HANDLE handle, mapping;
+    LARGE_INTEGER filesize;
+    void *data;
+
+    wfile = (WCHAR *)SDL_iconv_string("UTF-16LE", "UTF-8", file, SDL_strlen(file) + 1);
+    if (!wfile) {
+        Mix_OutOfMemory();
+        return NULL;
+    }
+    handle = CreateFileW(wfile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    SDL_free(wfile);
+    if (handle == INVALID_HANDLE_VALUE) {
+        Mix_SetError("Couldn't open %s", file);
+        return NULL;
+    }
+    if (!GetFileSizeEx(handle, &filesize) || filesize.QuadPart <= 0 ||
+        (Uint64)filesize.QuadPart > (Uint64)SDL_SIZE_MAX) {
+        CloseHandle(handle);
+        Mix_SetError("Couldn't map %s: bad file size", file);
+        return NULL;
+    }
+    mapping = CreateFileMappingW(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle);
+    if (!mapping) {
+        Mix_SetError("Couldn't map %s", file);
+        return NULL;
+    }
+    /* The view keeps the mapping alive */
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        Mix_SetError("Couldn't map %s", file);
+        return NULL;
+    }
+    *size = (size_t)filesize.QuadPart;
+    return (const Uint8 *)data;
+}
+
+void _Mix_UnmapFile(const Uint8 *data, size_t size)
+{
+    (void)size;
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+}
+
+#elif defined(MIX_HAVE_MMAP)
+
+const Uint8 *_Mix_MapFile(const char *file, size_t *size)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        Mix_SetError("Couldn't open %s: %s", file, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size <= 0 ||
+        (Uint64)st.st_size > (Uint64)SDL_SIZE_MAX) {
+        close(fd);
+        Mix_SetError("Couldn't map %s: bad file size", file);
+        return NULL;
+    }
+    /* Shared, so every process mapping the file reads the same pages */
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        Mix_SetError("Couldn't map %s: %s", file, strerror(errno));
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return (const Uint8 *)data;
+}
+
+void _Mix_UnmapFile(const Uint8 *data, size_t size)
+{
+    if (data) {
+        munmap((void *)data, size);
+    }
+}
+
+#else
+
+const Uint8 *_Mix_MapFile(const char *file, size_t *size)
+{
+    (void)file;
+    (void)size;
+    Mix_SetError("Memory mapped files aren't supported on this platform");
+    return NULL;
+}
+
+void _Mix_UnmapFile(const Uint8 *data, size_t size)
+{
+    (void)data;
+    (void)size;
+}
+
+#endif
+
+/* vi: set ts=4 sw=4 expandtab: */
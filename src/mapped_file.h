@@ -0,0 +1,41 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+/* Read-only memory mapping of whole files, for Mix_LoadWAVMapped().
+ * Pages are read from disk as they're first touched, and are shared with
+ * every other process that maps the same file.
+ */
+
+#include <SDL3/SDL_stdinc.h>
+
+/* Map 'file' read-only, returning its contents and size, or NULL with the
+ * error set if it can't be mapped (or this platform can't map files).
+ */
+extern const Uint8 *_Mix_MapFile(const char *file, size_t *size);
+extern void _Mix_UnmapFile(const Uint8 *data, size_t size);
+
+#endif /* MAPPED_FILE_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -24,6 +24,18 @@
 #include <SDL3_mixer/SDL_mixer.h>
 #include "mixer.h"
 #include "music.h"
+#include "channel_index.h"
+#include "command_queue.h"
+#include "perf_stats.h"
+#include "rt_check.h"
+#include "chunk_cache.h"
+#include "async_load.h"
+#include "mapped_file.h"
+#include "pcm_cache.h"
+#include "music_ahead.h"
+#ifdef MUSIC_WAV
+#include "music_wav.h"
+#endif
 #include "load_aiff.h"
 #include "load_voc.h"
 #include "load_sndfile.h"
@@ -62,11 +74,48 @@ SDL_COMPILE_TIME_ASSERT(SDL_MIXER_PATCHLEVEL_max, SDL_MIXER_PATCHLEVEL <= 99);
 
 static int audio_opened = 0;
 static SDL_AudioSpec mixer;
+static SDL_AudioSpec mixer_output;
+static SDL_bool float_mixing = SDL_FALSE;
+static SDL_bool realtime = SDL_FALSE;
 static SDL_AudioDeviceID audio_device;
 static SDL_AudioStream *audio_stream;
+static SDL_bool headless = SDL_FALSE;
+static Uint64 rendered_frames = 0;
+static Uint64 mixed_frames = 0;     /* the clock for timed commands */
 static Uint8 *audio_mixbuf;
+static Uint8 *audio_effectbuf;
 static int audio_mixbuflen;
 
+/* SDL_MIXER_HINT_MIX_AHEAD: a thread mixes into the audio stream, keeping
+   'mix_ahead_bytes' queued for the device, instead of the stream's callback.
+   The stream's lock is then only held to copy out of it, so the audio lock
+   is a mutex of its own. */
+static SDL_Mutex *mix_ahead_lock = NULL;
+static SDL_Thread *mix_ahead_thread = NULL;
+static SDL_AtomicInt mix_ahead_quit;
+static int mix_ahead_bytes = 0;
+static int mix_ahead_block = 0;
+static Uint32 mix_ahead_poll_ms = 0;
+
+/* Queued commands with a frame to run at, soonest first */
+#define MIX_MAX_TIMED_COMMANDS  256
+
+typedef struct
+{
+    Mix_Command command;
+    int index;
+    Mix_CommandDone_t callback;
+    void *udata;
+} TimedCommand;
+
+static TimedCommand timed_commands[MIX_MAX_TIMED_COMMANDS];
+static int num_timed_commands = 0;
+
+/* Music commands that came due in the mixer while the decode ahead thread
+   held the decoder lock, waiting for a later block, oldest first */
+static TimedCommand deferred_commands[MIX_MAX_TIMED_COMMANDS];
+static int num_deferred_commands = 0;
+
 
 typedef struct _Mix_effectinfo
 {
@@ -76,13 +125,23 @@ typedef struct _Mix_effectinfo
     struct _Mix_effectinfo *next;
 } effect_info;
 
-static struct _Mix_Channel {
+/* The per-channel state the mixing loop touches on every callback is kept
+   in its own array, so the playing voices stay within a few cache lines. */
+static struct _Mix_Voice {
     Mix_Chunk *chunk;
-    int playing;
-    Uint64 paused;
+    Uint8 *start;       /* the region of the chunk being played, and looped */
+    int length;
     Uint8 *samples;
-    int volume;
+    int playing;
     int looping;
+    int volume;
+    float rate;         /* playback rate, 1.0 for normal speed */
+    Uint32 frac;        /* 16.16 fixed point position within the frame at 'samples' */
+    void *decoder;      /* decodes a compressed chunk, instead of 'samples' */
+} *mix_voice = NULL;
+
+static struct _Mix_Channel {
+    Uint64 paused;
     int tag;
     Uint64 expire;
     Uint64 start_time;
@@ -91,9 +150,53 @@ static struct _Mix_Channel {
     int fade_volume_reset;
     Uint64 fade_length;
     Uint64 ticks_fade;
+    SDL_bool finished;      /* finished on a mix worker, not reported yet */
     effect_info *effects;
 } *mix_channel = NULL;
 
+/* Chunks that aren't plain PCM in the mixer's format are one of these, with
+   flags in 'allocated' saying what's different about them (see mixer.h).
+   Chunks the app puts together itself are always plain. */
+typedef struct
+{
+    Mix_Chunk chunk;
+    int freq;                       /* MIX_CHUNK_NATIVE_RATE: the sample rate of abuf */
+    Mix_MusicInterface *interface;  /* MIX_CHUNK_COMPRESSED: what decodes abuf */
+    const Uint8 *map;               /* MIX_CHUNK_MAPPED: the file abuf points into */
+    size_t map_size;
+} Mix_ChunkExt;
+
+/* The fastest a chunk can be played back relative to its own rate */
+#define MIX_MAX_PLAYBACK_RATE   16.0f
+
+/* The most frames mixed in one go by Mix_RenderAudio() or in realtime mode,
+   matching what open_music() assumes a device asks for */
+#define MIX_BLOCK_FRAMES    4096
+
+/* Parallel mixing */
+#define MIX_MAX_WORKERS             16
+#define MIX_MIN_VOICES_PER_WORKER   8
+
+typedef struct
+{
+    SDL_Thread *thread;
+    SDL_Semaphore *start;
+    Uint8 *bus;                 /* this worker's share of the mix */
+    Uint8 *scratch;             /* effect output */
+    int buflen;
+    const int *voices;
+    int num_voices;
+    int len;
+    int master_vol;
+    SDL_bool measure;           /* add up effect time for the perf counters */
+    Uint64 effect_time;
+} MixWorker;
+
+static MixWorker *mix_workers = NULL;
+static int num_mix_workers = 0;
+static SDL_Semaphore *mix_workers_done = NULL;
+static SDL_AtomicInt mix_workers_quit;
+
 static effect_info *posteffects = NULL;
 
 static int num_channels;
@@ -291,6 +394,58 @@ void Mix_Quit(void)
 
 static int _Mix_remove_all_effects(int channel, effect_info **e);
 
+/* The clock for channel fades and expiry, in milliseconds.
+   Without a device this is the amount of audio rendered so far, offset by
+   one because a paused time of 0 means the channel isn't paused. */
+static Uint64 mixer_ticks(void)
+{
+    if (headless) {
+        return 1 + (rendered_frames * 1000) / (Uint64)mixer.freq;
+    }
+    return SDL_GetTicks();
+}
+
+/* A compressed chunk gets a decoder of its own every time it's played */
+static void *start_chunk_decoder(Mix_Chunk *chunk, int loops)
+{
+    Mix_MusicInterface *interface = ((Mix_ChunkExt *)chunk)->interface;
+    SDL_RWops *src;
+    void *decoder;
+
+    if (!interface->opened) {
+        Mix_SetError("%s decoder isn't open", interface->tag);
+        return NULL;
+    }
+    src = SDL_RWFromConstMem(chunk->abuf, chunk->alen);
+    if (!src) {
+        return NULL;
+    }
+    decoder = interface->CreateFromRW(src, SDL_TRUE);
+    if (!decoder) {
+        return NULL;
+    }
+    if (interface->Play && interface->Play(decoder, (loops < 0) ? -1 : (loops + 1)) < 0) {
+        interface->Delete(decoder);
+        return NULL;
+    }
+    return decoder;
+}
+
+static void stop_chunk_decoder(int channel)
+{
+    void *decoder = mix_voice[channel].decoder;
+
+    if (decoder) {
+        Mix_MusicInterface *interface = ((Mix_ChunkExt *)mix_voice[channel].chunk)->interface;
+
+        mix_voice[channel].decoder = NULL;
+        if (interface->Stop) {
+            interface->Stop(decoder);
+        }
+        interface->Delete(decoder);
+    }
+}
+
 /*
  * rcg06122001 Cleanup effect callbacks.
  *  MAKE SURE Mix_LockAudio() is called before this (or you're in the
@@ -298,6 +453,11 @@ static int _Mix_remove_all_effects(int channel, effect_info **e);
  */
 static void _Mix_channel_done_playing(int channel)
 {
+    /* Free the channel first, the callback may start a new sound on it */
+    stop_chunk_decoder(channel);
+    mix_channel[channel].finished = SDL_FALSE;
+    _Mix_ChannelStopped(channel);
+
     if (channel_done_callback) {
         channel_done_callback(channel);
     }
@@ -310,20 +470,25 @@ static void _Mix_channel_done_playing(int channel)
 }
 
 
-static void *Mix_DoEffects(int chan, void *snd, int len)
+/* 'scratch' must hold at least 'len' bytes; channel effects work on a copy
+   of the samples there, so the chunk itself is never modified. Samples that
+   are already in 'scratch' are worked on in place.
+   If 'effect_time' isn't NULL, the time spent in effects is added to it. */
+static void *Mix_DoEffects(int chan, void *snd, int len, void *scratch, Uint64 *effect_time)
 {
     int posteffect = (chan == MIX_CHANNEL_POST);
     effect_info *e = ((posteffect) ? posteffects : mix_channel[chan].effects);
     void *buf = snd;
 
     if (e != NULL) {    /* are there any registered effects? */
+        Uint64 start = effect_time ? SDL_GetPerformanceCounter() : 0;
+
         /* if this is the postmix, we can just overwrite the original. */
         if (!posteffect) {
-            buf = SDL_malloc((size_t)len);
-            if (buf == NULL) {
-                return snd;
+            buf = scratch;
+            if (buf != snd) {
+                SDL_memcpy(buf, snd, (size_t)len);
             }
-            SDL_memcpy(buf, snd, (size_t)len);
         }
 
         for (; e != NULL; e = e->next) {
@@ -331,336 +496,1374 @@ static void *Mix_DoEffects(int chan, void *snd, int len)
                 e->callback(chan, buf, len, e->udata);
             }
         }
+
+        if (effect_time) {
+            *effect_time += SDL_GetPerformanceCounter() - start;
+        }
     }
 
-    /* be sure to SDL_free() the return value if != snd ... */
     return buf;
 }
 
 
-/* Mixing function */
-static void SDLCALL
-mix_channels(void *udata, SDL_AudioStream *astream, int len, int total)
+/* Add float samples to the mix bus without clipping.
+   The bus is clamped once, after the postmix callback has run. */
+static void mix_float32(float *dst, const float *src, int samples, int volume)
 {
-    Uint8 *stream;
-    Uint8 *mix_input;
-    int i, mixable, master_vol;
-    Uint64 sdl_ticks;
-
-    (void)udata;
-    (void)total;
+    int i;
 
-    if (audio_mixbuflen < len) {
-        void *ptr = SDL_aligned_alloc(SDL_SIMDGetAlignment(), len);
-        if (!ptr) {
-            return;  // oh well.
+    if (volume == MIX_MAX_VOLUME) {
+        for (i = 0; i < samples; ++i) {
+            dst[i] += src[i];
+        }
+    } else {
+        const float fvolume = (float)volume / MIX_MAX_VOLUME;
+        for (i = 0; i < samples; ++i) {
+            dst[i] += src[i] * fvolume;
         }
-        SDL_aligned_free(audio_mixbuf);
-        audio_mixbuf = (Uint8 *) ptr;
-        audio_mixbuflen = len;
     }
+}
 
-    stream = audio_mixbuf;
+static void clamp_float32(float *buf, int samples)
+{
+    int i;
 
-    /* Need to initialize the stream in SDL 1.3+ */
-    SDL_memset(stream, SDL_GetSilenceValueForFormat(mixer.format), (size_t)len);
+    for (i = 0; i < samples; ++i) {
+        if (buf[i] > 1.0f) {
+            buf[i] = 1.0f;
+        } else if (buf[i] < -1.0f) {
+            buf[i] = -1.0f;
+        }
+    }
+}
 
-    /* Mix the music (must be done before the channels are added) */
-    mix_music(music_data, stream, len);
+static void mix_audio(Uint8 *dst, const Uint8 *src, int len, int volume)
+{
+    if (float_mixing) {
+        mix_float32((float *)dst, (const float *)src, len / (int)sizeof(float), volume);
+    } else {
+        SDL_MixAudioFormat(dst, src, mixer.format, (Uint32)len, volume);
+    }
+}
 
-    master_vol = SDL_AtomicGet(&master_volume);
+/* Run one command and report its result */
+static void run_command(const Mix_Command *cmd, int index, Mix_CommandDone_t callback, void *udata)
+{
+    int result = 0;
 
-    /* Mix any playing channels... */
-    sdl_ticks = SDL_GetTicks();
-    for (i = 0; i < num_channels; ++i) {
-        if (!mix_channel[i].paused) {
-            if (mix_channel[i].expire > 0 && mix_channel[i].expire < sdl_ticks) {
-                /* Expiration delay for that channel is reached */
-                mix_channel[i].playing = 0;
-                mix_channel[i].looping = 0;
-                mix_channel[i].fading = MIX_NO_FADING;
-                mix_channel[i].expire = 0;
-                _Mix_channel_done_playing(i);
-            } else if (mix_channel[i].fading != MIX_NO_FADING) {
-                Uint64 ticks = sdl_ticks - mix_channel[i].ticks_fade;
-                if (ticks >= mix_channel[i].fade_length) {
-                    Mix_Volume(i, mix_channel[i].fade_volume_reset); /* Restore the volume */
-                    if (mix_channel[i].fading == MIX_FADING_OUT) {
-                        mix_channel[i].playing = 0;
-                        mix_channel[i].looping = 0;
-                        mix_channel[i].expire = 0;
-                        _Mix_channel_done_playing(i);
-                    }
-                    mix_channel[i].fading = MIX_NO_FADING;
-                } else {
-                    if (mix_channel[i].fading == MIX_FADING_OUT) {
-                        int volume = (int)((mix_channel[i].fade_volume * (mix_channel[i].fade_length - ticks)) / mix_channel[i].fade_length);
-                        Mix_Volume(i, volume);
-                    } else {
-                        int volume = (int)((mix_channel[i].fade_volume * ticks) / mix_channel[i].fade_length);
-                        Mix_Volume(i, volume);
-                    }
-                }
-            }
-            if (mix_channel[i].playing > 0) {
-                int volume = (master_vol * (mix_channel[i].volume * mix_channel[i].chunk->volume)) / (MIX_MAX_VOLUME * MIX_MAX_VOLUME);
-                int index = 0;
-                int remaining = len;
-                while (mix_channel[i].playing > 0 && index < len) {
-                    remaining = len - index;
-                    mixable = mix_channel[i].playing;
-                    if (mixable > remaining) {
-                        mixable = remaining;
-                    }
-
-                    mix_input = Mix_DoEffects(i, mix_channel[i].samples, mixable);
-                    SDL_MixAudioFormat(stream+index, mix_input, mixer.format, mixable, volume);
-                    if (mix_input != mix_channel[i].samples)
-                        SDL_free(mix_input);
-
-                    mix_channel[i].samples += mixable;
-                    mix_channel[i].playing -= mixable;
-                    index += mixable;
-
-                    /* rcg06072001 Alert app if channel is done playing. */
-                    if (!mix_channel[i].playing && !mix_channel[i].looping) {
-                        mix_channel[i].fading = MIX_NO_FADING;
-                        mix_channel[i].expire = 0;
-                        _Mix_channel_done_playing(i);
-
-                        /* Update the volume after the application callback */
-                        volume = (master_vol * (mix_channel[i].volume * mix_channel[i].chunk->volume)) / (MIX_MAX_VOLUME * MIX_MAX_VOLUME);
-                    }
-                }
+    switch (cmd->type) {
+    case MIX_COMMAND_PLAY_CHANNEL:
+        if (cmd->ms > 0) {
+            result = Mix_FadeInChannelTimed(cmd->channel, cmd->chunk, cmd->loops, cmd->ms, cmd->ticks);
+        } else {
+            result = Mix_PlayChannelTimed(cmd->channel, cmd->chunk, cmd->loops, cmd->ticks);
+        }
+        break;
+    case MIX_COMMAND_HALT_CHANNEL:
+        result = Mix_HaltChannel(cmd->channel);
+        break;
+    case MIX_COMMAND_EXPIRE_CHANNEL:
+        result = Mix_ExpireChannel(cmd->channel, cmd->ticks);
+        break;
+    case MIX_COMMAND_FADE_OUT_CHANNEL:
+        result = Mix_FadeOutChannel(cmd->channel, cmd->ms);
+        break;
+    case MIX_COMMAND_PAUSE_CHANNEL:
+        Mix_Pause(cmd->channel);
+        break;
+    case MIX_COMMAND_RESUME_CHANNEL:
+        Mix_Resume(cmd->channel);
+        break;
+    case MIX_COMMAND_VOLUME_CHANNEL:
+        result = Mix_Volume(cmd->channel, cmd->volume);
+        break;
+    case MIX_COMMAND_PLAYBACK_RATE_CHANNEL:
+        result = Mix_SetChannelPlaybackRate(cmd->channel, cmd->rate);
+        break;
+    case MIX_COMMAND_VOLUME_MUSIC:
+        result = Mix_VolumeMusic(cmd->volume);
+        break;
+    case MIX_COMMAND_PAUSE_MUSIC:
+        Mix_PauseMusic();
+        break;
+    case MIX_COMMAND_RESUME_MUSIC:
+        Mix_ResumeMusic();
+        break;
+    case MIX_COMMAND_HALT_MUSIC:
+        result = Mix_HaltMusic();
+        break;
+    case MIX_COMMAND_FADE_OUT_MUSIC:
+        result = Mix_FadeOutMusic(cmd->ms);
+        break;
+    case MIX_COMMAND_PLAY_MUSIC_STREAM:
+        result = Mix_FadeInMusicStream(cmd->channel, cmd->music, cmd->loops, cmd->ms);
+        break;
+    case MIX_COMMAND_FADE_OUT_MUSIC_STREAM:
+        result = Mix_FadeOutMusicStream(cmd->channel, cmd->ms);
+        break;
+    case MIX_COMMAND_HALT_MUSIC_STREAM:
+        result = Mix_HaltMusicStream(cmd->channel);
+        break;
+    case MIX_COMMAND_VOLUME_MUSIC_STREAM:
+        result = Mix_VolumeMusicStream(cmd->channel, cmd->volume);
+        break;
+    default:
+        result = Mix_SetError("Unknown command type %d", (int)cmd->type);
+        break;
+    }
+    if (callback) {
+        callback(udata, index, result);
+    }
+}
+
+/* Whether a command runs music functions that take the decoder lock */
+static SDL_bool command_uses_music_decoder(Mix_CommandType type)
+{
+    switch (type) {
+    case MIX_COMMAND_PAUSE_MUSIC:
+    case MIX_COMMAND_RESUME_MUSIC:
+    case MIX_COMMAND_HALT_MUSIC:
+    case MIX_COMMAND_FADE_OUT_MUSIC:
+        return SDL_TRUE;
+    default:
+        return SDL_FALSE;
+    }
+}
+
+/* Whether a command acts on the music or a music stream */
+static SDL_bool is_music_command(Mix_CommandType type)
+{
+    switch (type) {
+    case MIX_COMMAND_VOLUME_MUSIC:
+    case MIX_COMMAND_PLAY_MUSIC_STREAM:
+    case MIX_COMMAND_FADE_OUT_MUSIC_STREAM:
+    case MIX_COMMAND_HALT_MUSIC_STREAM:
+    case MIX_COMMAND_VOLUME_MUSIC_STREAM:
+        return SDL_TRUE;
+    default:
+        return command_uses_music_decoder(type);
+    }
+}
+
+/* Run a command in the mixer, which mustn't wait for the decode ahead
+   thread. Returns SDL_FALSE, without running it, if the command needs the
+   decoder lock and that's busy. */
+static SDL_bool try_run_command(const Mix_Command *cmd, int index, Mix_CommandDone_t callback, void *udata)
+{
+    if (!command_uses_music_decoder(cmd->type)) {
+        run_command(cmd, index, callback, udata);
+        return SDL_TRUE;
+    }
+    if (!_Mix_TryLockMusicDecoder()) {
+        return SDL_FALSE;
+    }
+    run_command(cmd, index, callback, udata);
+    _Mix_UnlockMusicDecoder();
+    return SDL_TRUE;
+}
+
+/* Run a command that's due. In the mixer, a music command that can't have
+   the decoder lock waits for the next block instead, and so do the music
+   commands after it, so they still run in the order given. */
+static void dispatch_command(const Mix_Command *cmd, int index, Mix_CommandDone_t callback, void *udata, SDL_bool mixing)
+{
+    if (!mixing || !is_music_command(cmd->type)) {
+        run_command(cmd, index, callback, udata);
+        return;
+    }
+    if (num_deferred_commands == 0 && try_run_command(cmd, index, callback, udata)) {
+        return;
+    }
+    if (num_deferred_commands == MIX_MAX_TIMED_COMMANDS) {
+        Mix_SetError("Too many music commands waiting (max %d)", MIX_MAX_TIMED_COMMANDS);
+        if (callback) {
+            callback(udata, index, -1);
+        }
+        return;
+    }
+    deferred_commands[num_deferred_commands].command = *cmd;
+    deferred_commands[num_deferred_commands].index = index;
+    deferred_commands[num_deferred_commands].callback = callback;
+    deferred_commands[num_deferred_commands].udata = udata;
+    ++num_deferred_commands;
+}
+
+/* Run the music commands that were waiting for the decoder lock, as far as
+   the mixer can have it.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void run_deferred_commands(SDL_bool mixing)
+{
+    while (num_deferred_commands > 0) {
+        TimedCommand deferred = deferred_commands[0];
+        SDL_bool locked = SDL_FALSE;
 
-                /* If looping the sample and we are at its end, make sure
-                   we will still return a full buffer */
-                while (mix_channel[i].looping && index < len) {
-                    int alen = mix_channel[i].chunk->alen;
-                    remaining = len - index;
-                    if (remaining > alen) {
-                        remaining = alen;
-                    }
-
-                    mix_input = Mix_DoEffects(i, mix_channel[i].chunk->abuf, remaining);
-                    SDL_MixAudioFormat(stream+index, mix_input, mixer.format, remaining, volume);
-                    if (mix_input != mix_channel[i].chunk->abuf)
-                        SDL_free(mix_input);
-
-                    if (mix_channel[i].looping > 0) {
-                        --mix_channel[i].looping;
-                    }
-                    mix_channel[i].samples = mix_channel[i].chunk->abuf + remaining;
-                    mix_channel[i].playing = mix_channel[i].chunk->alen - remaining;
-                    index += remaining;
-                }
-                if (! mix_channel[i].playing && mix_channel[i].looping) {
-                    if (mix_channel[i].looping > 0) {
-                        --mix_channel[i].looping;
-                    }
-                    mix_channel[i].samples = mix_channel[i].chunk->abuf;
-                    mix_channel[i].playing = mix_channel[i].chunk->alen;
-                }
+        if (mixing && command_uses_music_decoder(deferred.command.type)) {
+            if (!_Mix_TryLockMusicDecoder()) {
+                return;
             }
+            locked = SDL_TRUE;
+        }
+        --num_deferred_commands;
+        SDL_memmove(&deferred_commands[0], &deferred_commands[1], num_deferred_commands * sizeof(deferred_commands[0]));
+        run_command(&deferred.command, deferred.index, deferred.callback, deferred.udata);
+        if (locked) {
+            _Mix_UnlockMusicDecoder();
         }
     }
+}
 
-    /* rcg06122001 run posteffects... */
-    Mix_DoEffects(MIX_CHANNEL_POST, stream, len);
+/* Hold on to a command until the mix reaches its frame.
+   If there's no room, the command is dropped and reports -1 instead. */
+static void add_timed_command(const Mix_Command *cmd, int index, Mix_CommandDone_t callback, void *udata)
+{
+    int i;
 
-    if (mix_postmix) {
-        mix_postmix(mix_postmix_data, stream, len);
+    if (num_timed_commands == MIX_MAX_TIMED_COMMANDS) {
+        Mix_SetError("Too many timed commands waiting (max %d)", MIX_MAX_TIMED_COMMANDS);
+        if (callback) {
+            callback(udata, index, -1);
+        }
+        return;
     }
 
-    SDL_PutAudioStreamData(astream, audio_mixbuf, len);
+    /* After any others for the same frame, so they run in the order given */
+    for (i = num_timed_commands; i > 0 && timed_commands[i - 1].command.frame > cmd->frame; --i) {
+        timed_commands[i] = timed_commands[i - 1];
+    }
+    timed_commands[i].command = *cmd;
+    timed_commands[i].index = index;
+    timed_commands[i].callback = callback;
+    timed_commands[i].udata = udata;
+    ++num_timed_commands;
 }
 
-#if 0
-static void PrintFormat(char *title, SDL_AudioSpec *fmt)
+/* Run the timed commands due by 'frame', 'mixing' if this is the mixer.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void run_timed_commands(Uint64 frame, SDL_bool mixing)
 {
-    printf("%s: %d bit %s audio (%s) at %u Hz\n", title, (fmt->format&0xFF),
-            (fmt->format&0x8000) ? "signed" : "unsigned",
-            (fmt->channels > 2) ? "surround" :
-            (fmt->channels > 1) ? "stereo" : "mono", fmt->freq);
+    while (num_timed_commands > 0 && timed_commands[0].command.frame <= frame) {
+        TimedCommand timed = timed_commands[0];
+
+        --num_timed_commands;
+        SDL_memmove(&timed_commands[0], &timed_commands[1], num_timed_commands * sizeof(timed_commands[0]));
+        dispatch_command(&timed.command, timed.index, timed.callback, timed.udata, mixing);
+    }
 }
-#endif
 
-/* Open the mixer with a certain desired audio format */
-int Mix_OpenAudio(SDL_AudioDeviceID devid, const SDL_AudioSpec *spec)
+/* Drop the timed commands that would play any of 'count' chunks at 'chunks'.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void cancel_timed_commands(const Mix_Chunk *chunks, int count)
 {
-    int i;
+    int i = 0;
 
-    if (!SDL_WasInit(SDL_INIT_AUDIO)) {
-        if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
-            return -1;
+    while (i < num_timed_commands) {
+        TimedCommand timed = timed_commands[i];
+
+        if (timed.command.type != MIX_COMMAND_PLAY_CHANNEL ||
+            timed.command.chunk < chunks || timed.command.chunk >= chunks + count) {
+            ++i;
+            continue;
+        }
+        --num_timed_commands;
+        SDL_memmove(&timed_commands[i], &timed_commands[i + 1], (num_timed_commands - i) * sizeof(timed_commands[0]));
+        if (timed.callback) {
+            Mix_SetError("The chunk was freed before it could play");
+            timed.callback(timed.udata, timed.index, -1);
         }
     }
+}
 
-    /* If the mixer is already opened, increment open count */
-    if (audio_opened) {
-        if (spec && (spec->format == mixer.format) && (spec->channels == mixer.channels)) {
-            ++audio_opened;
-            return 0;
+/* Drop the timed commands that would play 'music' on a music stream.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void cancel_timed_music_commands(const Mix_Music *music)
+{
+    int i = 0;
+
+    while (i < num_timed_commands) {
+        TimedCommand timed = timed_commands[i];
+
+        if (timed.command.type != MIX_COMMAND_PLAY_MUSIC_STREAM || timed.command.music != music) {
+            ++i;
+            continue;
         }
-        while (audio_opened) {
-            Mix_CloseAudio();
+        --num_timed_commands;
+        SDL_memmove(&timed_commands[i], &timed_commands[i + 1], (num_timed_commands - i) * sizeof(timed_commands[0]));
+        if (timed.callback) {
+            Mix_SetError("The music was freed before it could play");
+            timed.callback(timed.udata, timed.index, -1);
         }
     }
+}
 
-    if (devid == 0) {
-        devid = SDL_AUDIO_DEVICE_DEFAULT_OUTPUT;
-    }
+/* Run everything waiting in the command queue that's due by now, 'mixing'
+   if this is the mixer, which mustn't wait for the decode ahead thread.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void run_commands(SDL_bool mixing)
+{
+    Mix_Command cmd;
+    Mix_CommandDone_t callback;
+    void *udata;
+    int index;
 
-    if ((audio_device = SDL_OpenAudioDevice(devid, spec)) == 0) {
-        return -1;
-    }
+    run_deferred_commands(mixing);
+    run_timed_commands(mixed_frames, mixing);
 
-    SDL_GetAudioDeviceFormat(audio_device, &mixer, NULL);
-    audio_stream = SDL_CreateAudioStream(&mixer, &mixer);
-    if (!audio_stream) {
-        SDL_CloseAudioDevice(audio_device);
-        audio_device = 0;
-        return -1;
+    while (_Mix_PopCommand(&cmd, &index, &callback, &udata)) {
+        if (cmd.frame > mixed_frames) {
+            add_timed_command(&cmd, index, callback, udata);
+        } else {
+            dispatch_command(&cmd, index, callback, udata, mixing);
+        }
     }
+}
 
-    SDL_BindAudioStream(audio_device, audio_stream);
-    SDL_SetAudioStreamGetCallback(audio_stream, mix_channels, NULL);
-
-#if 0
-    PrintFormat("Audio device", &mixer);
-#endif
+/* How much of 'len' bytes can be mixed before the next timed command is due */
+static int bytes_until_timed_command(int len)
+{
+    const int frame_size = (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels;
+    Uint64 frames;
 
-    num_channels = MIX_CHANNELS;
-    mix_channel = (struct _Mix_Channel *) SDL_malloc(num_channels * sizeof(struct _Mix_Channel));
+    if (num_timed_commands == 0) {
+        return len;
+    }
+    frames = timed_commands[0].command.frame - mixed_frames;
+    if (frames >= (Uint64)(len / frame_size)) {
+        return len;
+    }
+    return (int)frames * frame_size;
+}
 
-    /* Clear out the audio channels */
-    for (i = 0; i < num_channels; ++i) {
-        mix_channel[i].chunk = NULL;
-        mix_channel[i].playing = 0;
-        mix_channel[i].looping = 0;
-        mix_channel[i].volume = SDL_MIX_MAXVOLUME;
-        mix_channel[i].fade_volume = SDL_MIX_MAXVOLUME;
-        mix_channel[i].fade_volume_reset = SDL_MIX_MAXVOLUME;
+/* Expire or fade a voice at the start of a callback.
+   This may call back into the app, so it always runs on the audio thread. */
+static void update_voice(int i, Uint64 sdl_ticks)
+{
+    if (mix_channel[i].paused) {
+        return;
+    }
+    if (mix_channel[i].expire > 0 && mix_channel[i].expire < sdl_ticks) {
+        /* Expiration delay for that channel is reached */
+        mix_voice[i].playing = 0;
+        mix_voice[i].looping = 0;
         mix_channel[i].fading = MIX_NO_FADING;
-        mix_channel[i].tag = -1;
         mix_channel[i].expire = 0;
-        mix_channel[i].effects = NULL;
-        mix_channel[i].paused = 0;
+        _Mix_channel_done_playing(i);
+    } else if (mix_channel[i].fading != MIX_NO_FADING) {
+        Uint64 ticks = sdl_ticks - mix_channel[i].ticks_fade;
+        if (ticks >= mix_channel[i].fade_length) {
+            Mix_Volume(i, mix_channel[i].fade_volume_reset); /* Restore the volume */
+            if (mix_channel[i].fading == MIX_FADING_OUT) {
+                mix_voice[i].playing = 0;
+                mix_voice[i].looping = 0;
+                mix_channel[i].expire = 0;
+                _Mix_channel_done_playing(i);
+            }
+            mix_channel[i].fading = MIX_NO_FADING;
+        } else {
+            if (mix_channel[i].fading == MIX_FADING_OUT) {
+                int volume = (int)((mix_channel[i].fade_volume * (mix_channel[i].fade_length - ticks)) / mix_channel[i].fade_length);
+                Mix_Volume(i, volume);
+            } else {
+                int volume = (int)((mix_channel[i].fade_volume * ticks) / mix_channel[i].fade_length);
+                Mix_Volume(i, volume);
+            }
+        }
     }
-    Mix_VolumeMusic(SDL_MIX_MAXVOLUME);
-
-    _Mix_InitEffects();
-
-    add_chunk_decoder("WAVE");
-    add_chunk_decoder("AIFF");
-    add_chunk_decoder("VOC");
-
-    /* Initialize the music players */
-    open_music(&mixer);
-
-    audio_opened = 1;
-    return 0;
 }
 
-/* Pause or resume the audio streaming */
-void Mix_PauseAudio(int pause_on)
+/* A voice ran out of samples and isn't looping */
+static void voice_finished(int i, SDL_bool deferred)
 {
-    if (pause_on) {
-        SDL_PauseAudioDevice(audio_device);
+    mix_channel[i].fading = MIX_NO_FADING;
+    mix_channel[i].expire = 0;
+    if (deferred) {
+        mix_channel[i].finished = SDL_TRUE;
     } else {
-        SDL_ResumeAudioDevice(audio_device);
+        _Mix_channel_done_playing(i);
     }
-    Mix_LockAudio();
-    pause_async_music(pause_on);
-    Mix_UnlockAudio();
 }
 
-/* Dynamically change the number of channels managed by the mixer.
-   If decreasing the number of channels, the upper channels are
-   stopped.
- */
-int Mix_AllocateChannels(int numchans)
+/* How far a voice moves through its chunk per output frame, in 16.16 fixed
+   point; 0x10000 means it plays straight through. */
+static Uint32 voice_step(int i)
 {
-    if (numchans<0 || numchans==num_channels)
-        return num_channels;
+    const Mix_Chunk *chunk = mix_voice[i].chunk;
+    int freq = mixer.freq;
+    double step;
 
-    if (numchans < num_channels) {
-        /* Stop the affected channels */
-        int i;
-        for (i = numchans; i < num_channels; i++) {
-            Mix_UnregisterAllEffects(i);
-            Mix_HaltChannel(i);
-        }
+    if (chunk->allocated & MIX_CHUNK_NATIVE_RATE) {
+        freq = ((const Mix_ChunkExt *)chunk)->freq;
     }
-    Mix_LockAudio();
-    mix_channel = (struct _Mix_Channel *) SDL_realloc(mix_channel, numchans * sizeof(struct _Mix_Channel));
-    if (numchans > num_channels) {
-        /* Initialize the new channels */
-        int i;
-        for (i = num_channels; i < numchans; i++) {
-            mix_channel[i].chunk = NULL;
-            mix_channel[i].playing = 0;
-            mix_channel[i].looping = 0;
-            mix_channel[i].volume = MIX_MAX_VOLUME;
-            mix_channel[i].fade_volume = MIX_MAX_VOLUME;
-            mix_channel[i].fade_volume_reset = MIX_MAX_VOLUME;
-            mix_channel[i].fading = MIX_NO_FADING;
-            mix_channel[i].tag = -1;
-            mix_channel[i].expire = 0;
-            mix_channel[i].effects = NULL;
-            mix_channel[i].paused = 0;
-        }
+    if (freq == mixer.freq && mix_voice[i].rate == 1.0f) {
+        return 0x10000;
     }
-    num_channels = numchans;
-    Mix_UnlockAudio();
-    return num_channels;
+    step = ((double)freq * mix_voice[i].rate * 65536.0) / mixer.freq;
+    if (step < 1.0) {
+        return 1;
+    }
+    return (Uint32)SDL_min(step, (double)0x7FFF0000);
 }
 
-/* Return the actual mixer parameters */
-int Mix_QuerySpec(int *frequency, Uint16 *format, int *channels)
+/* Resample up to 'frames' frames of a voice into 'dst', with linear
+   interpolation, stopping early at the end of the chunk.
+   Returns the number of frames written. */
+static int resample_voice(int i, Uint8 *dst, int frames, Uint32 step)
 {
-    if (audio_opened) {
-        if (frequency) {
-            *frequency = mixer.freq;
+    struct _Mix_Voice *voice = &mix_voice[i];
+    const int channels = mixer.channels;
+    const int frame_size = (SDL_AUDIO_BITSIZE(mixer.format) / 8) * channels;
+    const SDL_bool compact = (voice->chunk->allocated & MIX_CHUNK_COMPACT) ? SDL_TRUE : SDL_FALSE;
+    const int src_frame_size = compact ? (int)sizeof(Sint16) * channels : frame_size;
+    int n, c;
+
+    for (n = 0; n < frames && voice->playing > 0; ++n) {
+        const Uint8 *cur = voice->samples;
+        const Uint8 *next = cur;
+        const Sint32 frac = (Sint32)(voice->frac >> 1);  /* 15 bits, so the products fit */
+        int advance;
+
+        if (voice->playing > src_frame_size) {
+            next = cur + src_frame_size;
+        } else if (voice->looping) {
+            next = voice->start;
         }
-        if (format) {
-            *format = mixer.format;
+
+        switch (mixer.format) {
+        case SDL_AUDIO_U8:
+            for (c = 0; c < channels; ++c) {
+                dst[c] = (Uint8)(cur[c] + (((next[c] - cur[c]) * frac) >> 15));
+            }
+            break;
+        case SDL_AUDIO_S8:
+            for (c = 0; c < channels; ++c) {
+                Sint32 a = ((const Sint8 *)cur)[c], b = ((const Sint8 *)next)[c];
+                ((Sint8 *)dst)[c] = (Sint8)(a + (((b - a) * frac) >> 15));
+            }
+            break;
+        case SDL_AUDIO_S16:
+            for (c = 0; c < channels; ++c) {
+                Sint32 a = ((const Sint16 *)cur)[c], b = ((const Sint16 *)next)[c];
+                ((Sint16 *)dst)[c] = (Sint16)(a + (((b - a) * frac) >> 15));
+            }
+            break;
+        case SDL_AUDIO_S32:
+            if (compact) {
+                for (c = 0; c < channels; ++c) {
+                    Sint32 a = ((const Sint16 *)cur)[c], b = ((const Sint16 *)next)[c];
+                    ((Sint32 *)dst)[c] = (a + (((b - a) * frac) >> 15)) * 65536;
+                }
+                break;
+            }
+            for (c = 0; c < channels; ++c) {
+                Sint64 a = ((const Sint32 *)cur)[c], b = ((const Sint32 *)next)[c];
+                ((Sint32 *)dst)[c] = (Sint32)(a + (((b - a) * frac) >> 15));
+            }
+            break;
+        case SDL_AUDIO_F32:
+            if (compact) {
+                for (c = 0; c < channels; ++c) {
+                    Sint32 a = ((const Sint16 *)cur)[c], b = ((const Sint16 *)next)[c];
+                    ((float *)dst)[c] = (float)(a + (((b - a) * frac) >> 15)) / 32768.0f;
+                }
+                break;
+            }
+            for (c = 0; c < channels; ++c) {
+                float a = ((const float *)cur)[c], b = ((const float *)next)[c];
+                ((float *)dst)[c] = a + (b - a) * ((float)frac / 32768.0f);
+            }
+            break;
+        default:
+            /* Other byte orders just take the nearest frame */
+            SDL_memcpy(dst, (frac >= 0x4000) ? next : cur, (size_t)frame_size);
+            break;
         }
-        if (channels) {
-            *channels = mixer.channels;
+        dst += frame_size;
+
+        voice->frac += step;
+        advance = (int)(voice->frac >> 16) * src_frame_size;
+        voice->frac &= 0xFFFF;
+        if (advance >= voice->playing) {
+            voice->samples += voice->playing;
+            voice->playing = 0;
+            voice->frac = 0;
+        } else {
+            voice->samples += advance;
+            voice->playing -= advance;
         }
     }
-    return audio_opened;
+    return n;
 }
 
-typedef struct _MusicFragment
+/* mix_one_voice() for a voice that doesn't play at the mixer's rate, or whose
+   chunk is compact: the samples are resampled into 'scratch', and the effects
+   run on them there. */
+static void mix_resampled_voice(int i, Uint8 *stream, int len, int master_vol, Uint8 *scratch, Uint64 *effect_time, SDL_bool deferred)
 {
-    Uint8 *data;
-    int size;
-    struct _MusicFragment *next;
-} MusicFragment;
+    const int frame_size = (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels;
+    Uint8 *mix_input;
+    int volume, index, mixable;
 
-static SDL_AudioSpec *Mix_LoadMusic_RW(SDL_RWops *src, SDL_bool freesrc, SDL_AudioSpec *spec, Uint8 **audio_buf, Uint32 *audio_len)
+    volume = (master_vol * (mix_voice[i].volume * mix_voice[i].chunk->volume)) / (MIX_MAX_VOLUME * MIX_MAX_VOLUME);
+    index = 0;
+    while (mix_voice[i].playing > 0 && index < len) {
+        mixable = resample_voice(i, scratch, (len - index) / frame_size, voice_step(i)) * frame_size;
+        if (!mixable) {
+            break;
+        }
+
+        mix_input = Mix_DoEffects(i, scratch, mixable, scratch, effect_time);
+        mix_audio(stream+index, mix_input, mixable, volume);
+        index += mixable;
+
+        if (!mix_voice[i].playing) {
+            if (mix_voice[i].looping) {
+                if (mix_voice[i].looping > 0) {
+                    --mix_voice[i].looping;
+                }
+                mix_voice[i].samples = mix_voice[i].start;
+                mix_voice[i].playing = mix_voice[i].length;
+            } else {
+                voice_finished(i, deferred);
+
+                /* Update the volume after the application callback */
+                if (!deferred) {
+                    volume = (master_vol * (mix_voice[i].volume * mix_voice[i].chunk->volume)) / (MIX_MAX_VOLUME * MIX_MAX_VOLUME);
+                }
+            }
+        }
+    }
+}
+
+/* mix_one_voice() for a compressed chunk: its decoder writes into 'scratch',
+   and handles any looping itself. */
+static void mix_decoded_voice(int i, Uint8 *stream, int len, int master_vol, Uint8 *scratch, Uint64 *effect_time, SDL_bool deferred)
+{
+    Mix_MusicInterface *interface = ((Mix_ChunkExt *)mix_voice[i].chunk)->interface;
+    void *decoder = mix_voice[i].decoder;
+    Uint8 *mix_input;
+    int volume, mixable;
+
+    volume = (master_vol * (mix_voice[i].volume * mix_voice[i].chunk->volume)) / (MIX_MAX_VOLUME * MIX_MAX_VOLUME);
+    mixable = len - interface->GetAudio(decoder, scratch, len);
+    if (mixable > 0) {
+        mix_input = Mix_DoEffects(i, scratch, mixable, scratch, effect_time);
+        mix_audio(stream, mix_input, mixable, volume);
+    }
+    if (mixable < len || (interface->IsPlaying && !interface->IsPlaying(decoder))) {
+        /* The decoder is deleted once the channel is done with */
+        mix_voice[i].playing = 0;
+        mix_voice[i].looping = 0;
+        voice_finished(i, deferred);
+    }
+}
+
+/* Mix 'len' bytes of a voice into 'stream'.
+   If 'deferred' is set, this may be running on a mix worker, so it must not
+   call back into the app: a voice that finishes is only flagged, and stays
+   silent for the rest of the buffer. */
+static void mix_one_voice(int i, Uint8 *stream, int len, int master_vol, Uint8 *scratch, Uint64 *effect_time, SDL_bool deferred)
+{
+    Uint8 *mix_input;
+    int volume, mixable, index, remaining;
+
+    if (mix_channel[i].paused || mix_voice[i].playing <= 0) {
+        return;
+    }
+    if (mix_voice[i].decoder) {
+        mix_decoded_voice(i, stream, len, master_vol, scratch, effect_time, deferred);
+        return;
+    }
+    if (voice_step(i) != 0x10000 || (mix_voice[i].chunk->allocated & MIX_CHUNK_COMPACT)) {
+        mix_resampled_voice(i, stream, len, master_vol, scratch, effect_time, deferred);
+        return;
+    }
+
+    volume = (master_vol * (mix_voice[i].volume * mix_voice[i].chunk->volume)) / (MIX_MAX_VOLUME * MIX_MAX_VOLUME);
+    index = 0;
+    while (mix_voice[i].playing > 0 && index < len) {
+        remaining = len - index;
+        mixable = mix_voice[i].playing;
+        if (mixable > remaining) {
+            mixable = remaining;
+        }
+
+        mix_input = Mix_DoEffects(i, mix_voice[i].samples, mixable, scratch, effect_time);
+        mix_audio(stream+index, mix_input, mixable, volume);
+
+        mix_voice[i].samples += mixable;
+        mix_voice[i].playing -= mixable;
+        index += mixable;
+
+        /* rcg06072001 Alert app if channel is done playing. */
+        if (!mix_voice[i].playing && !mix_voice[i].looping) {
+            voice_finished(i, deferred);
+
+            /* Update the volume after the application callback */
+            if (!deferred) {
+                volume = (master_vol * (mix_voice[i].volume * mix_voice[i].chunk->volume)) / (MIX_MAX_VOLUME * MIX_MAX_VOLUME);
+            }
+        }
+    }
+
+    /* If looping the sample and we are at its end, make sure
+       we will still return a full buffer */
+    while (mix_voice[i].looping && index < len) {
+        int alen = mix_voice[i].length;
+        remaining = len - index;
+        if (remaining > alen) {
+            remaining = alen;
+        }
+
+        mix_input = Mix_DoEffects(i, mix_voice[i].start, remaining, scratch, effect_time);
+        mix_audio(stream+index, mix_input, remaining, volume);
+
+        if (mix_voice[i].looping > 0) {
+            --mix_voice[i].looping;
+        }
+        mix_voice[i].samples = mix_voice[i].start + remaining;
+        mix_voice[i].playing = mix_voice[i].length - remaining;
+        index += remaining;
+
+        /* The last loop ended exactly at the end of the region */
+        if (!mix_voice[i].playing && !mix_voice[i].looping) {
+            voice_finished(i, deferred);
+        }
+    }
+    if (! mix_voice[i].playing && mix_voice[i].looping) {
+        if (mix_voice[i].looping > 0) {
+            --mix_voice[i].looping;
+        }
+        mix_voice[i].samples = mix_voice[i].start;
+        mix_voice[i].playing = mix_voice[i].length;
+    }
+}
+
+/* Mix worker threads, see SDL_MIXER_HINT_MIX_THREADS.
+   Each worker mixes a run of the active voices into its own bus, which the
+   audio thread adds to the output in worker order, so the result doesn't
+   depend on which thread finishes first. */
+static int SDLCALL mix_worker_thread(void *data)
+{
+    MixWorker *worker = (MixWorker *)data;
+    int v;
+
+    if (realtime) {
+        _Mix_RTCheckAddThread();
+    }
+
+    for (;;) {
+        SDL_WaitSemaphore(worker->start);
+        if (SDL_AtomicGet(&mix_workers_quit)) {
+            break;
+        }
+        SDL_memset(worker->bus, SDL_GetSilenceValueForFormat(mixer.format), (size_t)worker->len);
+        worker->effect_time = 0;
+        for (v = 0; v < worker->num_voices; ++v) {
+            mix_one_voice(worker->voices[v], worker->bus, worker->len, worker->master_vol, worker->scratch,
+                          worker->measure ? &worker->effect_time : NULL, SDL_TRUE);
+        }
+        SDL_PostSemaphore(mix_workers_done);
+    }
+    return 0;
+}
+
+static void stop_mix_workers(void)
 {
     int i;
-    Mix_MusicType music_type;
-    Mix_MusicInterface *interface = NULL;
-    void *music = NULL;
-    Sint64 start;
-    SDL_bool playing;
-    MusicFragment *first = NULL, *last = NULL, *fragment = NULL;
-    int count = 0;
-    int fragment_size;
 
-    music_type = detect_music_type(src);
-    if (!load_music_type(music_type) || !open_music_type(music_type)) {
+    SDL_AtomicSet(&mix_workers_quit, 1);
+    for (i = 0; i < num_mix_workers; ++i) {
+        SDL_PostSemaphore(mix_workers[i].start);
+        SDL_WaitThread(mix_workers[i].thread, NULL);
+        SDL_DestroySemaphore(mix_workers[i].start);
+        SDL_aligned_free(mix_workers[i].bus);
+        SDL_aligned_free(mix_workers[i].scratch);
+    }
+    SDL_free(mix_workers);
+    mix_workers = NULL;
+    num_mix_workers = 0;
+    if (mix_workers_done) {
+        SDL_DestroySemaphore(mix_workers_done);
+        mix_workers_done = NULL;
+    }
+}
+
+/* Start up to 'count' workers; fewer is fine, down to none at all. */
+static void start_mix_workers(int count)
+{
+    int i;
+
+    if (count <= 0) {
+        return;
+    }
+    count = SDL_min(count, MIX_MAX_WORKERS);
+    mix_workers = (MixWorker *)SDL_calloc((size_t)count, sizeof(*mix_workers));
+    mix_workers_done = SDL_CreateSemaphore(0);
+    if (!mix_workers || !mix_workers_done) {
+        stop_mix_workers();
+        return;
+    }
+    SDL_AtomicSet(&mix_workers_quit, 0);
+    for (i = 0; i < count; ++i) {
+        MixWorker *worker = &mix_workers[num_mix_workers];
+        if (realtime) {
+            /* Size the buffers now, so mixing never has to */
+            worker->buflen = audio_mixbuflen;
+            worker->bus = (Uint8 *)SDL_aligned_alloc(SDL_SIMDGetAlignment(), worker->buflen);
+            worker->scratch = (Uint8 *)SDL_aligned_alloc(SDL_SIMDGetAlignment(), worker->buflen);
+            if (!worker->bus || !worker->scratch) {
+                SDL_aligned_free(worker->bus);
+                SDL_aligned_free(worker->scratch);
+                SDL_zerop(worker);
+                break;
+            }
+        }
+        worker->start = SDL_CreateSemaphore(0);
+        if (worker->start) {
+            worker->thread = SDL_CreateThread(mix_worker_thread, "SDL_mixer worker", worker);
+        }
+        if (!worker->thread) {
+            if (worker->start) {
+                SDL_DestroySemaphore(worker->start);
+            }
+            SDL_aligned_free(worker->bus);
+            SDL_aligned_free(worker->scratch);
+            SDL_zerop(worker);
+            break;
+        }
+        ++num_mix_workers;
+    }
+    if (num_mix_workers == 0) {
+        stop_mix_workers();
+    }
+}
+
+/* Split the voices between the audio thread and the workers.
+   Returns SDL_FALSE, having done nothing, if there are too few voices to be
+   worth it; the caller then mixes them inline as usual. */
+static SDL_bool mix_voices_parallel(Uint8 *stream, int len, int master_vol, const int *voices, int num_voices, Uint64 *effect_time)
+{
+    int parts, per_part, extra, first, i, v;
+
+    parts = SDL_min(num_mix_workers + 1, num_voices / MIX_MIN_VOICES_PER_WORKER);
+    if (parts <= 1) {
+        return SDL_FALSE;
+    }
+
+    /* Buffers only grow, and only when the device asks for a bigger buffer */
+    for (i = 0; i < parts - 1; ++i) {
+        MixWorker *worker = &mix_workers[i];
+        if (worker->buflen < len) {
+            void *bus = SDL_aligned_alloc(SDL_SIMDGetAlignment(), len);
+            void *scratch = SDL_aligned_alloc(SDL_SIMDGetAlignment(), len);
+            if (!bus || !scratch) {
+                SDL_aligned_free(bus);
+                SDL_aligned_free(scratch);
+                return SDL_FALSE;
+            }
+            SDL_aligned_free(worker->bus);
+            SDL_aligned_free(worker->scratch);
+            worker->bus = (Uint8 *)bus;
+            worker->scratch = (Uint8 *)scratch;
+            worker->buflen = len;
+        }
+    }
+
+    /* The audio thread keeps the first share and mixes it straight into the stream */
+    per_part = num_voices / parts;
+    extra = num_voices % parts;
+    first = per_part + (extra > 0 ? 1 : 0);
+    v = first;
+    for (i = 1; i < parts; ++i) {
+        MixWorker *worker = &mix_workers[i - 1];
+        int count = per_part + (i < extra ? 1 : 0);
+        worker->voices = &voices[v];
+        worker->num_voices = count;
+        worker->len = len;
+        worker->master_vol = master_vol;
+        worker->measure = (effect_time != NULL);
+        v += count;
+        SDL_PostSemaphore(worker->start);
+    }
+
+    for (v = 0; v < first; ++v) {
+        mix_one_voice(voices[v], stream, len, master_vol, audio_effectbuf, effect_time, SDL_TRUE);
+    }
+
+    for (i = 1; i < parts; ++i) {
+        SDL_WaitSemaphore(mix_workers_done);
+    }
+    for (i = 0; i < parts - 1; ++i) {
+        mix_audio(stream, mix_workers[i].bus, len, MIX_MAX_VOLUME);
+        if (effect_time) {
+            *effect_time += mix_workers[i].effect_time;
+        }
+    }
+
+    /* Now that nothing else is touching the channels, tell the app */
+    for (v = 0; v < num_voices; ++v) {
+        int which = voices[v];
+        if (mix_channel[which].finished) {
+            _Mix_channel_done_playing(which);
+        }
+    }
+    return SDL_TRUE;
+}
+
+/* Make sure the mix and effect buffers hold at least 'len' bytes */
+static int grow_mix_buffers(int len)
+{
+    if (audio_mixbuflen < len) {
+        void *ptr = SDL_aligned_alloc(SDL_SIMDGetAlignment(), len);
+        void *effectptr = SDL_aligned_alloc(SDL_SIMDGetAlignment(), len);
+        if (!ptr || !effectptr) {
+            SDL_aligned_free(ptr);
+            SDL_aligned_free(effectptr);
+            return Mix_OutOfMemory();
+        }
+        SDL_aligned_free(audio_mixbuf);
+        SDL_aligned_free(audio_effectbuf);
+        audio_mixbuf = (Uint8 *) ptr;
+        audio_effectbuf = (Uint8 *) effectptr;
+        audio_mixbuflen = len;
+    }
+    return 0;
+}
+
+/* Mix 'len' bytes into 'stream', adding the time taken to 'perf' if it's set */
+static void mix_block(Uint8 *stream, int len, MixPerfSample *perf)
+{
+    const int frame_size = (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels;
+    const int *voices;
+    int v, num_voices, master_vol;
+    Uint64 sdl_ticks, now = 0;
+
+    /* Need to initialize the stream in SDL 1.3+ */
+    SDL_memset(stream, SDL_GetSilenceValueForFormat(mixer.format), (size_t)len);
+
+    /* Mix the music (must be done before the channels are added) */
+    if (perf) {
+        now = SDL_GetPerformanceCounter();
+        mix_music(music_data, stream, len);
+        mix_music_streams(stream, len);
+        perf->music_time += SDL_GetPerformanceCounter() - now;
+    } else {
+        mix_music(music_data, stream, len);
+        mix_music_streams(stream, len);
+    }
+
+    master_vol = SDL_AtomicGet(&master_volume);
+
+    /* Mix any playing channels...
+       Work from a snapshot, since finished channels leave the active list
+       and the channel_finished callback may start new ones. */
+    sdl_ticks = mixer_ticks();
+    voices = _Mix_SnapshotActiveChannels(&num_voices);
+    for (v = 0; v < num_voices; ++v) {
+        update_voice(voices[v], sdl_ticks);
+    }
+    if (!mix_voices_parallel(stream, len, master_vol, voices, num_voices, perf ? &perf->effects_time : NULL)) {
+        for (v = 0; v < num_voices; ++v) {
+            mix_one_voice(voices[v], stream, len, master_vol, audio_effectbuf, perf ? &perf->effects_time : NULL, SDL_FALSE);
+        }
+    }
+
+    if (perf) {
+        now = SDL_GetPerformanceCounter();
+    }
+
+    /* rcg06122001 run posteffects... */
+    Mix_DoEffects(MIX_CHANNEL_POST, stream, len, NULL, NULL);
+
+    if (mix_postmix) {
+        mix_postmix(mix_postmix_data, stream, len);
+    }
+
+    /* The only clipping in the float path; the stream converts to the device format */
+    if (float_mixing) {
+        clamp_float32((float *)stream, len / (int)sizeof(float));
+    }
+
+    if (perf) {
+        perf->postmix_time += SDL_GetPerformanceCounter() - now;
+        perf->voices = SDL_max(perf->voices, num_voices);
+    }
+    mixed_frames += (Uint64)(len / frame_size);
+}
+
+/* Mix 'len' bytes in the mixer format, returning the mixed buffer or NULL */
+static Uint8 *mix_buffer(int len)
+{
+    SDL_bool measure = _Mix_PerfStatsEnabled();
+    MixPerfSample perf;
+    Uint64 start = 0;
+    int pos, block;
+
+    if (measure) {
+        SDL_zero(perf);
+        start = SDL_GetPerformanceCounter();
+    }
+
+    if (grow_mix_buffers(len) < 0) {
         return NULL;
     }
 
-    *spec = mixer;
-
-    /* Use fragments sized on full audio frame boundaries - this'll do */
-    fragment_size = 4096/*spec->samples*/ * (SDL_AUDIO_BITSIZE(spec->format) / 8) * spec->channels;
+    /* A command timed for a frame in the middle of the buffer splits it there */
+    for (pos = 0; pos < len; pos += block) {
+        /* Apply anything the game threads queued since the last callback */
+        run_commands(SDL_TRUE);
+
+        block = bytes_until_timed_command(len - pos);
+        mix_block(audio_mixbuf + pos, block, measure ? &perf : NULL);
+    }
+
+    if (measure) {
+        int frame_size = (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels;
+
+        perf.callback_time = SDL_GetPerformanceCounter() - start;
+        perf.bytes = len;
+        if (!headless) {
+            perf.deadline_ns = ((Uint64)(len / frame_size) * SDL_NS_PER_SECOND) / (Uint64)mixer.freq;
+        }
+        _Mix_RecordPerfSample(&perf);
+    }
+
+    return audio_mixbuf;
+}
+
+/* Keep the audio stream 'mix_ahead_bytes' ahead of the device, in whole
+   blocks */
+static int SDLCALL mix_ahead_main(void *data)
+{
+    (void)data;
+
+    if (realtime) {
+        /* This thread does nothing but mix */
+        _Mix_RTCheckAddThread();
+    }
+
+    while (!SDL_AtomicGet(&mix_ahead_quit)) {
+        int queued = SDL_GetAudioStreamQueued(audio_stream);
+        Uint8 *stream;
+
+        if (queued < 0 || mix_ahead_bytes - queued < mix_ahead_block) {
+            SDL_Delay(mix_ahead_poll_ms);
+            continue;
+        }
+
+        Mix_LockAudio();
+        stream = mix_buffer(mix_ahead_block);
+        if (stream) {
+            SDL_PutAudioStreamData(audio_stream, stream, mix_ahead_block);
+        }
+        Mix_UnlockAudio();
+
+        if (!stream) {
+            SDL_Delay(mix_ahead_poll_ms);
+        }
+    }
+    return 0;
+}
+
+/* Mixing function */
+static void SDLCALL
+mix_channels(void *udata, SDL_AudioStream *astream, int len, int total)
+{
+    Uint8 *stream;
+
+    (void)udata;
+    (void)total;
+
+    if (realtime) {
+        _Mix_RTCheckEnter();
+        /* Never grow the buffers here, mix in blocks of what was preallocated */
+        while (len > 0) {
+            int block = SDL_min(len, audio_mixbuflen);
+            stream = mix_buffer(block);
+            if (!stream) {
+                break;
+            }
+            SDL_PutAudioStreamData(astream, stream, block);
+            len -= block;
+        }
+        _Mix_RTCheckLeave();
+    } else {
+        stream = mix_buffer(len);
+        if (stream) {
+            SDL_PutAudioStreamData(astream, stream, len);
+        }
+    }
+}
+
+/* Set up mixing ahead if SDL_MIXER_HINT_MIX_AHEAD asks for it, before the
+   audio lock is first used */
+static void init_mix_ahead(void)
+{
+    const int frame_size = (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels;
+    const char *hint = SDL_GetHint(SDL_MIXER_HINT_MIX_AHEAD);
+    int ms, frames, block;
+
+    ms = hint ? SDL_atoi(hint) : 0;
+    if (ms <= 0 || headless) {
+        return;
+    }
+    ms = SDL_min(ms, 10000);
+
+    /* At least two blocks, so one can be mixed while the other plays */
+    frames = (int)(((Sint64)mixer.freq * ms) / 1000);
+    block = SDL_clamp(frames / 2, 64, MIX_BLOCK_FRAMES);
+    frames = SDL_max(frames, 2 * block);
+
+    mix_ahead_lock = SDL_CreateMutex();
+    mix_ahead_bytes = frames * frame_size;
+    mix_ahead_block = block * frame_size;
+    mix_ahead_poll_ms = (Uint32)SDL_max(1, (block * 1000) / (mixer.freq * 4));
+}
+
+/* Start mixing, once everything else is set up */
+static void start_mixing(void)
+{
+    if (mix_ahead_lock) {
+        SDL_AtomicSet(&mix_ahead_quit, 0);
+        mix_ahead_thread = SDL_CreateThread(mix_ahead_main, "SDL_mixer mixer", NULL);
+        if (!mix_ahead_thread) {
+            /* Nothing else can be holding it yet, mix in the callback instead */
+            SDL_DestroyMutex(mix_ahead_lock);
+            mix_ahead_lock = NULL;
+        }
+    }
+    if (audio_device && !mix_ahead_thread) {
+        SDL_SetAudioStreamGetCallback(audio_stream, mix_channels, NULL);
+    }
+}
+
+#if 0
+static void PrintFormat(char *title, SDL_AudioSpec *fmt)
+{
+    printf("%s: %d bit %s audio (%s) at %u Hz\n", title, (fmt->format&0xFF),
+            (fmt->format&0x8000) ? "signed" : "unsigned",
+            (fmt->channels > 2) ? "surround" :
+            (fmt->channels > 1) ? "stereo" : "mono", fmt->freq);
+}
+#endif
+
+/* Set up everything but the device, once mixer_output is known */
+static int open_mixer(void)
+{
+    int i;
+    const char *hint;
+
+    /* Everything upstream of the stream works in the mixer format */
+    mixer = mixer_output;
+    float_mixing = SDL_GetHintBoolean(SDL_MIXER_HINT_FLOAT_MIXING, SDL_FALSE);
+    if (float_mixing) {
+        mixer.format = SDL_AUDIO_F32;
+    }
+
+    audio_stream = SDL_CreateAudioStream(&mixer, &mixer_output);
+    if (!audio_stream) {
+        return -1;
+    }
+
+    realtime = SDL_GetHintBoolean(SDL_MIXER_HINT_REALTIME, SDL_FALSE);
+    if (realtime) {
+        if (grow_mix_buffers(MIX_BLOCK_FRAMES * (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels) < 0) {
+            SDL_DestroyAudioStream(audio_stream);
+            audio_stream = NULL;
+            realtime = SDL_FALSE;
+            return -1;
+        }
+        _Mix_RTCheckInit();
+    }
+
+    mixed_frames = 0;
+    num_timed_commands = 0;
+    init_mix_ahead();
+
+    if (audio_device) {
+        SDL_BindAudioStream(audio_device, audio_stream);
+    }
+
+#if 0
+    PrintFormat("Audio device", &mixer);
+#endif
+
+    num_channels = MIX_CHANNELS;
+    mix_channel = (struct _Mix_Channel *) SDL_malloc(num_channels * sizeof(struct _Mix_Channel));
+    mix_voice = (struct _Mix_Voice *) SDL_malloc(num_channels * sizeof(struct _Mix_Voice));
+
+    /* Clear out the audio channels */
+    for (i = 0; i < num_channels; ++i) {
+        mix_voice[i].chunk = NULL;
+        mix_voice[i].playing = 0;
+        mix_voice[i].looping = 0;
+        mix_voice[i].volume = SDL_MIX_MAXVOLUME;
+        mix_voice[i].rate = 1.0f;
+        mix_voice[i].frac = 0;
+        mix_voice[i].decoder = NULL;
+        mix_channel[i].fade_volume = SDL_MIX_MAXVOLUME;
+        mix_channel[i].fade_volume_reset = SDL_MIX_MAXVOLUME;
+        mix_channel[i].fading = MIX_NO_FADING;
+        mix_channel[i].tag = -1;
+        mix_channel[i].expire = 0;
+        mix_channel[i].effects = NULL;
+        mix_channel[i].paused = 0;
+        mix_channel[i].finished = SDL_FALSE;
+    }
+    if (_Mix_ResizeChannelIndex(num_channels) < 0 || _Mix_InitCommandQueue() < 0 ||
+        _Mix_InitChunkCache() < 0 || _Mix_InitAsyncLoad() < 0) {
+        _Mix_QuitChunkCache();
+        _Mix_QuitCommandQueue();
+        _Mix_FreeChannelIndex();
+        SDL_free(mix_channel);
+        mix_channel = NULL;
+        SDL_free(mix_voice);
+        mix_voice = NULL;
+        SDL_DestroyAudioStream(audio_stream);
+        audio_stream = NULL;
+        if (mix_ahead_lock) {
+            SDL_DestroyMutex(mix_ahead_lock);
+            mix_ahead_lock = NULL;
+        }
+        return -1;
+    }
+    Mix_VolumeMusic(SDL_MIX_MAXVOLUME);
+
+    _Mix_InitEffects();
+
+    hint = SDL_GetHint(SDL_MIXER_HINT_MIX_THREADS);
+    if (hint) {
+        Mix_LockAudio();
+        start_mix_workers(SDL_atoi(hint));
+        Mix_UnlockAudio();
+    }
+
+    add_chunk_decoder("WAVE");
+    add_chunk_decoder("AIFF");
+    add_chunk_decoder("VOC");
+
+    /* Initialize the music players */
+    open_music(&mixer);
+
+    start_mixing();
+
+    audio_opened = 1;
+    return 0;
+}
+
+/* Open the mixer with a certain desired audio format */
+int Mix_OpenAudio(SDL_AudioDeviceID devid, const SDL_AudioSpec *spec)
+{
+    if (!SDL_WasInit(SDL_INIT_AUDIO)) {
+        if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+            return -1;
+        }
+    }
+
+    /* If the mixer is already opened, increment open count */
+    if (audio_opened) {
+        if (!headless && spec && (spec->format == mixer_output.format) && (spec->channels == mixer_output.channels)) {
+            ++audio_opened;
+            return 0;
+        }
+        while (audio_opened) {
+            Mix_CloseAudio();
+        }
+    }
+
+    if (devid == 0) {
+        devid = SDL_AUDIO_DEVICE_DEFAULT_OUTPUT;
+    }
+
+    if ((audio_device = SDL_OpenAudioDevice(devid, spec)) == 0) {
+        return -1;
+    }
+
+    SDL_GetAudioDeviceFormat(audio_device, &mixer_output, NULL);
+
+    headless = SDL_FALSE;
+    if (open_mixer() < 0) {
+        SDL_CloseAudioDevice(audio_device);
+        audio_device = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int Mix_OpenAudioHeadless(const SDL_AudioSpec *spec)
+{
+    if (!spec) {
+        return Mix_SetError("Tried to open the mixer with a NULL spec");
+    }
+    if (spec->freq <= 0 || spec->channels <= 0) {
+        return Mix_SetError("Invalid audio spec");
+    }
+
+    while (audio_opened) {
+        Mix_CloseAudio();
+    }
+
+    audio_device = 0;
+    mixer_output = *spec;
+    headless = SDL_TRUE;
+    rendered_frames = 0;
+    if (open_mixer() < 0) {
+        headless = SDL_FALSE;
+        return -1;
+    }
+    return 0;
+}
+
+int Mix_RenderAudio(void *buffer, int frames)
+{
+    Uint8 *dst = (Uint8 *)buffer;
+    int mix_frame_size, out_frame_size;
+    int retval = 0;
+
+    if (!audio_opened || !headless) {
+        return Mix_SetError("Audio hasn't been opened with Mix_OpenAudioHeadless()");
+    }
+    if (frames <= 0) {
+        return 0;
+    }
+    if (!buffer) {
+        return Mix_SetError("Tried to render into a NULL buffer");
+    }
+
+    mix_frame_size = (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels;
+    out_frame_size = (SDL_AUDIO_BITSIZE(mixer_output.format) / 8) * mixer_output.channels;
+
+    /* Mix in device-sized blocks */
+    Mix_LockAudio();
+    while (frames > 0) {
+        int block = SDL_min(frames, MIX_BLOCK_FRAMES);
+        Uint8 *mixed = mix_buffer(block * mix_frame_size);
+        if (!mixed) {
+            retval = Mix_OutOfMemory();
+            break;
+        }
+        if (mixer.format == mixer_output.format) {
+            SDL_memcpy(dst, mixed, (size_t)block * out_frame_size);
+        } else if (SDL_PutAudioStreamData(audio_stream, mixed, block * mix_frame_size) < 0 ||
+                   SDL_GetAudioStreamData(audio_stream, dst, block * out_frame_size) != block * out_frame_size) {
+            retval = -1;
+            break;
+        }
+        rendered_frames += (Uint64)block;
+        dst += block * out_frame_size;
+        frames -= block;
+    }
+    Mix_UnlockAudio();
+
+    return retval;
+}
+
+/* Pause or resume the audio streaming */
+void Mix_PauseAudio(int pause_on)
+{
+    if (pause_on) {
+        SDL_PauseAudioDevice(audio_device);
+    } else {
+        SDL_ResumeAudioDevice(audio_device);
+    }
+    Mix_LockAudio();
+    pause_async_music(pause_on);
+    Mix_UnlockAudio();
+}
+
+/* Dynamically change the number of channels managed by the mixer.
+   If decreasing the number of channels, the upper channels are
+   stopped.
+ */
+int Mix_AllocateChannels(int numchans)
+{
+    struct _Mix_Channel *channels;
+    struct _Mix_Voice *voices;
+
+    if (numchans<0 || numchans==num_channels)
+        return num_channels;
+
+    if (numchans < num_channels) {
+        /* Stop the affected channels */
+        int i;
+        for (i = numchans; i < num_channels; i++) {
+            Mix_UnregisterAllEffects(i);
+            Mix_HaltChannel(i);
+        }
+    }
+    Mix_LockAudio();
+    if (_Mix_ResizeChannelIndex(numchans) < 0) {
+        Mix_UnlockAudio();
+        return -1;
+    }
+    /* If either array can't be resized, whatever did resize has room to
+       spare. That's fine when shrinking, but not when growing. */
+    channels = (struct _Mix_Channel *) SDL_realloc(mix_channel, SDL_max(numchans, 1) * sizeof(struct _Mix_Channel));
+    if (channels) {
+        mix_channel = channels;
+    }
+    voices = (struct _Mix_Voice *) SDL_realloc(mix_voice, SDL_max(numchans, 1) * sizeof(struct _Mix_Voice));
+    if (voices) {
+        mix_voice = voices;
+    }
+    if (numchans > num_channels) {
+        int i;
+
+        if (!channels || !voices) {
+            _Mix_ResizeChannelIndex(num_channels);
+            Mix_UnlockAudio();
+            return Mix_OutOfMemory();
+        }
+
+        /* Initialize the new channels */
+        for (i = num_channels; i < numchans; i++) {
+            mix_voice[i].chunk = NULL;
+            mix_voice[i].playing = 0;
+            mix_voice[i].looping = 0;
+            mix_voice[i].volume = MIX_MAX_VOLUME;
+            mix_voice[i].rate = 1.0f;
+            mix_voice[i].frac = 0;
+            mix_voice[i].decoder = NULL;
+            mix_channel[i].fade_volume = MIX_MAX_VOLUME;
+            mix_channel[i].fade_volume_reset = MIX_MAX_VOLUME;
+            mix_channel[i].fading = MIX_NO_FADING;
+            mix_channel[i].tag = -1;
+            mix_channel[i].expire = 0;
+            mix_channel[i].effects = NULL;
+            mix_channel[i].paused = 0;
+            mix_channel[i].finished = SDL_FALSE;
+        }
+    }
+    num_channels = numchans;
+    Mix_UnlockAudio();
+    return num_channels;
+}
+
+/* Return the actual mixer parameters */
+int Mix_QuerySpec(int *frequency, Uint16 *format, int *channels)
+{
+    if (audio_opened) {
+        if (frequency) {
+            *frequency = mixer.freq;
+        }
+        if (format) {
+            *format = mixer.format;
+        }
+        if (channels) {
+            *channels = mixer.channels;
+        }
+    }
+    return audio_opened;
+}
+
+/* Create a decoder for 'src' with the first music interface that takes it.
+   The decoder owns 'src' if 'freesrc' is set; otherwise, and on failure,
+   the caller still does. */
+static void *create_chunk_decoder(SDL_RWops *src, SDL_bool freesrc, Mix_MusicType music_type, Mix_MusicInterface **result)
+{
+    int i;
+    Mix_MusicInterface *interface;
+    void *music;
+    Sint64 start;
 
     start = SDL_RWtell(src);
     for (i = 0; i < get_num_music_interfaces(); ++i) {
@@ -683,24 +1886,72 @@ static SDL_AudioSpec *Mix_LoadMusic_RW(SDL_RWops *src, SDL_bool freesrc, SDL_Aud
 
         music = interface->CreateFromRW(src, freesrc);
         if (music) {
-            /* The interface owns the data source now */
-            freesrc = SDL_FALSE;
-            break;
+            *result = interface;
+            return music;
         }
 
         /* Reset the stream for the next decoder */
         SDL_RWseek(src, start, SDL_RW_SEEK_SET);
     }
+    Mix_SetError("Unrecognized audio format");
+    return NULL;
+}
+
+/* Decode a whole file into one buffer in the mixer's format.
+   The decoder is private to this call, so the audio callback keeps running
+   meanwhile, except for MIDI, whose decoders share state with the music. */
+static SDL_AudioSpec *Mix_LoadMusic_RW(SDL_RWops *src, SDL_bool freesrc, SDL_AudioSpec *spec, Uint8 **audio_buf, Uint32 *audio_len)
+{
+    Mix_MusicType music_type;
+    Mix_MusicInterface *interface = NULL;
+    void *music = NULL;
+    SDL_bool playing;
+    Uint8 *buf;
+    size_t len, capacity;
+    int block_size, frame_size;
+
+    music_type = detect_music_type(src);
+    if (!load_music_type(music_type) || !open_music_type(music_type)) {
+        if (freesrc) {
+            SDL_RWclose(src);
+        }
+        return NULL;
+    }
+
+    *spec = mixer;
 
+    /* Decode in blocks of full audio frames - this'll do */
+    frame_size = (SDL_AUDIO_BITSIZE(spec->format) / 8) * spec->channels;
+    block_size = 4096/*spec->samples*/ * frame_size;
+
+    music = create_chunk_decoder(src, freesrc, music_type, &interface);
     if (!music) {
         if (freesrc) {
             SDL_RWclose(src);
         }
-        Mix_SetError("Unrecognized audio format");
         return NULL;
     }
 
-    Mix_LockAudio();
+    /* Size the buffer for the whole thing if we know how long it is,
+       with room for the last block to come up short */
+    capacity = 16 * (size_t)block_size;
+    if (interface->Duration) {
+        double duration = interface->Duration(music);
+        if (duration > 0.0 && duration * spec->freq * frame_size < (double)SDL_MAX_UINT32) {
+            capacity = (size_t)(duration * spec->freq + 1.0) * frame_size + block_size;
+        }
+    }
+    buf = (Uint8 *)SDL_malloc(capacity);
+    if (!buf) {
+        interface->Delete(music);
+        Mix_OutOfMemory();
+        return NULL;
+    }
+    len = 0;
+
+    if (music_type == MUS_MID) {
+        Mix_LockAudio();
+    }
 
     if (interface->Play) {
         interface->Play(music, 1);
@@ -710,175 +1961,553 @@ static SDL_AudioSpec *Mix_LoadMusic_RW(SDL_RWops *src, SDL_bool freesrc, SDL_Aud
     while (playing) {
         int left;
 
-        fragment = (MusicFragment *)SDL_malloc(sizeof(*fragment));
-        if (!fragment) {
-            /* Uh oh, out of memory, let's return what we have */
-            break;
-        }
-        fragment->data = (Uint8 *)SDL_malloc(fragment_size);
-        if (!fragment->data) {
-            /* Uh oh, out of memory, let's return what we have */
-            SDL_free(fragment);
-            break;
+        if (capacity - len < (size_t)block_size) {
+            size_t new_capacity = SDL_min(capacity * 2, (size_t)SDL_MAX_UINT32);
+            Uint8 *ptr = NULL;
+
+            if (new_capacity - len >= (size_t)block_size) {
+                ptr = (Uint8 *)SDL_realloc(buf, new_capacity);
+            }
+            if (!ptr) {
+                /* Uh oh, out of memory, let's return what we have */
+                break;
+            }
+            buf = ptr;
+            capacity = new_capacity;
         }
-        fragment->next = NULL;
 
-        left = interface->GetAudio(music, fragment->data, fragment_size);
+        left = interface->GetAudio(music, buf + len, block_size);
         if (left > 0) {
             playing = SDL_FALSE;
         } else if (interface->IsPlaying) {
             playing = interface->IsPlaying(music);
         }
-        fragment->size = (fragment_size - left);
+        len += (size_t)(block_size - left);
+    }
+
+    if (interface->Stop) {
+        interface->Stop(music);
+    }
+
+    if (music_type == MUS_MID) {
+        Mix_UnlockAudio();
+    }
+
+    interface->Delete(music);
+
+    if (len == 0) {
+        SDL_free(buf);
+        Mix_SetError("No audio data");
+        return NULL;
+    }
+
+    if (len < capacity) {
+        /* Give back what the estimate had to spare */
+        Uint8 *ptr = (Uint8 *)SDL_realloc(buf, len);
+        if (ptr) {
+            buf = ptr;
+        }
+    }
+    *audio_buf = buf;
+    *audio_len = (Uint32)len;
+    return spec;
+}
+
+/* How SDL_MIXER_HINT_COMPACT_CHUNKS says to store chunks, given the mixer's format */
+int _Mix_CompactChunks(void)
+{
+    const char *hint = SDL_GetHint(SDL_MIXER_HINT_COMPACT_CHUNKS);
+
+    if (!hint) {
+        return MIX_COMPACT_NONE;
+    }
+    if (SDL_strcasecmp(hint, "s16") == 0) {
+        /* Only worth it if the mixer's samples are wider */
+        if (mixer.format == SDL_AUDIO_F32 || mixer.format == SDL_AUDIO_S32) {
+            return MIX_COMPACT_S16;
+        }
+    } else if (SDL_strcasecmp(hint, "adpcm") == 0) {
+#ifdef MUSIC_WAV
+        if (load_music_type(MUS_WAV) && open_music_type(MUS_WAV)) {
+            return MIX_COMPACT_ADPCM;
+        }
+#endif
+    }
+    return MIX_COMPACT_NONE;
+}
+
+/* Load a wave file, once src is known to be valid */
+static Mix_Chunk *load_wav(SDL_RWops *src, SDL_bool freesrc)
+{
+    Uint8 magic[4];
+    Mix_Chunk *chunk;
+    SDL_AudioSpec wavespec, *loaded, target;
+    SDL_bool native_rate;
+    int compact;
+
+    /* Allocate the chunk memory */
+    native_rate = SDL_GetHintBoolean(SDL_MIXER_HINT_NATIVE_RATE_CHUNKS, SDL_FALSE);
+    compact = _Mix_CompactChunks();
+    if (native_rate || compact == MIX_COMPACT_ADPCM) {
+        chunk = (Mix_Chunk *)SDL_malloc(sizeof(Mix_ChunkExt));
+    } else {
+        chunk = (Mix_Chunk *)SDL_malloc(sizeof(Mix_Chunk));
+    }
+    if (chunk == NULL) {
+        Mix_OutOfMemory();
+        if (freesrc) {
+            SDL_RWclose(src);
+        }
+        return NULL;
+    }
 
-        if (!first) {
-            first = fragment;
+    /* Find out what kind of audio file this is */
+    if (SDL_RWread(src, magic, 4) != 4) {
+        SDL_free(chunk);
+        if (freesrc) {
+            SDL_RWclose(src);
         }
-        if (last) {
-            last->next = fragment;
+        Mix_SetError("Couldn't read first 4 bytes of audio data");
+        return NULL;
+    }
+    /* Seek backwards for compatibility with older loaders */
+    SDL_RWseek(src, -4, SDL_RW_SEEK_CUR);
+
+    /* First try loading via libsndfile */
+    loaded = Mix_LoadSndFile_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
+
+    if (!loaded)  {
+        if (SDL_memcmp(magic, "WAVE", 4) == 0 || SDL_memcmp(magic, "RIFF", 4) == 0) {
+            loaded = (SDL_LoadWAV_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen) == 0) ? &wavespec : NULL;
+        } else if (SDL_memcmp(magic, "FORM", 4) == 0) {
+            loaded = Mix_LoadAIFF_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
+        } else if (SDL_memcmp(magic, "Crea", 4) == 0) {
+            loaded = Mix_LoadVOC_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
+        } else {
+            loaded = Mix_LoadMusic_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
         }
-        last = fragment;
-        ++count;
+    }
+    if (!loaded) {
+        /* The individual loaders have closed src if needed */
+        SDL_free(chunk);
+        return NULL;
     }
 
-    if (interface->Stop) {
-        interface->Stop(music);
+#if 0
+    PrintFormat("Audio device", &mixer);
+    PrintFormat("-- Wave file", &wavespec);
+#endif
+
+    chunk->allocated = 1;
+    chunk->volume = MIX_MAX_VOLUME;
+
+    /* Native rate chunks are resampled as they're mixed */
+    target = mixer;
+    if (native_rate) {
+        target.freq = wavespec.freq;
+        chunk->allocated |= MIX_CHUNK_NATIVE_RATE;
+        ((Mix_ChunkExt *)chunk)->freq = wavespec.freq;
     }
 
-    if (music) {
-        interface->Delete(music);
+    /* Compact chunks are kept as S16, and expanded as they're mixed */
+    if (compact != MIX_COMPACT_NONE) {
+        target.format = SDL_AUDIO_S16;
     }
 
-    Mix_UnlockAudio();
+    /* Build the audio converter and create conversion buffers */
+    if (wavespec.format != target.format ||
+        wavespec.channels != target.channels ||
+        wavespec.freq != target.freq) {
+
+        Uint8 *dst_data = NULL;
+        int dst_len = 0;
+
+        if (SDL_ConvertAudioSamples(&wavespec, chunk->abuf, chunk->alen, &target, &dst_data, &dst_len) < 0) {
+            SDL_free(chunk->abuf);
+            SDL_free(chunk);
+            return NULL;
+        }
+
+        SDL_free(chunk->abuf);
+        chunk->abuf = dst_data;
+        chunk->alen = dst_len;
+    }
+
+    if (compact == MIX_COMPACT_S16) {
+        chunk->allocated |= MIX_CHUNK_COMPACT;
+    }
+#ifdef MUSIC_WAV
+    if (compact == MIX_COMPACT_ADPCM) {
+        /* Becomes a compressed chunk that the WAV decoder plays */
+        Mix_ChunkExt *ext = (Mix_ChunkExt *)chunk;
+        size_t size = 0;
+        void *wav = WAV_EncodeIMAADPCM((const Sint16 *)chunk->abuf, chunk->alen / (2 * target.channels),
+                                       target.channels, target.freq, &size);
+        SDL_free(chunk->abuf);
+        if (!wav) {
+            SDL_free(chunk);
+            return NULL;
+        }
+        chunk->abuf = (Uint8 *)wav;
+        chunk->alen = (Uint32)size;
+        chunk->allocated = 1 | MIX_CHUNK_COMPRESSED;
+        ext->freq = mixer.freq;
+        ext->interface = &Mix_MusicInterface_WAV;
+    }
+#endif
+
+    return chunk;
+}
+
+/* Map the result of an earlier load from SDL_MIXER_HINT_PCM_CACHE_DIR, or
+   load the file as usual and store the result there */
+static Mix_Chunk *load_wav_pcm_cached(SDL_RWops *src, SDL_bool freesrc)
+{
+    Mix_PCMCacheKey key;
+    Mix_ChunkExt *ext;
+    Mix_Chunk *chunk;
+    SDL_RWops *mem;
+    SDL_AudioSpec target;
+    SDL_bool native_rate;
+    const Uint8 *map;
+    size_t size, map_size = 0;
+    Uint32 length = 0;
+    void *data;
+    int freq = 0, compact;
+
+    /* ADPCM chunks aren't PCM, so there's nothing to cache */
+    compact = _Mix_CompactChunks();
+    if (compact == MIX_COMPACT_ADPCM) {
+        return load_wav(src, freesrc);
+    }
+
+    data = SDL_LoadFile_RW(src, &size, freesrc);
+    if (!data) {
+        return NULL;
+    }
+    native_rate = SDL_GetHintBoolean(SDL_MIXER_HINT_NATIVE_RATE_CHUNKS, SDL_FALSE);
+    target = mixer;
+    if (compact == MIX_COMPACT_S16) {
+        target.format = SDL_AUDIO_S16;
+    }
+    _Mix_InitPCMCacheKey(&key, data, size, &target, native_rate);
+
+    map = _Mix_MapPCMCache(&key, &map_size, &freq, &length);
+    if (map) {
+        _Mix_FreePCMCacheKey(&key);
+        SDL_free(data);
+        ext = (Mix_ChunkExt *)SDL_calloc(1, sizeof(*ext));
+        if (!ext) {
+            _Mix_UnmapFile(map, map_size);
+            Mix_OutOfMemory();
+            return NULL;
+        }
+        ext->chunk.allocated = MIX_CHUNK_MAPPED;
+        if (native_rate) {
+            ext->chunk.allocated |= MIX_CHUNK_NATIVE_RATE;
+        }
+        if (compact == MIX_COMPACT_S16) {
+            ext->chunk.allocated |= MIX_CHUNK_COMPACT;
+        }
+        ext->chunk.abuf = (Uint8 *)map + MIX_PCM_CACHE_HEADER_SIZE;
+        ext->chunk.alen = length;
+        ext->chunk.volume = MIX_MAX_VOLUME;
+        ext->freq = freq;
+        ext->map = map;
+        ext->map_size = map_size;
+        return &ext->chunk;
+    }
+
+    mem = SDL_RWFromConstMem(data, size);
+    if (!mem) {
+        _Mix_FreePCMCacheKey(&key);
+        SDL_free(data);
+        return NULL;
+    }
+    chunk = load_wav(mem, SDL_TRUE);
+    if (chunk) {
+        if (chunk->allocated & MIX_CHUNK_NATIVE_RATE) {
+            freq = ((Mix_ChunkExt *)chunk)->freq;
+        } else {
+            freq = mixer.freq;
+        }
+        _Mix_StorePCMCache(&key, freq, chunk->abuf, chunk->alen);
+    }
+    _Mix_FreePCMCacheKey(&key);
+    SDL_free(data);
+    return chunk;
+}
+
+/* Load a wave file */
+Mix_Chunk *Mix_LoadWAV_RW(SDL_RWops *src, SDL_bool freesrc)
+{
+    const char *cache_dir;
+
+    /* rcg06012001 Make sure src is valid */
+    if (!src) {
+        Mix_SetError("Mix_LoadWAV_RW with NULL src");
+        return NULL;
+    }
+
+    /* Make sure audio has been opened */
+    if (!audio_opened) {
+        Mix_SetError("Audio device hasn't been opened");
+        if (freesrc) {
+            SDL_RWclose(src);
+        }
+        return NULL;
+    }
+
+    cache_dir = SDL_GetHint(SDL_MIXER_HINT_PCM_CACHE_DIR);
+    if (cache_dir && *cache_dir) {
+        return load_wav_pcm_cached(src, freesrc);
+    }
+    return load_wav(src, freesrc);
+}
+
+Mix_Chunk *Mix_LoadWAV(const char *file)
+{
+    return Mix_LoadWAV_RW(SDL_RWFromFile(file, "rb"), 1);
+}
+
+/* Load a compressed file into memory as it is, to be decoded as it plays */
+Mix_Chunk *Mix_LoadCompressedWAV_RW(SDL_RWops *src, SDL_bool freesrc)
+{
+    Mix_ChunkExt *chunk;
+    Mix_MusicType music_type;
+    Mix_MusicInterface *interface = NULL;
+    SDL_RWops *mem;
+    void *data, *music;
+    size_t size;
+
+    if (!src) {
+        Mix_SetError("Mix_LoadCompressedWAV_RW with NULL src");
+        return NULL;
+    }
+
+    /* Make sure audio has been opened */
+    if (!audio_opened) {
+        Mix_SetError("Audio device hasn't been opened");
+        if (freesrc) {
+            SDL_RWclose(src);
+        }
+        return NULL;
+    }
+
+    data = SDL_LoadFile_RW(src, &size, freesrc);
+    if (!data) {
+        return NULL;
+    }
+    if (size > SDL_MAX_UINT32) {
+        SDL_free(data);
+        Mix_SetError("Compressed audio data too large");
+        return NULL;
+    }
 
-    if (count > 0) {
-        *audio_len = (count - 1) * fragment_size + last->size;
-        *audio_buf = (Uint8 *)SDL_malloc(*audio_len);
-        if (*audio_buf) {
-            Uint8 *dst = *audio_buf;
-            for (fragment = first; fragment; fragment = fragment->next) {
-                SDL_memcpy(dst, fragment->data, fragment->size);
-                dst += fragment->size;
+    /* Make sure there's a decoder that takes it, and remember which */
+    mem = SDL_RWFromConstMem(data, size);
+    if (!mem) {
+        SDL_free(data);
+        return NULL;
+    }
+    music_type = detect_music_type(mem);
+    switch (music_type) {
+    case MUS_NONE:
+    case MUS_CMD:
+    case MUS_MID:
+        SDL_RWclose(mem);
+        SDL_free(data);
+        Mix_SetError("Unsupported format for a compressed chunk");
+        return NULL;
+    default:
+        break;
+    }
+    if (!load_music_type(music_type) || !open_music_type(music_type)) {
+        SDL_RWclose(mem);
+        SDL_free(data);
+        return NULL;
+    }
+    music = create_chunk_decoder(mem, SDL_TRUE, music_type, &interface);
+    if (!music) {
+        SDL_RWclose(mem);
+        SDL_free(data);
+        return NULL;
+    }
+    interface->Delete(music);
+
+    chunk = (Mix_ChunkExt *)SDL_calloc(1, sizeof(*chunk));
+    if (!chunk) {
+        SDL_free(data);
+        Mix_OutOfMemory();
+        return NULL;
+    }
+    chunk->chunk.allocated = 1 | MIX_CHUNK_COMPRESSED;
+    chunk->chunk.abuf = (Uint8 *)data;
+    chunk->chunk.alen = (Uint32)size;
+    chunk->chunk.volume = MIX_MAX_VOLUME;
+    chunk->freq = mixer.freq;
+    chunk->interface = interface;
+    return &chunk->chunk;
+}
+
+Mix_Chunk *Mix_LoadCompressedWAV(const char *file)
+{
+    return Mix_LoadCompressedWAV_RW(SDL_RWFromFile(file, "rb"), 1);
+}
+
+#define WAV_LE16(p) ((Uint16)((p)[0] | ((p)[1] << 8)))
+#define WAV_LE32(p) ((Uint32)(p)[0] | ((Uint32)(p)[1] << 8) | ((Uint32)(p)[2] << 16) | ((Uint32)(p)[3] << 24))
+
+/* Find the format and the samples of an uncompressed WAV file in memory,
+   making sure that every chunk up to the samples is within 'size' bytes.
+   Returns -1 for anything that can't be played straight from memory. */
+static int find_wav_samples(const Uint8 *data, size_t size, SDL_AudioSpec *spec, size_t *offset, Uint32 *length)
+{
+    static const Uint8 subformat_tail[14] = {
+        0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+    };
+    SDL_bool have_fmt = SDL_FALSE;
+    Uint16 encoding = 0, bits = 0, align = 0;
+    size_t pos = 12;
+
+    if (size < 12 || SDL_memcmp(data, "RIFF", 4) != 0 || SDL_memcmp(data + 8, "WAVE", 4) != 0) {
+        return Mix_SetError("Not a WAVE file");
+    }
+    while (size - pos >= 8) {
+        const Uint8 *chunk = data + pos;
+        Uint32 chunk_len = WAV_LE32(chunk + 4);
+
+        pos += 8;
+        if (chunk_len > size - pos) {
+            return Mix_SetError("WAVE chunk extends past the end of the file");
+        }
+        if (SDL_memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunk_len < 16) {
+                return Mix_SetError("Invalid WAVE fmt chunk");
+            }
+            encoding = WAV_LE16(chunk + 8);
+            spec->channels = WAV_LE16(chunk + 10);
+            spec->freq = (int)WAV_LE32(chunk + 12);
+            align = WAV_LE16(chunk + 20);
+            bits = WAV_LE16(chunk + 22);
+            if (encoding == 0xFFFE) {
+                /* WAVE_FORMAT_EXTENSIBLE, the encoding is in the subformat GUID */
+                if (chunk_len < 40 || SDL_memcmp(chunk + 34, subformat_tail, sizeof(subformat_tail)) != 0) {
+                    return Mix_SetError("Unsupported WAVE subformat");
+                }
+                encoding = WAV_LE16(chunk + 32);
+            }
+            have_fmt = SDL_TRUE;
+        } else if (SDL_memcmp(chunk, "data", 4) == 0) {
+            if (!have_fmt) {
+                return Mix_SetError("WAVE data chunk comes before the fmt chunk");
+            }
+            if (encoding == 1 && bits == 8) {
+                spec->format = SDL_AUDIO_U8;
+            } else if (encoding == 1 && bits == 16) {
+                spec->format = SDL_AUDIO_S16LE;
+            } else if (encoding == 1 && bits == 32) {
+                spec->format = SDL_AUDIO_S32LE;
+            } else if (encoding == 3 && bits == 32) {
+                spec->format = SDL_AUDIO_F32LE;
+            } else {
+                return Mix_SetError("Unsupported WAVE encoding");
+            }
+            if (spec->channels == 0 || spec->freq <= 0 ||
+                align != spec->channels * (bits / 8)) {
+                return Mix_SetError("Invalid WAVE fmt chunk");
+            }
+            /* The mixer reads whole samples, so they must be aligned */
+            if (pos % (bits / 8) != 0) {
+                return Mix_SetError("Misaligned WAVE samples");
             }
-        } else {
-            Mix_OutOfMemory();
-            spec = NULL;
+            *offset = pos;
+            *length = chunk_len - (chunk_len % align);
+            return 0;
+        }
+        /* Chunks are padded to an even size */
+        pos += chunk_len;
+        if ((chunk_len & 1) && pos < size) {
+            ++pos;
         }
-    } else {
-        Mix_SetError("No audio data");
-        spec = NULL;
-    }
-
-    while (first) {
-        fragment = first;
-        first = first->next;
-        SDL_free(fragment->data);
-        SDL_free(fragment);
-    }
-
-    if (freesrc) {
-        SDL_RWclose(src);
     }
-    return spec;
+    return Mix_SetError("No WAVE data chunk");
 }
 
-/* Load a wave file */
-Mix_Chunk *Mix_LoadWAV_RW(SDL_RWops *src, SDL_bool freesrc)
+/* Map a WAV file into memory, playing it from there if it's in the right format */
+Mix_Chunk *Mix_LoadWAVMapped(const char *file)
 {
-    Uint8 magic[4];
-    Mix_Chunk *chunk;
-    SDL_AudioSpec wavespec, *loaded;
+    Mix_ChunkExt *chunk;
+    Mix_Chunk *loaded;
+    SDL_AudioSpec wavespec, target;
+    SDL_bool native_rate, compact;
+    SDL_RWops *src;
+    const Uint8 *data;
+    size_t size, offset = 0;
+    Uint32 length = 0;
 
-    /* rcg06012001 Make sure src is valid */
-    if (!src) {
-        Mix_SetError("Mix_LoadWAV_RW with NULL src");
+    if (!file) {
+        Mix_SetError("Mix_LoadWAVMapped with NULL file");
         return NULL;
     }
 
     /* Make sure audio has been opened */
     if (!audio_opened) {
         Mix_SetError("Audio device hasn't been opened");
-        if (freesrc) {
-            SDL_RWclose(src);
-        }
         return NULL;
     }
 
-    /* Allocate the chunk memory */
-    chunk = (Mix_Chunk *)SDL_malloc(sizeof(Mix_Chunk));
-    if (chunk == NULL) {
-        Mix_OutOfMemory();
-        if (freesrc) {
-            SDL_RWclose(src);
-        }
+    data = _Mix_MapFile(file, &size);
+    if (!data) {
         return NULL;
     }
 
-    /* Find out what kind of audio file this is */
-    if (SDL_RWread(src, magic, 4) != 4) {
-        SDL_free(chunk);
-        if (freesrc) {
-            SDL_RWclose(src);
+    native_rate = SDL_GetHintBoolean(SDL_MIXER_HINT_NATIVE_RATE_CHUNKS, SDL_FALSE);
+    compact = (_Mix_CompactChunks() == MIX_COMPACT_S16) ? SDL_TRUE : SDL_FALSE;
+    target = mixer;
+    if (compact) {
+        target.format = SDL_AUDIO_S16;
+    }
+    if (find_wav_samples(data, size, &wavespec, &offset, &length) == 0) {
+        if (native_rate) {
+            target.freq = wavespec.freq;
+        }
+        if (wavespec.format == target.format &&
+            wavespec.channels == target.channels &&
+            wavespec.freq == target.freq) {
+            chunk = (Mix_ChunkExt *)SDL_calloc(1, sizeof(*chunk));
+            if (!chunk) {
+                _Mix_UnmapFile(data, size);
+                Mix_OutOfMemory();
+                return NULL;
+            }
+            /* Not allocated, the samples stay in the mapping */
+            chunk->chunk.allocated = MIX_CHUNK_MAPPED;
+            chunk->chunk.abuf = (Uint8 *)data + offset;
+            chunk->chunk.alen = length;
+            chunk->chunk.volume = MIX_MAX_VOLUME;
+            chunk->freq = wavespec.freq;
+            if (native_rate) {
+                chunk->chunk.allocated |= MIX_CHUNK_NATIVE_RATE;
+            }
+            if (compact) {
+                chunk->chunk.allocated |= MIX_CHUNK_COMPACT;
+            }
+            chunk->map = data;
+            chunk->map_size = size;
+            return &chunk->chunk;
         }
-        Mix_SetError("Couldn't read first 4 bytes of audio data");
-        return NULL;
     }
-    /* Seek backwards for compatibility with older loaders */
-    SDL_RWseek(src, -4, SDL_RW_SEEK_CUR);
 
-    /* First try loading via libsndfile */
-    loaded = Mix_LoadSndFile_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
-
-    if (!loaded)  {
-        if (SDL_memcmp(magic, "WAVE", 4) == 0 || SDL_memcmp(magic, "RIFF", 4) == 0) {
-            loaded = (SDL_LoadWAV_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen) == 0) ? &wavespec : NULL;
-        } else if (SDL_memcmp(magic, "FORM", 4) == 0) {
-            loaded = Mix_LoadAIFF_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
-        } else if (SDL_memcmp(magic, "Crea", 4) == 0) {
-            loaded = Mix_LoadVOC_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
-        } else {
-            loaded = Mix_LoadMusic_RW(src, freesrc, &wavespec, (Uint8 **)&chunk->abuf, &chunk->alen);
-        }
-    }
-    if (!loaded) {
-        /* The individual loaders have closed src if needed */
-        SDL_free(chunk);
+    /* Any other format is loaded and converted as usual, from the mapping */
+    src = SDL_RWFromConstMem(data, size);
+    if (!src) {
+        _Mix_UnmapFile(data, size);
         return NULL;
     }
-
-#if 0
-    PrintFormat("Audio device", &mixer);
-    PrintFormat("-- Wave file", &wavespec);
-#endif
-
-    chunk->allocated = 1;
-    chunk->volume = MIX_MAX_VOLUME;
-
-    /* Build the audio converter and create conversion buffers */
-    if (wavespec.format != mixer.format ||
-        wavespec.channels != mixer.channels ||
-        wavespec.freq != mixer.freq) {
-
-        Uint8 *dst_data = NULL;
-        int dst_len = 0;
-
-        if (SDL_ConvertAudioSamples(&wavespec, chunk->abuf, chunk->alen, &mixer, &dst_data, &dst_len) < 0) {
-            SDL_free(chunk->abuf);
-            SDL_free(chunk);
-            return NULL;
-        }
-
-        SDL_free(chunk->abuf);
-        chunk->abuf = dst_data;
-        chunk->alen = dst_len;
-    }
-
-    return chunk;
-}
-
-Mix_Chunk *Mix_LoadWAV(const char *file)
-{
-    return Mix_LoadWAV_RW(SDL_RWFromFile(file, "rb"), 1);
+    loaded = Mix_LoadWAV_RW(src, SDL_TRUE);
+    _Mix_UnmapFile(data, size);
+    return loaded;
 }
 
 
@@ -948,41 +2577,96 @@ Mix_Chunk *Mix_QuickLoad_RAW(Uint8 *mem, Uint32 len)
 static void  Mix_HaltChannel_locked(int which)
 {
     if (Mix_Playing(which)) {
-        mix_channel[which].playing = 0;
-        mix_channel[which].looping = 0;
+        mix_voice[which].playing = 0;
+        mix_voice[which].looping = 0;
         _Mix_channel_done_playing(which);
     }
     mix_channel[which].expire = 0;
     if (mix_channel[which].fading != MIX_NO_FADING) /* Restore volume */
-        mix_channel[which].volume = mix_channel[which].fade_volume_reset;
+        mix_voice[which].volume = mix_channel[which].fade_volume_reset;
     mix_channel[which].fading = MIX_NO_FADING;
 }
 
-/* Free an audio chunk previously loaded */
-void Mix_FreeChunk(Mix_Chunk *chunk)
+/* Guarantee that none of 'count' chunks at 'chunks' is playing, or queued to play */
+void _Mix_HaltChunks(const Mix_Chunk *chunks, int count)
 {
     int i;
 
+    Mix_LockAudio();
+    run_commands(SDL_FALSE);
+    cancel_timed_commands(chunks, count);
+    if (mix_channel) {
+        for (i = 0; i < num_channels; ++i) {
+            const Mix_Chunk *chunk = mix_voice[i].chunk;
+            if (chunk >= chunks && chunk < chunks + count) {
+                Mix_HaltChannel_locked(i);
+            }
+        }
+    }
+    Mix_UnlockAudio();
+}
+
+void _Mix_CancelMusicCommands(const Mix_Music *music)
+{
+    Mix_LockAudio();
+    run_commands(SDL_FALSE);
+    cancel_timed_music_commands(music);
+    Mix_UnlockAudio();
+}
+
+/* Free an audio chunk previously loaded */
+void Mix_FreeChunk(Mix_Chunk *chunk)
+{
     /* Caution -- if the chunk is playing, the mixer will crash */
     if (chunk) {
-        /* Guarantee that this chunk isn't playing */
-        Mix_LockAudio();
-        if (mix_channel) {
-            for (i = 0; i < num_channels; ++i) {
-                if (chunk == mix_channel[i].chunk) {
-                    Mix_HaltChannel_locked(i);
-                }
-            }
+        if (chunk->allocated & MIX_CHUNK_CACHED) {
+            /* The cache frees it once nobody uses it */
+            _Mix_ReleaseCachedChunk(chunk);
+            return;
+        }
+        _Mix_HaltChunks(chunk, 1);
+        if (chunk->allocated & MIX_CHUNK_BANK) {
+            /* Mix_CloseBank() frees it */
+            return;
         }
-        Mix_UnlockAudio();
         /* Actually free the chunk */
-        if (chunk->allocated) {
+        if (chunk->allocated & MIX_CHUNK_MAPPED) {
+            Mix_ChunkExt *ext = (Mix_ChunkExt *)chunk;
+            _Mix_UnmapFile(ext->map, ext->map_size);
+        } else if (chunk->allocated) {
             SDL_free(chunk->abuf);
         }
         SDL_free(chunk);
     }
 }
 
+int Mix_SubmitCommands(const Mix_Command *commands, int count, Mix_CommandDone_t callback, void *udata)
+{
+    int i;
+
+    if (!commands && count > 0) {
+        return Mix_SetError("Tried to submit a NULL command array");
+    }
+    for (i = 0; i < count; ++i) {
+        /* Starting a decoder allocates and may read, which the audio callback mustn't */
+        if (commands[i].type == MIX_COMMAND_PLAY_CHANNEL && commands[i].chunk &&
+            (commands[i].chunk->allocated & MIX_CHUNK_COMPRESSED)) {
+            return Mix_SetError("Compressed chunks can't be played by a queued command");
+        }
+    }
+    return _Mix_PushCommands(commands, count, callback, udata);
+}
+
+Uint64 Mix_GetMixedFrames(void)
+{
+    Uint64 frames;
+
+    Mix_LockAudio();
+    frames = mixed_frames;
+    Mix_UnlockAudio();
+    return frames;
+}
+
 /* Set a function that is called after all mixing is performed.
    This can be used to provide real-time visual display of the audio stream
    or add a custom mixer filter for the stream data.
@@ -1040,32 +2724,39 @@ int Mix_ReserveChannels(int num)
     return num;
 }
 
+/* The size of a sample frame in an uncompressed chunk */
+static int chunk_frame_size(const Mix_Chunk *chunk)
+{
+    if (chunk->allocated & MIX_CHUNK_COMPACT) {
+        return (int)sizeof(Sint16) * mixer.channels;
+    }
+    return (SDL_AUDIO_BITSIZE(mixer.format) / 8) * mixer.channels;
+}
+
 static int checkchunkintegral(Mix_Chunk *chunk)
 {
-    int frame_width = 1;
+    int frame_width = chunk_frame_size(chunk);
 
-    if ((mixer.format & 0xFF) == 16) frame_width = 2;
-    frame_width *= mixer.channels;
+    if (chunk->allocated & MIX_CHUNK_COMPRESSED) {
+        /* The decoder takes care of that */
+        return chunk->alen;
+    }
     while (chunk->alen % frame_width) chunk->alen--;
     return chunk->alen;
 }
 
-/* Play an audio chunk on a specific channel.
-   If the specified channel is -1, play on the first free channel.
-   'ticks' is the number of milliseconds at most to play the sample, or -1
-   if there is no limit.
-   Returns which channel was used to play the sound.
+/* Play 'length' bytes of a chunk from 'offset', looping over just those.
+   For a compressed chunk, that has to be all of it.
 */
-int Mix_PlayChannelTimed(int which, Mix_Chunk *chunk, int loops, int ticks)
+static int play_channel(int which, Mix_Chunk *chunk, Uint32 offset, Uint32 length, int loops, int ticks)
 {
-    int i;
+    void *decoder = NULL;
 
-    /* Don't play null pointers :-) */
-    if (chunk == NULL) {
-        return Mix_SetError("Tried to play a NULL chunk");
-    }
-    if (!checkchunkintegral(chunk)) {
-        return Mix_SetError("Tried to play a chunk with a bad frame");
+    if (chunk->allocated & MIX_CHUNK_COMPRESSED) {
+        decoder = start_chunk_decoder(chunk, loops);
+        if (!decoder) {
+            return -1;
+        }
     }
 
     /* Lock the mixer while modifying the playing channels */
@@ -1073,45 +2764,98 @@ int Mix_PlayChannelTimed(int which, Mix_Chunk *chunk, int loops, int ticks)
     {
         /* If which is -1, play on the first free channel */
         if (which == -1) {
-            for (i = reserved_channels; i < num_channels; ++i) {
-                if (!Mix_Playing(i))
-                    break;
-            }
-            if (i == num_channels) {
+            which = _Mix_FindFreeChannel(reserved_channels);
+            if (which < 0) {
                 Mix_SetError("No free channels available");
-                which = -1;
-            } else {
-                which = i;
             }
-        } else {
-            if (Mix_Playing(which))
+        } else if (which >= 0 && which < num_channels) {
+            if (Mix_Playing(which) || mix_channel[which].finished)
                 _Mix_channel_done_playing(which);
         }
 
         /* Queue up the audio data for this channel */
         if (which >= 0 && which < num_channels) {
-            Uint64 sdl_ticks = SDL_GetTicks();
-            mix_channel[which].samples = chunk->abuf;
-            mix_channel[which].playing = (int)chunk->alen;
-            mix_channel[which].looping = loops;
-            mix_channel[which].chunk = chunk;
+            Uint64 sdl_ticks = mixer_ticks();
+            mix_voice[which].start = chunk->abuf + offset;
+            mix_voice[which].length = (int)length;
+            mix_voice[which].samples = mix_voice[which].start;
+            mix_voice[which].playing = decoder ? 1 : (int)length;
+            mix_voice[which].looping = loops;
+            mix_voice[which].chunk = chunk;
+            mix_voice[which].rate = 1.0f;
+            mix_voice[which].frac = 0;
+            mix_voice[which].decoder = decoder;
+            decoder = NULL;
             mix_channel[which].paused = 0;
             mix_channel[which].fading = MIX_NO_FADING;
             mix_channel[which].start_time = sdl_ticks;
             mix_channel[which].expire = (ticks > 0) ? (sdl_ticks + ticks) : 0;
+            _Mix_ChannelStarted(which);
         }
     }
     Mix_UnlockAudio();
 
+    if (decoder) {
+        /* There was no channel to play it on */
+        ((Mix_ChunkExt *)chunk)->interface->Delete(decoder);
+    }
+
     /* Return the channel on which the sound is being played */
     return which;
 }
 
+/* Play an audio chunk on a specific channel.
+   If the specified channel is -1, play on the first free channel.
+   'ticks' is the number of milliseconds at most to play the sample, or -1
+   if there is no limit.
+   Returns which channel was used to play the sound.
+*/
+int Mix_PlayChannelTimed(int which, Mix_Chunk *chunk, int loops, int ticks)
+{
+    /* Don't play null pointers :-) */
+    if (chunk == NULL) {
+        return Mix_SetError("Tried to play a NULL chunk");
+    }
+    if (!checkchunkintegral(chunk)) {
+        return Mix_SetError("Tried to play a chunk with a bad frame");
+    }
+    return play_channel(which, chunk, 0, chunk->alen, loops, ticks);
+}
+
 int Mix_PlayChannel(int channel, Mix_Chunk *chunk, int loops)
 {
     return Mix_PlayChannelTimed(channel, chunk, loops, -1);
 }
 
+/* Play part of an audio chunk, given in sample frames */
+int Mix_PlayChannelRegion(int which, Mix_Chunk *chunk, int offset, int length, int loops, int ticks)
+{
+    int frame_size, frames;
+
+    if (chunk == NULL) {
+        return Mix_SetError("Tried to play a NULL chunk");
+    }
+    if (chunk->allocated & MIX_CHUNK_COMPRESSED) {
+        return Mix_SetError("Regions of compressed chunks can't be played");
+    }
+    if (!checkchunkintegral(chunk)) {
+        return Mix_SetError("Tried to play a chunk with a bad frame");
+    }
+
+    /* The region has to be whole frames within the chunk */
+    frame_size = chunk_frame_size(chunk);
+    frames = (int)(chunk->alen / (Uint32)frame_size);
+    if (offset < 0 || offset >= frames) {
+        return Mix_SetError("Region starts outside the chunk");
+    }
+    if (length < 0) {
+        length = frames - offset;
+    } else if (length == 0 || length > frames - offset) {
+        return Mix_SetError("Region doesn't fit in the chunk");
+    }
+    return play_channel(which, chunk, (Uint32)offset * frame_size, (Uint32)length * frame_size, loops, ticks);
+}
+
 /* Change the expiration delay for a channel */
 int Mix_ExpireChannel(int which, int ticks)
 {
@@ -1124,7 +2868,7 @@ int Mix_ExpireChannel(int which, int ticks)
         }
     } else if (which < num_channels) {
         Mix_LockAudio();
-        mix_channel[which].expire = (ticks>0) ? (SDL_GetTicks() + (Uint32)ticks) : 0;
+        mix_channel[which].expire = (ticks>0) ? (mixer_ticks() + (Uint32)ticks) : 0;
         Mix_UnlockAudio();
         ++status;
     }
@@ -1134,7 +2878,7 @@ int Mix_ExpireChannel(int which, int ticks)
 /* Fade in a sound on a channel, over ms milliseconds */
 int Mix_FadeInChannelTimed(int which, Mix_Chunk *chunk, int loops, int ms, int ticks)
 {
-    int i;
+    void *decoder = NULL;
 
     /* Don't play null pointers :-) */
     if (chunk == NULL) {
@@ -1143,47 +2887,57 @@ int Mix_FadeInChannelTimed(int which, Mix_Chunk *chunk, int loops, int ms, int t
     if (!checkchunkintegral(chunk)) {
         return Mix_SetError("Tried to play a chunk with a bad frame");
     }
+    if (chunk->allocated & MIX_CHUNK_COMPRESSED) {
+        decoder = start_chunk_decoder(chunk, loops);
+        if (!decoder) {
+            return -1;
+        }
+    }
 
     /* Lock the mixer while modifying the playing channels */
     Mix_LockAudio();
     {
         /* If which is -1, play on the first free channel */
         if (which == -1) {
-            for (i = reserved_channels; i < num_channels; ++i) {
-                if (!Mix_Playing(i))
-                    break;
-            }
-            if (i == num_channels) {
-                which = -1;
-            } else {
-                which = i;
-            }
-        } else {
-            if (Mix_Playing(which))
+            which = _Mix_FindFreeChannel(reserved_channels);
+        } else if (which >= 0 && which < num_channels) {
+            if (Mix_Playing(which) || mix_channel[which].finished)
                 _Mix_channel_done_playing(which);
         }
 
         /* Queue up the audio data for this channel */
         if (which >= 0 && which < num_channels) {
-            Uint64 sdl_ticks = SDL_GetTicks();
-            mix_channel[which].samples = chunk->abuf;
-            mix_channel[which].playing = (int)chunk->alen;
-            mix_channel[which].looping = loops;
-            mix_channel[which].chunk = chunk;
+            Uint64 sdl_ticks = mixer_ticks();
+            mix_voice[which].start = chunk->abuf;
+            mix_voice[which].length = (int)chunk->alen;
+            mix_voice[which].samples = chunk->abuf;
+            mix_voice[which].playing = decoder ? 1 : (int)chunk->alen;
+            mix_voice[which].looping = loops;
+            mix_voice[which].chunk = chunk;
+            mix_voice[which].rate = 1.0f;
+            mix_voice[which].frac = 0;
+            mix_voice[which].decoder = decoder;
+            decoder = NULL;
             mix_channel[which].paused = 0;
             if (mix_channel[which].fading == MIX_NO_FADING) {
-                mix_channel[which].fade_volume_reset = mix_channel[which].volume;
+                mix_channel[which].fade_volume_reset = mix_voice[which].volume;
             }
             mix_channel[which].fading = MIX_FADING_IN;
-            mix_channel[which].fade_volume = mix_channel[which].volume;
-            mix_channel[which].volume = 0;
+            mix_channel[which].fade_volume = mix_voice[which].volume;
+            mix_voice[which].volume = 0;
             mix_channel[which].fade_length = (Uint64)ms;
             mix_channel[which].start_time = mix_channel[which].ticks_fade = sdl_ticks;
             mix_channel[which].expire = (ticks > 0) ? (sdl_ticks + ticks) : 0;
+            _Mix_ChannelStarted(which);
         }
     }
     Mix_UnlockAudio();
 
+    if (decoder) {
+        /* There was no channel to play it on */
+        ((Mix_ChunkExt *)chunk)->interface->Delete(decoder);
+    }
+
     /* Return the channel on which the sound is being played */
     return which;
 }
@@ -1206,12 +2960,12 @@ int Mix_Volume(int which, int volume)
         }
         prev_volume /= num_channels;
     } else if (which < num_channels) {
-        prev_volume = mix_channel[which].volume;
+        prev_volume = mix_voice[which].volume;
         if (volume >= 0) {
             if (volume > MIX_MAX_VOLUME) {
                 volume = MIX_MAX_VOLUME;
             }
-            mix_channel[which].volume = volume;
+            mix_voice[which].volume = volume;
         }
     }
     return prev_volume;
@@ -1234,6 +2988,37 @@ int Mix_VolumeChunk(Mix_Chunk *chunk, int volume)
     return prev_volume;
 }
 
+/* Set the playback rate of the sound on a particular channel */
+int Mix_SetChannelPlaybackRate(int which, float rate)
+{
+    int i;
+
+    if (!(rate > 0.0f && rate <= MIX_MAX_PLAYBACK_RATE)) {
+        return Mix_SetError("Playback rate %g out of range", (double)rate);
+    }
+
+    if (which == -1) {
+        for (i = 0; i < num_channels; ++i) {
+            Mix_SetChannelPlaybackRate(i, rate);
+        }
+    } else if (which >= 0 && which < num_channels) {
+        int retval = 0;
+
+        Mix_LockAudio();
+        if (mix_voice[which].decoder && rate != 1.0f) {
+            /* The decoder's output goes straight into the mix */
+            retval = Mix_SetError("Compressed chunks only play at a rate of 1.0");
+        } else {
+            mix_voice[which].rate = rate;
+        }
+        Mix_UnlockAudio();
+        return retval;
+    } else {
+        return Mix_SetError("Invalid channel %d", which);
+    }
+    return 0;
+}
+
 /* Halt playing of a particular channel */
 int Mix_HaltChannel(int which)
 {
@@ -1280,15 +3065,15 @@ int Mix_FadeOutChannel(int which, int ms)
         } else if (which < num_channels) {
             Mix_LockAudio();
             if (Mix_Playing(which) &&
-                (mix_channel[which].volume > 0) &&
+                (mix_voice[which].volume > 0) &&
                 (mix_channel[which].fading != MIX_FADING_OUT)) {
-                mix_channel[which].fade_volume = mix_channel[which].volume;
+                mix_channel[which].fade_volume = mix_voice[which].volume;
                 mix_channel[which].fade_length = (Uint64)ms;
-                mix_channel[which].ticks_fade = SDL_GetTicks();
+                mix_channel[which].ticks_fade = mixer_ticks();
 
                 /* only change fade_volume_reset if we're not fading. */
                 if (mix_channel[which].fading == MIX_NO_FADING) {
-                    mix_channel[which].fade_volume_reset = mix_channel[which].volume;
+                    mix_channel[which].fade_volume_reset = mix_voice[which].volume;
                 }
 
                 mix_channel[which].fading = MIX_FADING_OUT;
@@ -1334,15 +3119,15 @@ int Mix_Playing(int which)
         int i;
 
         for (i = 0; i < num_channels; ++i) {
-            if ((mix_channel[i].playing > 0) ||
-                mix_channel[i].looping)
+            if ((mix_voice[i].playing > 0) ||
+                mix_voice[i].looping)
             {
                 ++status;
             }
         }
     } else if (which < num_channels) {
-        if ((mix_channel[which].playing > 0) ||
-             mix_channel[which].looping)
+        if ((mix_voice[which].playing > 0) ||
+             mix_voice[which].looping)
         {
             ++status;
         }
@@ -1356,7 +3141,7 @@ Mix_Chunk *Mix_GetChunk(int channel)
     Mix_Chunk *retval = NULL;
 
     if ((channel >= 0) && (channel < num_channels)) {
-        retval = mix_channel[channel].chunk;
+        retval = mix_voice[channel].chunk;
     }
 
     return retval;
@@ -1369,27 +3154,58 @@ void Mix_CloseAudio(void)
 
     if (audio_opened) {
         if (audio_opened == 1) {
+            /* Background loads use the mixer, let them finish first */
+            _Mix_QuitAsyncLoad();
+            if (mix_ahead_thread) {
+                SDL_AtomicSet(&mix_ahead_quit, 1);
+                SDL_WaitThread(mix_ahead_thread, NULL);
+                mix_ahead_thread = NULL;
+            }
+            Mix_LockAudio();
+            run_commands(SDL_FALSE);
+            run_timed_commands(SDL_MAX_UINT64, SDL_FALSE);
+            Mix_UnlockAudio();
+            _Mix_QuitChunkCache();
             for (i = 0; i < num_channels; i++) {
                 Mix_UnregisterAllEffects(i);
             }
             Mix_UnregisterAllEffects(MIX_CHANNEL_POST);
+            /* Compressed chunks are decoded by the music interfaces */
+            Mix_HaltChannel(-1);
             close_music();
             Mix_SetMusicCMD(NULL);
-            Mix_HaltChannel(-1);
             _Mix_DeinitEffects();
             SDL_DestroyAudioStream(audio_stream);
             audio_stream = NULL;
-            SDL_CloseAudioDevice(audio_device);
-            audio_device = 0;
+            if (audio_device) {
+                SDL_CloseAudioDevice(audio_device);
+                audio_device = 0;
+            }
+            headless = SDL_FALSE;
+            stop_mix_workers();
+            if (realtime) {
+                _Mix_RTCheckQuit();
+                realtime = SDL_FALSE;
+            }
             SDL_free(mix_channel);
             mix_channel = NULL;
+            SDL_free(mix_voice);
+            mix_voice = NULL;
+            _Mix_FreeChannelIndex();
+            _Mix_QuitCommandQueue();
             SDL_aligned_free(audio_mixbuf);
             audio_mixbuf = NULL;
+            SDL_aligned_free(audio_effectbuf);
+            audio_effectbuf = NULL;
             audio_mixbuflen = 0;
             /* rcg06042009 report available decoders at runtime. */
             SDL_free((void *)chunk_decoders);
             chunk_decoders = NULL;
             num_decoders = 0;
+            if (mix_ahead_lock) {
+                SDL_DestroyMutex(mix_ahead_lock);
+                mix_ahead_lock = NULL;
+            }
         }
         --audio_opened;
     }
@@ -1398,7 +3214,7 @@ void Mix_CloseAudio(void)
 /* Pause a particular channel (or all) */
 void Mix_Pause(int which)
 {
-    Uint64 sdl_ticks = SDL_GetTicks();
+    Uint64 sdl_ticks = mixer_ticks();
     if (which == -1) {
         int i;
 
@@ -1430,7 +3246,7 @@ int Mix_PauseGroup(int tag)
 /* Resume a paused channel */
 void Mix_Resume(int which)
 {
-    Uint64 sdl_ticks = SDL_GetTicks();
+    Uint64 sdl_ticks = mixer_ticks();
 
     Mix_LockAudio();
     if (which == -1) {
@@ -1489,14 +3305,19 @@ int Mix_Paused(int which)
 /* Change the group of a channel */
 int Mix_GroupChannel(int which, int tag)
 {
-    if (which < 0 || which > num_channels) {
+    int retval = 0;
+
+    if (which < 0 || which >= num_channels) {
         return 0;
     }
 
     Mix_LockAudio();
-    mix_channel[which].tag = tag;
+    if (_Mix_SetChannelTag(which, tag) == 0) {
+        mix_channel[which].tag = tag;
+        retval = 1;
+    }
     Mix_UnlockAudio();
-    return 1;
+    return retval;
 }
 
 /* Assign several consecutive channels to a group */
@@ -1512,61 +3333,43 @@ int Mix_GroupChannels(int from, int to, int tag)
 /* Finds the first available channel in a group of channels */
 int Mix_GroupAvailable(int tag)
 {
-    int i;
-    for (i = 0; i < num_channels; i++) {
-        if ((tag == -1 || tag == mix_channel[i].tag) && !Mix_Playing(i)) {
-            return i;
-        }
-    }
-    return -1;
+    int chan;
+
+    Mix_LockAudio();
+    chan = _Mix_GroupFirstFree(tag);
+    Mix_UnlockAudio();
+    return chan;
 }
 
 int Mix_GroupCount(int tag)
 {
-    int count = 0;
-    int i;
-
-    if (tag == -1) {
-        return num_channels;  /* minor optimization; no need to go through the loop. */
-    }
+    int count;
 
-    for (i = 0; i < num_channels; i++) {
-        if (mix_channel[i].tag == tag) {
-            ++count;
-        }
-    }
+    Mix_LockAudio();
+    count = _Mix_GroupSize(tag);
+    Mix_UnlockAudio();
     return count;
 }
 
 /* Finds the "oldest" sample playing in a group of channels */
 int Mix_GroupOldest(int tag)
 {
-    int chan = -1;
-    Uint64 mintime = SDL_GetTicks();
-    int i;
-    for (i = 0; i < num_channels; i++) {
-        if ((mix_channel[i].tag == tag || tag == -1) && Mix_Playing(i)
-             && mix_channel[i].start_time <= mintime) {
-            mintime = mix_channel[i].start_time;
-            chan = i;
-        }
-    }
+    int chan;
+
+    Mix_LockAudio();
+    chan = _Mix_GroupOldestBusy(tag);
+    Mix_UnlockAudio();
     return chan;
 }
 
 /* Finds the "most recent" (i.e. last) sample playing in a group of channels */
 int Mix_GroupNewer(int tag)
 {
-    int chan = -1;
-    Uint64 maxtime = 0;
-    int i;
-    for (i = 0; i < num_channels; i++) {
-        if ((mix_channel[i].tag == tag || tag == -1) && Mix_Playing(i)
-             && mix_channel[i].start_time >= maxtime) {
-            maxtime = mix_channel[i].start_time;
-            chan = i;
-        }
-    }
+    int chan;
+
+    Mix_LockAudio();
+    chan = _Mix_GroupNewestBusy(tag);
+    Mix_UnlockAudio();
     return chan;
 }
 
@@ -1768,12 +3571,20 @@ int Mix_UnregisterAllEffects(int channel)
 
 void Mix_LockAudio(void)
 {
-    SDL_LockAudioStream(audio_stream);
+    if (mix_ahead_lock) {
+        SDL_LockMutex(mix_ahead_lock);
+    } else {
+        SDL_LockAudioStream(audio_stream);
+    }
 }
 
 void Mix_UnlockAudio(void)
 {
-    SDL_UnlockAudioStream(audio_stream);
+    if (mix_ahead_lock) {
+        SDL_UnlockMutex(mix_ahead_lock);
+    } else {
+        SDL_UnlockAudioStream(audio_stream);
+    }
 }
 
 int Mix_MasterVolume(int volume)
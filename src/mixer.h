@@ -27,6 +27,29 @@ extern void Mix_UnlockAudio(void);
 
 extern void add_chunk_decoder(const char *decoder);
 
+/* Halt every channel playing one of 'count' chunks in an array */
+extern void _Mix_HaltChunks(const Mix_Chunk *chunks, int count);
+
+/* Run the queued commands and drop the timed ones that would play 'music' */
+extern void _Mix_CancelMusicCommands(const Mix_Music *music);
+
+/* Flags in Mix_Chunk::allocated for chunks that aren't plain PCM owned by
+   the app, besides the low bit that says abuf is to be freed */
+#define MIX_CHUNK_NATIVE_RATE   0x100   /* abuf is at its own rate, see SDL_MIXER_HINT_NATIVE_RATE_CHUNKS */
+#define MIX_CHUNK_COMPRESSED    0x200   /* abuf is encoded, see Mix_LoadCompressedWAV_RW() */
+#define MIX_CHUNK_CACHED        0x400   /* owned by the chunk cache, see Mix_LoadWAVCached() */
+#define MIX_CHUNK_MAPPED        0x800   /* abuf points into a mapped file, see Mix_LoadWAVMapped() */
+#define MIX_CHUNK_BANK          0x1000  /* owned by a sound bank, see Mix_OpenBank() */
+#define MIX_CHUNK_COMPACT       0x2000  /* abuf is S16, not the mixer's format, see SDL_MIXER_HINT_COMPACT_CHUNKS */
+
+/* Values of _Mix_CompactChunks(), see SDL_MIXER_HINT_COMPACT_CHUNKS */
+#define MIX_COMPACT_NONE    0
+#define MIX_COMPACT_S16     1   /* S16 samples, MIX_CHUNK_COMPACT */
+#define MIX_COMPACT_ADPCM   2   /* an IMA ADPCM WAV file, MIX_CHUNK_COMPRESSED */
+
+/* How chunks loaded now are to be stored, one of MIX_COMPACT_* */
+extern int _Mix_CompactChunks(void);
+
 #endif /* MIXER_H_ */
 
 /* vi: set ts=4 sw=4 expandtab: */
@@ -43,6 +43,7 @@
 #include "music_gme.h"
 #include "native_midi/native_midi.h"
 
+#include "music_ahead.h"
 #include "utils.h"
 
 /* Check to make sure we are building with a new enough SDL */
@@ -66,19 +67,73 @@ struct _Mix_Music {
 
     SDL_bool playing;
     Mix_Fading fading;
-    int fade_step;
-    int fade_steps;
+    Uint64 fade_frame;
+    Uint64 fade_frames;
 
     char filename[1024];
 };
 
-/* Used to calculate fading steps */
-static int ms_per_step;
+/* Fades are counted in sample frames at this rate, 0 while the audio
+   device is closed */
+static int music_fade_freq = 0;
+
+/* Music streams play alongside the music, each decoded at full volume into
+   music_stream_buf and mixed in at its own volume and fade. They're paused
+   on their own, and keep playing when Mix_HookMusic() replaces the music. */
+#define MIX_DEFAULT_MUSIC_STREAMS   2
+
+typedef struct
+{
+    Mix_Music *music;
+    int volume;
+    SDL_bool paused;
+} Mix_MusicStream;
+
+static Mix_MusicStream *music_streams = NULL;
+static int num_music_streams = 0;
+static Uint8 *music_stream_buf = NULL;
+static int music_stream_buf_len = 0;
+
+/* Decoder output for music played below full volume, sized in open_music()
+   so that the audio thread normally never has to allocate it */
+static Uint8 *music_scratch = NULL;
+static int music_scratch_len = 0;
+
+/* The volume music decoded ahead is taken at, see music_decoded_ahead() */
+static int music_ahead_volume = MIX_MAX_VOLUME;
+
+/* Music queued with Mix_QueueMusic(), already started and with its first
+   frames decoded at full volume, so it can take over without a gap */
+#define MIX_MUSIC_PRIME_FRAMES  4096
+
+typedef struct Mix_QueuedMusic
+{
+    Mix_Music *music;
+    Uint8 *primed;
+    int primed_len;
+    struct Mix_QueuedMusic *next;
+} Mix_QueuedMusic;
+
+static Mix_QueuedMusic *music_queue = NULL;
+
+/* The primed frames of queued music that took over, which play before
+   anything more is decoded, and the volume music_internal_volume() last set
+   to play them at */
+static Uint8 *music_primed = NULL;
+static int music_primed_len = 0;
+static int music_primed_pos = 0;
+static int music_primed_volume = MIX_MAX_VOLUME;
 
 /* rcg06042009 report available decoders at runtime. */
 static const char **music_decoders = NULL;
 static int num_decoders = 0;
 
+/* Serializes loading and opening the music interfaces, which may happen on
+   several threads at once (see Mix_LoadWAVAsync()). Codec libraries can take
+   a long time to start up, reading configs and SoundFonts, so this isn't the
+   audio lock: the audio callback keeps running meanwhile. */
+static SDL_Mutex *music_init_lock = NULL;
+
 /* Semicolon-separated SoundFont paths */
 static char* soundfont_paths = NULL;
 
@@ -281,6 +336,25 @@ void Mix_HookMusicFinished(void (SDLCALL *music_finished)(void))
     Mix_UnlockAudio();
 }
 
+/* Support for hooking when a music stream has finished */
+static void (SDLCALL *music_stream_finished_hook)(int stream) = NULL;
+
+void Mix_HookMusicStreamFinished(void (SDLCALL *stream_finished)(int stream))
+{
+    Mix_LockAudio();
+    music_stream_finished_hook = stream_finished;
+    Mix_UnlockAudio();
+}
+
+/* The number of frames a fade of 'ms' milliseconds takes */
+static Uint64 music_fade_length(int ms)
+{
+    if (ms <= 0) {
+        return 0;
+    }
+    return (((Uint64)ms * (Uint64)music_fade_freq) + 999) / 1000;
+}
+
 /* Convenience function to fill audio and mix at the specified volume
    This is called from many music player's GetAudio callback.
  */
@@ -297,7 +371,15 @@ int music_pcm_getaudio(void *context, void *data, int bytes, int volume,
     if (volume == MIX_MAX_VOLUME) {
         dst = snd;
     } else {
-        dst = SDL_stack_alloc(Uint8, (size_t)bytes);
+        if (music_scratch_len < bytes) {
+            void *ptr = SDL_realloc(music_scratch, (size_t)bytes);
+            if (!ptr) {
+                return bytes;
+            }
+            music_scratch = (Uint8 *)ptr;
+            music_scratch_len = bytes;
+        }
+        dst = music_scratch;
     }
     while (len > 0 && !done) {
         int consumed = GetSome(context, dst, len, &done);
@@ -322,46 +404,235 @@ int music_pcm_getaudio(void *context, void *data, int bytes, int volume,
         }
         len -= consumed;
     }
-    if (volume != MIX_MAX_VOLUME) {
-        SDL_stack_free(dst);
-    }
     return len;
 }
 
-/* Mixing function */
-void SDLCALL music_mixer(void *udata, Uint8 *stream, int len)
+/* Music that the decode ahead thread decodes, instead of the audio callback.
+   Its decoder stays at full volume, and the music's volume and fades are
+   applied as the callback takes it off the ring. */
+static SDL_bool music_decoded_ahead(const Mix_Music *music)
 {
-    SDL_bool done = SDL_FALSE;
+    return (music->interface->GetAudio && _Mix_MusicAheadRunning()) ? SDL_TRUE : SDL_FALSE;
+}
 
-    (void)udata;
+/* Decode the playing music for the decode ahead thread */
+static int decode_music_ahead(Uint8 *dst, int len)
+{
+    Mix_Music *music = music_playing;
+
+    if (!music || !music_decoded_ahead(music)) {
+        return -1;
+    }
+    return music->interface->GetAudio(music->context, dst, len);
+}
+
+/* Take decoded music off the ring at the music's volume */
+static int read_music_ahead(Uint8 *stream, int len, SDL_bool *ended)
+{
+    int total = 0;
+
+    if (music_ahead_volume == MIX_MAX_VOLUME || music_scratch_len <= 0) {
+        return _Mix_ReadMusicAhead(stream, len, ended);
+    }
+
+    *ended = SDL_FALSE;
+    while (total < len && !*ended) {
+        int want = SDL_min(len - total, music_scratch_len);
+        int got = _Mix_ReadMusicAhead(music_scratch, want, ended);
+
+        SDL_MixAudioFormat(stream + total, music_scratch, music_spec.format, (Uint32)got, music_ahead_volume);
+        total += got;
+        if (got < want) {
+            break;
+        }
+    }
+    return total;
+}
+
+/* Throw away whatever was decoded ahead of the playing music, after it was
+   started, stopped or moved.
+   MAKE SURE you hold both the audio lock and the decoder lock! */
+static void flush_music_decoded(void)
+{
+    _Mix_FlushMusicAhead();
+    SDL_free(music_primed);
+    music_primed = NULL;
+    music_primed_len = 0;
+    music_primed_pos = 0;
+}
+
+/* Stop everything in the music queue.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void clear_music_queue(void)
+{
+    while (music_queue) {
+        Mix_QueuedMusic *queued = music_queue;
+
+        music_queue = queued->next;
+        if (queued->music->interface->Stop) {
+            queued->music->interface->Stop(queued->music->context);
+        }
+        SDL_free(queued->primed);
+        SDL_free(queued);
+    }
+}
+
+/* Whether 'music' is waiting in the music queue.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static SDL_bool music_is_queued(const Mix_Music *music)
+{
+    const Mix_QueuedMusic *queued;
+
+    for (queued = music_queue; queued; queued = queued->next) {
+        if (queued->music == music) {
+            return SDL_TRUE;
+        }
+    }
+    return SDL_FALSE;
+}
+
+/* Take 'music' out of the music queue, if it's there.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void remove_queued_music(Mix_Music *music)
+{
+    Mix_QueuedMusic **prev;
+
+    for (prev = &music_queue; *prev; prev = &(*prev)->next) {
+        Mix_QueuedMusic *queued = *prev;
+
+        if (queued->music == music) {
+            *prev = queued->next;
+            if (music->interface->Stop) {
+                music->interface->Stop(music->context);
+            }
+            SDL_free(queued->primed);
+            SDL_free(queued);
+            return;
+        }
+    }
+}
+
+/* Make queued music the music, starting with its primed frames.
+   MAKE SURE you hold both the audio lock and the decoder lock! */
+static void start_queued_music(Mix_QueuedMusic *queued)
+{
+    music_playing = queued->music;
+    music_playing->playing = SDL_TRUE;
+    music_internal_volume(music_volume);
+
+    flush_music_decoded();
+    music_primed = queued->primed;
+    music_primed_len = queued->primed_len;
+    SDL_free(queued);
+}
+
+/* Hand over from music that has ended to the first queued music, in the
+   audio callback. Like halting, this mustn't wait for the decode ahead
+   thread; if that's busy, this returns SDL_FALSE and the next callback
+   tries again. */
+static SDL_bool music_play_queued_from_callback(void)
+{
+    Mix_QueuedMusic *next = music_queue;
+
+    if (!_Mix_TryLockMusicDecoder()) {
+        return SDL_FALSE;
+    }
+    if (music_playing->interface->Stop) {
+        music_playing->interface->Stop(music_playing->context);
+    }
+    music_playing->playing = SDL_FALSE;
+    music_playing->fading = MIX_NO_FADING;
+
+    music_queue = next->next;
+    start_queued_music(next);
+    _Mix_UnlockMusicDecoder();
+
+    if (music_finished_hook) {
+        music_finished_hook();
+    }
+    return SDL_TRUE;
+}
+
+/* Stop the music from the audio callback, which mustn't wait for the decode
+   ahead thread; if that's busy, this returns SDL_FALSE and the next callback
+   tries again. */
+static SDL_bool music_halt_from_callback(void)
+{
+    if (!_Mix_TryLockMusicDecoder()) {
+        return SDL_FALSE;
+    }
+    music_internal_halt();
+    _Mix_UnlockMusicDecoder();
+    clear_music_queue();
+
+    if (music_finished_hook) {
+        music_finished_hook();
+    }
+    return SDL_TRUE;
+}
+
+/* Mix the music into 'stream', which may overwrite what's there */
+static void mix_playing_music(Uint8 *stream, int len)
+{
+    const int frame_size = (SDL_AUDIO_BITSIZE(music_spec.format) / 8) * music_spec.channels;
+    SDL_bool done = SDL_FALSE;
 
     while (music_playing && music_active && len > 0 && !done) {
-        /* Handle fading */
+        /* Handle fading, counted in frames; the decoder takes the volume
+           the fade reaches by the end of what's decoded now */
         if (music_playing->fading != MIX_NO_FADING) {
-            if (music_playing->fade_step++ < music_playing->fade_steps) {
+            Uint64 fade_frames = music_playing->fade_frames;
+
+            if (music_playing->fade_frame < fade_frames) {
+                Uint64 fade_frame = SDL_min(music_playing->fade_frame + (Uint64)(len / frame_size), fade_frames);
                 int volume;
-                int fade_step = music_playing->fade_step;
-                int fade_steps = music_playing->fade_steps;
 
                 if (music_playing->fading == MIX_FADING_OUT) {
-                    volume = (music_volume * (fade_steps-fade_step)) / fade_steps;
+                    volume = (int)((music_volume * (fade_frames - fade_frame)) / fade_frames);
                 } else { /* Fading in */
-                    volume = (music_volume * fade_step) / fade_steps;
+                    volume = (int)((music_volume * fade_frame) / fade_frames);
                 }
                 music_internal_volume(volume);
+                music_playing->fade_frame = fade_frame;
             } else {
                 if (music_playing->fading == MIX_FADING_OUT) {
-                    music_internal_halt();
-                    if (music_finished_hook) {
-                        music_finished_hook();
-                    }
+                    music_halt_from_callback();
                     return;
                 }
                 music_playing->fading = MIX_NO_FADING;
             }
         }
 
-        if (music_playing->interface->GetAudio) {
+        /* Queued music that took over starts with what was primed */
+        if (music_primed) {
+            int n = SDL_min(len, music_primed_len - music_primed_pos);
+
+            SDL_MixAudioFormat(stream, music_primed + music_primed_pos, music_spec.format, (Uint32)n, music_primed_volume);
+            music_primed_pos += n;
+            stream += n;
+            len -= n;
+            if (music_primed_pos == music_primed_len) {
+                SDL_free(music_primed);
+                music_primed = NULL;
+                music_primed_len = 0;
+                music_primed_pos = 0;
+            }
+        }
+
+        if (len > 0 && music_decoded_ahead(music_playing)) {
+            SDL_bool ended = SDL_FALSE;
+            int got = read_music_ahead(stream, len, &ended);
+
+            if (ended) {
+                music_playing->playing = SDL_FALSE;
+                done = SDL_TRUE;
+            } else if (got < len) {
+                /* The decoding fell behind, so there's a gap */
+                done = SDL_TRUE;
+            }
+            stream += got;
+            len -= got;
+        } else if (len > 0 && music_playing->interface->GetAudio) {
             int left = music_playing->interface->GetAudio(music_playing->context, stream, len);
             if (left != 0) {
                 /* Either an error or finished playing with data left */
@@ -378,12 +649,224 @@ void SDLCALL music_mixer(void *udata, Uint8 *stream, int len)
             len = 0;
         }
 
-        if (!music_internal_playing()) {
-            music_internal_halt();
-            if (music_finished_hook) {
-                music_finished_hook();
+        /* A short piece of music may have been decoded to its end already */
+        if (!music_primed && !music_internal_playing()) {
+            if (music_queue) {
+                /* Carry on with the queued music in the same buffer */
+                done = !music_play_queued_from_callback();
+            } else {
+                music_halt_from_callback();
+            }
+        }
+    }
+}
+
+/* Scale 'frames' frames of 'buf' in place, by a gain that goes linearly
+   from 'from' to 'to' over them. Returns SDL_FALSE for sample formats that
+   aren't handled here. */
+static SDL_bool ramp_music_gain(Uint8 *buf, int frames, float from, float to)
+{
+    const int channels = music_spec.channels;
+    const float step = (to - from) / (float)frames;
+    float gain = from;
+    int i, c;
+
+    switch (music_spec.format) {
+    case SDL_AUDIO_U8:
+        for (i = 0; i < frames; ++i, gain += step) {
+            for (c = 0; c < channels; ++c, ++buf) {
+                *buf = (Uint8)((float)(*buf - 128) * gain + 128.0f);
+            }
+        }
+        break;
+    case SDL_AUDIO_S8:
+        for (i = 0; i < frames; ++i, gain += step) {
+            for (c = 0; c < channels; ++c, ++buf) {
+                *(Sint8 *)buf = (Sint8)((float)*(Sint8 *)buf * gain);
+            }
+        }
+        break;
+    case SDL_AUDIO_S16:
+        {
+            Sint16 *samples = (Sint16 *)buf;
+            for (i = 0; i < frames; ++i, gain += step) {
+                for (c = 0; c < channels; ++c, ++samples) {
+                    *samples = (Sint16)((float)*samples * gain);
+                }
+            }
+        }
+        break;
+    case SDL_AUDIO_S32:
+        {
+            Sint32 *samples = (Sint32 *)buf;
+            for (i = 0; i < frames; ++i, gain += step) {
+                for (c = 0; c < channels; ++c, ++samples) {
+                    *samples = (Sint32)((double)*samples * gain);
+                }
+            }
+        }
+        break;
+    case SDL_AUDIO_F32:
+        {
+            float *samples = (float *)buf;
+            for (i = 0; i < frames; ++i, gain += step) {
+                for (c = 0; c < channels; ++c, ++samples) {
+                    *samples *= gain;
+                }
+            }
+        }
+        break;
+    default:
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+/* The gain of a music stream 'frame' frames into its fade */
+static float music_stream_gain(const Mix_MusicStream *s, Uint64 frame)
+{
+    const Mix_Music *music = s->music;
+    float gain = (float)s->volume / MIX_MAX_VOLUME;
+
+    if (music->fading == MIX_FADING_IN) {
+        gain *= (float)frame / (float)music->fade_frames;
+    } else if (music->fading == MIX_FADING_OUT) {
+        gain *= (float)(music->fade_frames - frame) / (float)music->fade_frames;
+    }
+    return gain;
+}
+
+/* The music stream 'music' is playing on, or -1.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static int find_music_stream(const Mix_Music *music)
+{
+    int i;
+
+    for (i = 0; i < num_music_streams; ++i) {
+        if (music_streams[i].music == music) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Whether MIDI music other than 'music' is playing on a music stream.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static SDL_bool midi_stream_playing(const Mix_Music *music)
+{
+    int i;
+
+    for (i = 0; i < num_music_streams; ++i) {
+        const Mix_Music *other = music_streams[i].music;
+        if (other && other != music && other->interface->type == MUS_MID) {
+            return SDL_TRUE;
+        }
+    }
+    return SDL_FALSE;
+}
+
+/* Stop a music stream.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void music_stream_halt(int stream)
+{
+    Mix_Music *music = music_streams[stream].music;
+
+    if (music->interface->Stop) {
+        music->interface->Stop(music->context);
+    }
+    music->playing = SDL_FALSE;
+    music->fading = MIX_NO_FADING;
+    music_streams[stream].music = NULL;
+}
+
+/* Mix a music stream into 'stream', fading it sample by sample */
+static void mix_music_stream(int i, Uint8 *stream, int len)
+{
+    const int frame_size = (SDL_AUDIO_BITSIZE(music_spec.format) / 8) * music_spec.channels;
+    Mix_MusicStream *s = &music_streams[i];
+    Mix_Music *music = s->music;
+    SDL_bool done = SDL_FALSE;
+
+    while (len > 0 && !done) {
+        int frames = SDL_min(len, music_stream_buf_len) / frame_size;
+        int bytes, left;
+        float from, to;
+
+        /* Stop a fade exactly where it ends */
+        if (music->fading != MIX_NO_FADING) {
+            Uint64 fade_left = music->fade_frames - music->fade_frame;
+
+            if (fade_left == 0) {
+                if (music->fading == MIX_FADING_OUT) {
+                    done = SDL_TRUE;
+                    break;
+                }
+                music->fading = MIX_NO_FADING;
+            } else if ((Uint64)frames > fade_left) {
+                frames = (int)fade_left;
             }
         }
+        if (frames == 0) {
+            break;
+        }
+        bytes = frames * frame_size;
+
+        SDL_memset(music_stream_buf, SDL_GetSilenceValueForFormat(music_spec.format), (size_t)bytes);
+        left = music->interface->GetAudio(music->context, music_stream_buf, bytes);
+        if (left != 0) {
+            /* Either an error or finished playing with data left */
+            done = SDL_TRUE;
+            bytes = (left > 0) ? (bytes - left) : 0;
+            frames = bytes / frame_size;
+        }
+
+        from = music_stream_gain(s, music->fade_frame);
+        to = music_stream_gain(s, music->fade_frame + (Uint64)frames);
+        if (music->fading != MIX_NO_FADING) {
+            music->fade_frame += (Uint64)frames;
+        }
+
+        if (frames > 0 && from == 1.0f && to == 1.0f) {
+            SDL_MixAudioFormat(stream, music_stream_buf, music_spec.format, (Uint32)bytes, MIX_MAX_VOLUME);
+        } else if (frames > 0 && ramp_music_gain(music_stream_buf, frames, from, to)) {
+            SDL_MixAudioFormat(stream, music_stream_buf, music_spec.format, (Uint32)bytes, MIX_MAX_VOLUME);
+        } else if (frames > 0) {
+            SDL_MixAudioFormat(stream, music_stream_buf, music_spec.format, (Uint32)bytes, (int)(((from + to) / 2.0f) * MIX_MAX_VOLUME));
+        }
+        stream += bytes;
+        len -= bytes;
+
+        if (!done && music->interface->IsPlaying && !music->interface->IsPlaying(music->context)) {
+            done = SDL_TRUE;
+        }
+    }
+
+    if (done) {
+        music_stream_halt(i);
+        if (music_stream_finished_hook) {
+            music_stream_finished_hook(i);
+        }
+    }
+}
+
+/* Mixing function */
+void SDLCALL music_mixer(void *udata, Uint8 *stream, int len)
+{
+    (void)udata;
+
+    mix_playing_music(stream, len);
+}
+
+/* Mix the music streams, after the music or the hook that replaces it,
+   since those don't always add to the stream */
+void mix_music_streams(Uint8 *stream, int len)
+{
+    int i;
+
+    for (i = 0; i < num_music_streams; ++i) {
+        if (music_streams[i].music && !music_streams[i].paused) {
+            mix_music_stream(i, stream, len);
+        }
     }
 }
 
@@ -393,6 +876,7 @@ void pause_async_music(int pause_on)
         return;
     }
 
+    _Mix_LockMusicDecoder();
     if (pause_on) {
         if (music_playing->interface->Pause) {
             music_playing->interface->Pause(music_playing->context);
@@ -402,13 +886,38 @@ void pause_async_music(int pause_on)
             music_playing->interface->Resume(music_playing->context);
         }
     }
+    _Mix_UnlockMusicDecoder();
+}
+
+/* Create music_init_lock the first time it's needed, by whichever thread
+   gets there first */
+static SDL_Mutex *get_music_init_lock(void)
+{
+    SDL_Mutex *lock = (SDL_Mutex *)SDL_AtomicGetPtr((void **)&music_init_lock);
+
+    if (!lock) {
+        SDL_Mutex *created = SDL_CreateMutex();
+        if (!created) {
+            return NULL;
+        }
+        if (SDL_AtomicCASPtr((void **)&music_init_lock, NULL, created)) {
+            lock = created;
+        } else {
+            SDL_DestroyMutex(created);
+            lock = (SDL_Mutex *)SDL_AtomicGetPtr((void **)&music_init_lock);
+        }
+    }
+    return lock;
 }
 
 /* Load the music interface libraries for a given music type */
 SDL_bool load_music_type(Mix_MusicType type)
 {
+    SDL_Mutex *lock = get_music_init_lock();
     int i;
     int loaded = 0;
+
+    SDL_LockMutex(lock);
     for (i = 0; i < get_num_music_interfaces(); ++i) {
         Mix_MusicInterface *interface = s_music_interfaces[i];
         if (interface->type != type) {
@@ -431,12 +940,14 @@ SDL_bool load_music_type(Mix_MusicType type)
         }
         ++loaded;
     }
+    SDL_UnlockMutex(lock);
     return (loaded > 0) ? SDL_TRUE : SDL_FALSE;
 }
 
 /* Open the music interfaces for a given music type */
 SDL_bool open_music_type(Mix_MusicType type)
 {
+    SDL_Mutex *lock;
     int i;
     int opened = 0;
     SDL_bool use_native_midi = SDL_FALSE;
@@ -446,6 +957,9 @@ SDL_bool open_music_type(Mix_MusicType type)
         return SDL_FALSE;
     }
 
+    lock = get_music_init_lock();
+    SDL_LockMutex(lock);
+
 #ifdef MUSIC_MID_NATIVE
     if (type == MUS_MID && SDL_GetHintBoolean("SDL_NATIVE_MUSIC", SDL_FALSE) && native_midi_detect()) {
         use_native_midi = SDL_TRUE;
@@ -506,10 +1020,37 @@ SDL_bool open_music_type(Mix_MusicType type)
         add_music_decoder("WAVPACK");
         add_chunk_decoder("WAVPACK");
     }
+    SDL_UnlockMutex(lock);
 
     return (opened > 0) ? SDL_TRUE : SDL_FALSE;
 }
 
+/* Start the decode ahead thread, if SDL_MIXER_HINT_MUSIC_DECODE_AHEAD asks
+   for it; music is decoded in the audio callback if this fails. */
+static void start_music_ahead(const SDL_AudioSpec *spec)
+{
+    const int frame_size = (SDL_AUDIO_BITSIZE(spec->format) / 8) * spec->channels;
+    const int block_frames = 1024;
+    const char *hint = SDL_GetHint(SDL_MIXER_HINT_MUSIC_DECODE_AHEAD);
+    int ms, frames, poll_ms;
+
+    ms = hint ? SDL_atoi(hint) : 0;
+    if (ms <= 0) {
+        return;
+    }
+    ms = SDL_min(ms, 10000);
+
+    /* At least two blocks, so one can be decoded while the other plays */
+    frames = (int)(((Sint64)spec->freq * ms) / 1000);
+    frames = SDL_max(frames, 2 * block_frames);
+    poll_ms = SDL_min(ms / 4, (block_frames * 1000) / spec->freq);
+
+    music_ahead_volume = MIX_MAX_VOLUME;
+    if (_Mix_StartMusicAhead(frames * frame_size, block_frames * frame_size, poll_ms, decode_music_ahead) < 0) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO, "Couldn't decode music ahead: %s", Mix_GetError());
+    }
+}
+
 /* Initialize the music interfaces with a certain desired audio format */
 void open_music(const SDL_AudioSpec *spec)
 {
@@ -529,8 +1070,24 @@ void open_music(const SDL_AudioSpec *spec)
 
     Mix_VolumeMusic(MIX_MAX_VOLUME);
 
-    /* Calculate the number of ms for each callback */
-    ms_per_step = (int) ((4096.0f * 1000.0f) / spec->freq);
+    music_fade_freq = spec->freq;
+
+    /* Enough scratch space for a 4096 frame callback */
+    music_scratch_len = 4096 * (SDL_AUDIO_BITSIZE(spec->format) / 8) * spec->channels;
+    music_scratch = (Uint8 *)SDL_malloc((size_t)music_scratch_len);
+    if (!music_scratch) {
+        music_scratch_len = 0;
+    }
+
+    /* Music streams are mixed in pieces of this size */
+    music_stream_buf_len = 4096 * (SDL_AUDIO_BITSIZE(spec->format) / 8) * spec->channels;
+    music_stream_buf = (Uint8 *)SDL_malloc((size_t)music_stream_buf_len);
+    if (!music_stream_buf) {
+        music_stream_buf_len = 0;
+    }
+    Mix_AllocateMusicStreams(MIX_DEFAULT_MUSIC_STREAMS);
+
+    start_music_ahead(spec);
 }
 
 /* Return SDL_TRUE if the music type is available */
@@ -814,6 +1371,8 @@ void Mix_FreeMusic(Mix_Music *music)
     if (music) {
         /* Stop the music if it's currently playing */
         Mix_LockAudio();
+        _Mix_CancelMusicCommands(music);
+        remove_queued_music(music);
         if (music == music_playing) {
             /* Wait for any fade out to finish */
             while (music_active && music->fading == MIX_FADING_OUT) {
@@ -824,6 +1383,20 @@ void Mix_FreeMusic(Mix_Music *music)
             if (music == music_playing) {
                 music_internal_halt();
             }
+        } else {
+            int stream = find_music_stream(music);
+            if (stream >= 0) {
+                /* Wait for any fade out to finish */
+                while (music_active && music->fading == MIX_FADING_OUT) {
+                    Mix_UnlockAudio();
+                    SDL_Delay(100);
+                    Mix_LockAudio();
+                }
+                stream = find_music_stream(music);
+                if (stream >= 0) {
+                    music_stream_halt(stream);
+                }
+            }
         }
         Mix_UnlockAudio();
 
@@ -909,6 +1482,8 @@ static int music_internal_play(Mix_Music *music, int play_count, double position
 {
     int retval = 0;
 
+    _Mix_LockMusicDecoder();
+
     /* Note the music we're playing */
     if (music_playing) {
         music_internal_halt();
@@ -918,6 +1493,9 @@ static int music_internal_play(Mix_Music *music, int play_count, double position
 
     /* Set the initial volume */
     music_internal_initialize_volume();
+    if (music_decoded_ahead(music) && music->interface->SetVolume) {
+        music->interface->SetVolume(music->context, MIX_MAX_VOLUME);
+    }
 
     /* Set up for playback */
     retval = music->interface->Play(music->context, play_count);
@@ -939,6 +1517,8 @@ static int music_internal_play(Mix_Music *music, int play_count, double position
         music->playing = SDL_FALSE;
         music_playing = NULL;
     }
+    flush_music_decoded();
+    _Mix_UnlockMusicDecoder();
     return retval;
 }
 
@@ -946,7 +1526,7 @@ int Mix_FadeInMusicPos(Mix_Music *music, int loops, int ms, double position)
 {
     int retval;
 
-    if (ms_per_step == 0) {
+    if (music_fade_freq == 0) {
         return Mix_SetError("Audio device hasn't been opened");
     }
 
@@ -955,15 +1535,6 @@ int Mix_FadeInMusicPos(Mix_Music *music, int loops, int ms, double position)
         return Mix_SetError("music parameter was NULL");
     }
 
-    /* Setup the data */
-    if (ms) {
-        music->fading = MIX_FADING_IN;
-    } else {
-        music->fading = MIX_NO_FADING;
-    }
-    music->fade_step = 0;
-    music->fade_steps = (ms + ms_per_step - 1) / ms_per_step;
-
     /* Play the puppy */
     Mix_LockAudio();
     /* If the current music is fading out, wait for the fade to complete */
@@ -972,6 +1543,28 @@ int Mix_FadeInMusicPos(Mix_Music *music, int loops, int ms, double position)
         SDL_Delay(100);
         Mix_LockAudio();
     }
+    if (find_music_stream(music) >= 0) {
+        Mix_UnlockAudio();
+        return Mix_SetError("Music is already playing on a music stream");
+    }
+    if (music_is_queued(music)) {
+        Mix_UnlockAudio();
+        return Mix_SetError("Music is already queued");
+    }
+    if (music->interface->type == MUS_MID && midi_stream_playing(NULL)) {
+        Mix_UnlockAudio();
+        return Mix_SetError("MIDI music is already playing on a music stream");
+    }
+
+    /* Setup the data */
+    if (ms) {
+        music->fading = MIX_FADING_IN;
+    } else {
+        music->fading = MIX_NO_FADING;
+    }
+    music->fade_frame = 0;
+    music->fade_frames = music_fade_length(ms);
+
     if (loops == 0) {
         /* Loop is the number of times to play the audio */
         loops = 1;
@@ -992,15 +1585,164 @@ int Mix_PlayMusic(Mix_Music *music, int loops)
     return Mix_FadeInMusicPos(music, loops, 0, 0.0);
 }
 
-/* Jump to a given order in mod music. */
-int Mix_ModMusicJumpToOrder(int order)
+/* Whether 'music' is free to be queued, setting an error if it isn't.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static int check_music_queueable(const Mix_Music *music)
 {
-    int retval = -1;
-
-    Mix_LockAudio();
+    if (music == music_playing || find_music_stream(music) >= 0) {
+        return Mix_SetError("Music is already playing");
+    }
+    if (music_is_queued(music)) {
+        return Mix_SetError("Music is already queued");
+    }
+    if (music->interface->type == MUS_MID && midi_stream_playing(NULL)) {
+        return Mix_SetError("MIDI music is already playing on a music stream");
+    }
+    return 0;
+}
+
+/* Queue music to take over from the music without a gap */
+int Mix_QueueMusic(Mix_Music *music, int loops)
+{
+    const int frame_size = (SDL_AUDIO_BITSIZE(music_spec.format) / 8) * music_spec.channels;
+    Mix_QueuedMusic *queued, **last;
+    int retval, left;
+
+    if (music_fade_freq == 0) {
+        return Mix_SetError("Audio device hasn't been opened");
+    }
+    if (music == NULL) {
+        return Mix_SetError("music parameter was NULL");
+    }
+    if (!music->interface->GetAudio) {
+        return Mix_SetError("%s music can't be queued", music->interface->tag);
+    }
+
+    Mix_LockAudio();
+    if (!music_playing) {
+        /* Nothing to wait for */
+        Mix_UnlockAudio();
+        return Mix_PlayMusic(music, loops);
+    }
+    retval = check_music_queueable(music);
+    Mix_UnlockAudio();
+    if (retval < 0) {
+        return retval;
+    }
+
+    queued = (Mix_QueuedMusic *)SDL_calloc(1, sizeof(*queued));
+    if (queued) {
+        queued->primed = (Uint8 *)SDL_malloc((size_t)MIX_MUSIC_PRIME_FRAMES * frame_size);
+    }
+    if (!queued || !queued->primed) {
+        if (queued) {
+            SDL_free(queued);
+        }
+        return Mix_OutOfMemory();
+    }
+    queued->music = music;
+
+    /* Open and prime the music here, rather than in the audio callback;
+       nothing else uses its decoder until it's queued. MIDI decoders share
+       state with the playing music, so those prime under the audio lock. */
+    if (music->interface->type == MUS_MID) {
+        Mix_LockAudio();
+    }
+    music->fading = MIX_NO_FADING;
+    if (music->interface->SetVolume) {
+        music->interface->SetVolume(music->context, MIX_MAX_VOLUME);
+    }
+    if (loops == 0) {
+        /* Loop is the number of times to play the audio */
+        loops = 1;
+    }
+    retval = music->interface->Play(music->context, loops);
+    if (retval == 0 && music->interface->Seek) {
+        music->interface->Seek(music->context, 0.0);
+    }
+    if (retval == 0) {
+        SDL_memset(queued->primed, SDL_GetSilenceValueForFormat(music_spec.format), (size_t)MIX_MUSIC_PRIME_FRAMES * frame_size);
+        left = music->interface->GetAudio(music->context, queued->primed, MIX_MUSIC_PRIME_FRAMES * frame_size);
+        if (left < 0) {
+            retval = -1;
+        } else {
+            queued->primed_len = MIX_MUSIC_PRIME_FRAMES * frame_size - left;
+        }
+    }
+    if (retval < 0) {
+        if (music->interface->Stop) {
+            music->interface->Stop(music->context);
+        }
+        if (music->interface->type == MUS_MID) {
+            Mix_UnlockAudio();
+        }
+        SDL_free(queued->primed);
+        SDL_free(queued);
+        return retval;
+    }
+
+    if (music->interface->type != MUS_MID) {
+        Mix_LockAudio();
+    }
+    /* It may have been played or queued while this was being primed */
+    retval = check_music_queueable(music);
+    if (retval < 0) {
+        Mix_UnlockAudio();
+        SDL_free(queued->primed);
+        SDL_free(queued);
+        return retval;
+    }
+    if (music_playing) {
+        last = &music_queue;
+        while (*last) {
+            last = &(*last)->next;
+        }
+        *last = queued;
+    } else {
+        /* The music ended while this was being primed */
+        _Mix_LockMusicDecoder();
+        start_queued_music(queued);
+        _Mix_UnlockMusicDecoder();
+        music_active = SDL_TRUE;
+    }
+    Mix_UnlockAudio();
+
+    return 0;
+}
+
+int Mix_GetMusicQueueLength(void)
+{
+    const Mix_QueuedMusic *queued;
+    int count = 0;
+
+    Mix_LockAudio();
+    for (queued = music_queue; queued; queued = queued->next) {
+        ++count;
+    }
+    Mix_UnlockAudio();
+
+    return count;
+}
+
+void Mix_ClearMusicQueue(void)
+{
+    Mix_LockAudio();
+    clear_music_queue();
+    Mix_UnlockAudio();
+}
+
+/* Jump to a given order in mod music. */
+int Mix_ModMusicJumpToOrder(int order)
+{
+    int retval = -1;
+
+    Mix_LockAudio();
     if (music_playing) {
         if (music_playing->interface->Jump) {
+            _Mix_LockMusicDecoder();
             retval = music_playing->interface->Jump(music_playing->context, order);
+            flush_music_decoded();
+            _Mix_UnlockMusicDecoder();
         } else {
             Mix_SetError("Jump not implemented for music type");
         }
@@ -1015,10 +1757,15 @@ int Mix_ModMusicJumpToOrder(int order)
 /* Set the playing music position */
 int music_internal_position(double position)
 {
+    int retval = -1;
+
     if (music_playing->interface->Seek) {
-        return music_playing->interface->Seek(music_playing->context, position);
+        _Mix_LockMusicDecoder();
+        retval = music_playing->interface->Seek(music_playing->context, position);
+        flush_music_decoded();
+        _Mix_UnlockMusicDecoder();
     }
-    return -1;
+    return retval;
 }
 int Mix_SetMusicPosition(double position)
 {
@@ -1042,10 +1789,26 @@ int Mix_SetMusicPosition(double position)
 /* Set the playing music position */
 static double music_internal_position_get(Mix_Music *music)
 {
-    if (music->interface->Tell) {
-        return music->interface->Tell(music->context);
+    double position;
+
+    if (!music->interface->Tell) {
+        return -1;
     }
-    return -1;
+    _Mix_LockMusicDecoder();
+    position = music->interface->Tell(music->context);
+    if (music == music_playing && position > 0.0) {
+        /* The decoder is ahead of what's been heard */
+        int frame_size = (SDL_AUDIO_BITSIZE(music_spec.format) / 8) * music_spec.channels;
+        int buffered = music_primed_len - music_primed_pos;
+
+        if (music_decoded_ahead(music)) {
+            buffered += _Mix_MusicAheadBuffered();
+        }
+        position -= (double)buffered / ((double)music_spec.freq * frame_size);
+        position = SDL_max(position, 0.0);
+    }
+    _Mix_UnlockMusicDecoder();
+    return position;
 }
 double Mix_GetMusicPosition(Mix_Music *music)
 {
@@ -1068,7 +1831,12 @@ double Mix_GetMusicPosition(Mix_Music *music)
 static double music_internal_duration(Mix_Music *music)
 {
     if (music->interface->Duration) {
-        return music->interface->Duration(music->context);
+        double duration;
+
+        _Mix_LockMusicDecoder();
+        duration = music->interface->Duration(music->context);
+        _Mix_UnlockMusicDecoder();
+        return duration;
     } else {
         Mix_SetError("Duration not implemented for music type");
         return -1;
@@ -1095,10 +1863,14 @@ double Mix_MusicDuration(Mix_Music *music)
 /* Get Loop start position */
 static double music_internal_loop_start(Mix_Music *music)
 {
+    double retval = -1;
+
     if (music->interface->LoopStart) {
-        return music->interface->LoopStart(music->context);
+        _Mix_LockMusicDecoder();
+        retval = music->interface->LoopStart(music->context);
+        _Mix_UnlockMusicDecoder();
     }
-    return -1;
+    return retval;
 }
 double Mix_GetMusicLoopStartTime(Mix_Music *music)
 {
@@ -1121,10 +1893,14 @@ double Mix_GetMusicLoopStartTime(Mix_Music *music)
 /* Get Loop end position */
 static double music_internal_loop_end(Mix_Music *music)
 {
+    double retval = -1;
+
     if (music->interface->LoopEnd) {
-        return music->interface->LoopEnd(music->context);
+        _Mix_LockMusicDecoder();
+        retval = music->interface->LoopEnd(music->context);
+        _Mix_UnlockMusicDecoder();
     }
-    return -1;
+    return retval;
 }
 double Mix_GetMusicLoopEndTime(Mix_Music *music)
 {
@@ -1147,10 +1923,14 @@ double Mix_GetMusicLoopEndTime(Mix_Music *music)
 /* Get Loop end position */
 static double music_internal_loop_length(Mix_Music *music)
 {
+    double retval = -1;
+
     if (music->interface->LoopLength) {
-        return music->interface->LoopLength(music->context);
+        _Mix_LockMusicDecoder();
+        retval = music->interface->LoopLength(music->context);
+        _Mix_UnlockMusicDecoder();
     }
-    return -1;
+    return retval;
 }
 double Mix_GetMusicLoopLengthTime(Mix_Music *music)
 {
@@ -1183,6 +1963,11 @@ static void music_internal_initialize_volume(void)
 /* Set the music volume */
 static void music_internal_volume(int volume)
 {
+    music_primed_volume = volume;
+    if (music_decoded_ahead(music_playing)) {
+        music_ahead_volume = volume;
+        return;
+    }
     if (music_playing->interface->SetVolume) {
         music_playing->interface->SetVolume(music_playing->context, volume);
     }
@@ -1209,11 +1994,31 @@ int Mix_VolumeMusic(int volume)
 
 int Mix_GetMusicVolume(Mix_Music *music)
 {
-    int prev_volume;
+    int prev_volume = MIX_MAX_VOLUME;
+    int stream = -1;
 
-    if (music && music->interface->GetVolume)
+    if (music) {
+        Mix_LockAudio();
+        stream = find_music_stream(music);
+        if (stream >= 0) {
+            prev_volume = music_streams[stream].volume;
+        }
+        Mix_UnlockAudio();
+    }
+
+    if (stream >= 0) {
+        /* Its decoder is always at full volume, the stream has the volume */
+        return prev_volume;
+    }
+
+    if (music && music_decoded_ahead(music)) {
+        /* Its decoder is always at full volume */
+        prev_volume = music_volume;
+    } else if (music && music->interface->GetVolume)
         prev_volume = music->interface->GetVolume(music->context);
-    else if (music_playing && music_playing->interface->GetVolume) {
+    else if (music_playing && music_decoded_ahead(music_playing)) {
+        prev_volume = music_volume;
+    } else if (music_playing && music_playing->interface->GetVolume) {
         prev_volume = music_playing->interface->GetVolume(music_playing->context);
     } else {
         prev_volume = music_volume;
@@ -1225,6 +2030,7 @@ int Mix_GetMusicVolume(Mix_Music *music)
 /* Halt playing of music */
 static void music_internal_halt(void)
 {
+    _Mix_LockMusicDecoder();
     if (music_playing->interface->Stop) {
         music_playing->interface->Stop(music_playing->context);
     }
@@ -1232,10 +2038,13 @@ static void music_internal_halt(void)
     music_playing->playing = SDL_FALSE;
     music_playing->fading = MIX_NO_FADING;
     music_playing = NULL;
+    flush_music_decoded();
+    _Mix_UnlockMusicDecoder();
 }
 int Mix_HaltMusic(void)
 {
     Mix_LockAudio();
+    clear_music_queue();
     if (music_playing) {
         music_internal_halt();
         if (music_finished_hook) {
@@ -1252,7 +2061,7 @@ int Mix_FadeOutMusic(int ms)
 {
     int retval = 0;
 
-    if (ms_per_step == 0) {
+    if (music_fade_freq == 0) {
         Mix_SetError("Audio device hasn't been opened");
         return 0;
     }
@@ -1264,21 +2073,22 @@ int Mix_FadeOutMusic(int ms)
 
     Mix_LockAudio();
     if (music_playing) {
-        int fade_steps = (ms + ms_per_step - 1) / ms_per_step;
+        Uint64 fade_frames = music_fade_length(ms);
         if (music_playing->fading == MIX_NO_FADING) {
-            music_playing->fade_step = 0;
+            music_playing->fade_frame = 0;
         } else {
-            int step;
-            int old_fade_steps = music_playing->fade_steps;
+            /* Pick up the fade out from the volume it's at now */
+            Uint64 frame;
+            Uint64 old_fade_frames = music_playing->fade_frames;
             if (music_playing->fading == MIX_FADING_OUT) {
-                step = music_playing->fade_step;
+                frame = music_playing->fade_frame;
             } else {
-                step = old_fade_steps - music_playing->fade_step + 1;
+                frame = old_fade_frames - music_playing->fade_frame;
             }
-            music_playing->fade_step = (step * fade_steps) / old_fade_steps;
+            music_playing->fade_frame = (frame * fade_frames) / old_fade_frames;
         }
         music_playing->fading = MIX_FADING_OUT;
-        music_playing->fade_steps = fade_steps;
+        music_playing->fade_frames = fade_frames;
         retval = 1;
     }
     Mix_UnlockAudio();
@@ -1305,7 +2115,9 @@ void Mix_PauseMusic(void)
     Mix_LockAudio();
     if (music_playing) {
         if (music_playing->interface->Pause) {
+            _Mix_LockMusicDecoder();
             music_playing->interface->Pause(music_playing->context);
+            _Mix_UnlockMusicDecoder();
         }
     }
     music_active = SDL_FALSE;
@@ -1317,7 +2129,9 @@ void Mix_ResumeMusic(void)
     Mix_LockAudio();
     if (music_playing) {
         if (music_playing->interface->Resume) {
+            _Mix_LockMusicDecoder();
             music_playing->interface->Resume(music_playing->context);
+            _Mix_UnlockMusicDecoder();
         }
     }
     music_active = SDL_TRUE;
@@ -1340,10 +2154,15 @@ int Mix_StartTrack(Mix_Music *music, int track)
 
     Mix_LockAudio();
     if (music && music->interface->StartTrack) {
+        _Mix_LockMusicDecoder();
         if (music->interface->Pause) {
             music->interface->Pause(music->context);
         }
         result = music->interface->StartTrack(music->context, track);
+        if (music == music_playing) {
+            flush_music_decoded();
+        }
+        _Mix_UnlockMusicDecoder();
     } else {
         result = Mix_SetError("That operation is not supported");
     }
@@ -1358,7 +2177,9 @@ int Mix_GetNumTracks(Mix_Music *music)
 
     Mix_LockAudio();
     if (music && music->interface->GetNumTracks) {
+        _Mix_LockMusicDecoder();
         result = music->interface->GetNumTracks(music->context);
+        _Mix_UnlockMusicDecoder();
     } else {
         result = Mix_SetError("That operation is not supported");
     }
@@ -1373,7 +2194,8 @@ static SDL_bool music_internal_playing(void)
         return SDL_FALSE;
     }
 
-    if (music_playing->interface->IsPlaying) {
+    /* Music decoded ahead plays until the callback reaches its end */
+    if (music_playing->interface->IsPlaying && !music_decoded_ahead(music_playing)) {
         music_playing->playing = music_playing->interface->IsPlaying(music_playing->context);
     }
     return music_playing->playing;
@@ -1389,6 +2211,386 @@ int Mix_PlayingMusic(void)
     return playing ? 1 : 0;
 }
 
+/* Change the number of music streams, halting any that go away */
+int Mix_AllocateMusicStreams(int numstreams)
+{
+    Mix_MusicStream *streams;
+    int i;
+
+    if (numstreams < 0) {
+        return num_music_streams;
+    }
+
+    Mix_LockAudio();
+    for (i = numstreams; i < num_music_streams; ++i) {
+        if (music_streams[i].music) {
+            music_stream_halt(i);
+            if (music_stream_finished_hook) {
+                music_stream_finished_hook(i);
+            }
+        }
+    }
+    if (numstreams == 0) {
+        SDL_free(music_streams);
+        music_streams = NULL;
+        num_music_streams = 0;
+    } else if (numstreams != num_music_streams) {
+        streams = (Mix_MusicStream *)SDL_realloc(music_streams, numstreams * sizeof(*streams));
+        if (streams) {
+            for (i = num_music_streams; i < numstreams; ++i) {
+                streams[i].music = NULL;
+                streams[i].volume = MIX_MAX_VOLUME;
+                streams[i].paused = SDL_FALSE;
+            }
+            music_streams = streams;
+            num_music_streams = numstreams;
+        } else {
+            Mix_OutOfMemory();
+            num_music_streams = SDL_min(num_music_streams, numstreams);
+        }
+    }
+    Mix_UnlockAudio();
+    return num_music_streams;
+}
+
+/* Check a music stream index, setting the error if it's out of range.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static SDL_bool valid_music_stream(int stream)
+{
+    if (stream < 0 || stream >= num_music_streams) {
+        Mix_SetError("Invalid music stream %d", stream);
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+/* Start 'music' on a music stream.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static int music_stream_play(int stream, Mix_Music *music, int loops, int ms)
+{
+    int retval;
+
+    if (!valid_music_stream(stream)) {
+        return -1;
+    }
+    if (music != music_streams[stream].music &&
+        (music == music_playing || find_music_stream(music) >= 0 || music_is_queued(music))) {
+        return Mix_SetError("Music is already playing");
+    }
+    if (music->interface->type == MUS_MID) {
+        /* The MIDI interfaces have one player between them, which the
+           music only uses for one thing at a time */
+        const Mix_QueuedMusic *queued;
+
+        if (music_playing && music_playing->interface->type == MUS_MID) {
+            return Mix_SetError("MIDI music is already playing");
+        }
+        for (queued = music_queue; queued; queued = queued->next) {
+            if (queued->music->interface->type == MUS_MID) {
+                return Mix_SetError("MIDI music is already queued");
+            }
+        }
+        if (midi_stream_playing(music_streams[stream].music)) {
+            return Mix_SetError("MIDI music is already playing on a music stream");
+        }
+    }
+
+    if (music_streams[stream].music) {
+        music_stream_halt(stream);
+    }
+
+    music->fading = (ms > 0) ? MIX_FADING_IN : MIX_NO_FADING;
+    music->fade_frame = 0;
+    music->fade_frames = music_fade_length(ms);
+
+    /* The stream's volume and fade are applied as it's mixed */
+    if (music->interface->SetVolume) {
+        music->interface->SetVolume(music->context, MIX_MAX_VOLUME);
+    }
+    if (loops == 0) {
+        /* Loop is the number of times to play the audio */
+        loops = 1;
+    }
+    retval = music->interface->Play(music->context, loops);
+    if (retval == 0 && music->interface->Seek) {
+        music->interface->Seek(music->context, 0.0);
+    }
+    if (retval < 0) {
+        music->fading = MIX_NO_FADING;
+        return retval;
+    }
+    music->playing = SDL_TRUE;
+    music_streams[stream].music = music;
+    music_streams[stream].paused = SDL_FALSE;
+    return 0;
+}
+
+int Mix_FadeInMusicStream(int stream, Mix_Music *music, int loops, int ms)
+{
+    int retval;
+
+    if (music_fade_freq == 0) {
+        return Mix_SetError("Audio device hasn't been opened");
+    }
+    if (music == NULL) {
+        return Mix_SetError("music parameter was NULL");
+    }
+    if (!music->interface->GetAudio) {
+        return Mix_SetError("%s music can't be played on a music stream", music->interface->tag);
+    }
+
+    Mix_LockAudio();
+    retval = music_stream_play(stream, music, loops, ms);
+    Mix_UnlockAudio();
+
+    return retval;
+}
+
+int Mix_PlayMusicStream(int stream, Mix_Music *music, int loops)
+{
+    return Mix_FadeInMusicStream(stream, music, loops, 0);
+}
+
+/* Progressively stop a music stream.
+   MAKE SURE you hold the audio lock (Mix_LockAudio()) before calling this! */
+static void music_stream_fade_out(int stream, int ms)
+{
+    Mix_Music *music = music_streams[stream].music;
+    Uint64 fade_frames = music_fade_length(ms);
+
+    if (music->fading == MIX_NO_FADING) {
+        music->fade_frame = 0;
+    } else {
+        /* Pick up the fade out from the volume it's at now */
+        Uint64 frame;
+        if (music->fading == MIX_FADING_OUT) {
+            frame = music->fade_frame;
+        } else {
+            frame = music->fade_frames - music->fade_frame;
+        }
+        music->fade_frame = (frame * fade_frames) / music->fade_frames;
+    }
+    music->fading = MIX_FADING_OUT;
+    music->fade_frames = fade_frames;
+}
+
+int Mix_FadeOutMusicStream(int stream, int ms)
+{
+    int retval = 0;
+
+    if (ms <= 0) {  /* just halt immediately. */
+        return Mix_HaltMusicStream(stream);
+    }
+
+    Mix_LockAudio();
+    if (!valid_music_stream(stream)) {
+        retval = -1;
+    } else if (music_streams[stream].music) {
+        music_stream_fade_out(stream, ms);
+    }
+    Mix_UnlockAudio();
+
+    return retval;
+}
+
+int Mix_CrossFadeMusicStreams(int from, int to, Mix_Music *music, int loops, int ms)
+{
+    int retval;
+
+    if (music_fade_freq == 0) {
+        return Mix_SetError("Audio device hasn't been opened");
+    }
+    if (music == NULL) {
+        return Mix_SetError("music parameter was NULL");
+    }
+    if (!music->interface->GetAudio) {
+        return Mix_SetError("%s music can't be played on a music stream", music->interface->tag);
+    }
+    if (from == to) {
+        return Mix_SetError("Can't cross fade a music stream with itself");
+    }
+
+    /* Both fades start on the same frame and take the same number of frames */
+    Mix_LockAudio();
+    if (!valid_music_stream(from)) {
+        retval = -1;
+    } else {
+        retval = music_stream_play(to, music, loops, ms);
+        if (retval == 0 && music_streams[from].music) {
+            if (ms > 0) {
+                music_stream_fade_out(from, ms);
+            } else {
+                music_stream_halt(from);
+                if (music_stream_finished_hook) {
+                    music_stream_finished_hook(from);
+                }
+            }
+        }
+    }
+    Mix_UnlockAudio();
+
+    return retval;
+}
+
+int Mix_HaltMusicStream(int stream)
+{
+    int retval = 0;
+
+    Mix_LockAudio();
+    if (!valid_music_stream(stream)) {
+        retval = -1;
+    } else if (music_streams[stream].music) {
+        music_stream_halt(stream);
+        if (music_stream_finished_hook) {
+            music_stream_finished_hook(stream);
+        }
+    }
+    Mix_UnlockAudio();
+
+    return retval;
+}
+
+int Mix_VolumeMusicStream(int stream, int volume)
+{
+    int prev_volume;
+
+    Mix_LockAudio();
+    if (!valid_music_stream(stream)) {
+        prev_volume = -1;
+    } else {
+        prev_volume = music_streams[stream].volume;
+        if (volume >= 0) {
+            music_streams[stream].volume = SDL_min(volume, MIX_MAX_VOLUME);
+        }
+    }
+    Mix_UnlockAudio();
+
+    return prev_volume;
+}
+
+/* Pause or resume a music stream, or all of them if 'stream' is -1 */
+static int music_stream_pause(int stream, SDL_bool pause_on)
+{
+    int retval = 0;
+
+    Mix_LockAudio();
+    if (stream == -1) {
+        int i;
+        for (i = 0; i < num_music_streams; ++i) {
+            music_streams[i].paused = pause_on;
+        }
+    } else if (!valid_music_stream(stream)) {
+        retval = -1;
+    } else {
+        music_streams[stream].paused = pause_on;
+    }
+    Mix_UnlockAudio();
+
+    return retval;
+}
+
+int Mix_PauseMusicStream(int stream)
+{
+    return music_stream_pause(stream, SDL_TRUE);
+}
+
+int Mix_ResumeMusicStream(int stream)
+{
+    return music_stream_pause(stream, SDL_FALSE);
+}
+
+int Mix_PausedMusicStream(int stream)
+{
+    int paused = 0;
+
+    Mix_LockAudio();
+    if (stream < 0) {
+        int i;
+        for (i = 0; i < num_music_streams; ++i) {
+            if (music_streams[i].music && music_streams[i].paused) {
+                ++paused;
+            }
+        }
+    } else if (stream < num_music_streams && music_streams[stream].music && music_streams[stream].paused) {
+        paused = 1;
+    }
+    Mix_UnlockAudio();
+
+    return paused;
+}
+
+int Mix_PlayingMusicStream(int stream)
+{
+    int playing = 0;
+
+    Mix_LockAudio();
+    if (stream < 0) {
+        int i;
+        for (i = 0; i < num_music_streams; ++i) {
+            if (music_streams[i].music) {
+                ++playing;
+            }
+        }
+    } else if (stream < num_music_streams && music_streams[stream].music) {
+        playing = 1;
+    }
+    Mix_UnlockAudio();
+
+    return playing;
+}
+
+Mix_Fading Mix_FadingMusicStream(int stream)
+{
+    Mix_Fading fading = MIX_NO_FADING;
+
+    Mix_LockAudio();
+    if (stream >= 0 && stream < num_music_streams && music_streams[stream].music) {
+        fading = music_streams[stream].music->fading;
+    }
+    Mix_UnlockAudio();
+
+    return fading;
+}
+
+Mix_Music *Mix_GetMusicStreamMusic(int stream)
+{
+    Mix_Music *music = NULL;
+
+    Mix_LockAudio();
+    if (stream >= 0 && stream < num_music_streams) {
+        music = music_streams[stream].music;
+    }
+    Mix_UnlockAudio();
+
+    return music;
+}
+
+int Mix_SetMusicStreamPosition(int stream, double position)
+{
+    int retval = -1;
+
+    Mix_LockAudio();
+    if (valid_music_stream(stream)) {
+        Mix_Music *music = music_streams[stream].music;
+
+        if (!music) {
+            Mix_SetError("Music stream %d isn't playing", stream);
+        } else if (!music->interface->Seek) {
+            Mix_SetError("Position not implemented for music type");
+        } else {
+            /* Report why the interface failed, where it says */
+            SDL_ClearError();
+            retval = music->interface->Seek(music->context, position);
+            if (retval < 0 && !*SDL_GetError()) {
+                Mix_SetError("Couldn't seek music stream %d to %g", stream, position);
+            }
+        }
+    }
+    Mix_UnlockAudio();
+
+    return retval;
+}
+
 /* Set the external music playback command */
 int Mix_SetMusicCMD(const char *command)
 {
@@ -1425,10 +2627,15 @@ int Mix_GetSynchroValue(void)
 /* Uninitialize the music interfaces */
 void close_music(void)
 {
+    SDL_Mutex *lock;
     int i;
 
     Mix_HaltMusic();
+    Mix_AllocateMusicStreams(0);
+    _Mix_StopMusicAhead();
 
+    lock = get_music_init_lock();
+    SDL_LockMutex(lock);
     for (i = 0; i < get_num_music_interfaces(); ++i) {
         Mix_MusicInterface *interface = s_music_interfaces[i];
         if (!interface || !interface->opened) {
@@ -1440,6 +2647,14 @@ void close_music(void)
         }
         interface->opened = SDL_FALSE;
     }
+    SDL_UnlockMutex(lock);
+
+    SDL_free(music_scratch);
+    music_scratch = NULL;
+    music_scratch_len = 0;
+    SDL_free(music_stream_buf);
+    music_stream_buf = NULL;
+    music_stream_buf_len = 0;
 
     if (soundfont_paths) {
         SDL_free(soundfont_paths);
@@ -1453,13 +2668,16 @@ void close_music(void)
     }
     num_decoders = 0;
 
-    ms_per_step = 0;
+    music_fade_freq = 0;
 }
 
 /* Unload the music interface libraries */
 void unload_music(void)
 {
+    SDL_Mutex *lock = get_music_init_lock();
     int i;
+
+    SDL_LockMutex(lock);
     for (i = 0; i < get_num_music_interfaces(); ++i) {
         Mix_MusicInterface *interface = s_music_interfaces[i];
         if (!interface || !interface->loaded) {
@@ -1471,6 +2689,7 @@ void unload_music(void)
         }
         interface->loaded = SDL_FALSE;
     }
+    SDL_UnlockMutex(lock);
 }
 
 int Mix_SetTimidityCfg(const char *path)
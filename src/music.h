@@ -23,6 +23,8 @@
 
 #include <SDL3_mixer/SDL_mixer.h>
 
+#include "rt_check.h"
+
 /* Supported music APIs, in order of preference */
 
 typedef enum
@@ -170,6 +172,7 @@ extern void open_music(const SDL_AudioSpec *spec);
 extern int music_pcm_getaudio(void *context, void *data, int bytes, int volume,
                               int (*GetSome)(void *context, void *data, int bytes, SDL_bool *done));
 extern void SDLCALL music_mixer(void *udata, Uint8 *stream, int len);
+extern void mix_music_streams(Uint8 *stream, int len);
 extern void pause_async_music(int pause_on);
 extern void close_music(void);
 extern void unload_music(void);
@@ -0,0 +1,210 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+/* The ring is a single producer, single consumer queue: only the decoding
+ * thread writes, at 'write_pos', only the audio callback reads, at
+ * 'read_pos', and all they share is the count of bytes in between. The
+ * callback never waits for the thread; if the thread falls behind, the
+ * music just has a gap.
+ */
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "music_ahead.h"
+
+static SDL_Mutex *decoder_lock = NULL;
+static SDL_Condition *decoder_wake = NULL;
+static SDL_Thread *ahead_thread = NULL;
+static SDL_bool ahead_quit = SDL_FALSE;
+static Mix_MusicAheadDecode ahead_decode = NULL;
+static int ahead_poll_ms = 0;
+
+static Uint8 *ring = NULL;
+static int ring_size = 0;
+static int ring_block = 0;
+static int read_pos = 0;        /* only used by the reader */
+static int write_pos = 0;       /* only used by the decoding thread */
+static SDL_AtomicInt filled;
+static SDL_AtomicInt ended;     /* the music ended after the last byte written */
+
+static int SDLCALL ahead_thread_main(void *data)
+{
+    int space, len, left;
+
+    (void)data;
+
+    SDL_LockMutex(decoder_lock);
+    while (!ahead_quit) {
+        space = ring_size - SDL_AtomicGet(&filled);
+        if (SDL_AtomicGet(&ended) || space < ring_block) {
+            SDL_WaitConditionTimeout(decoder_wake, decoder_lock, ahead_poll_ms);
+            continue;
+        }
+
+        len = SDL_min(ring_block, ring_size - write_pos);
+        left = ahead_decode(ring + write_pos, len);
+        if (left < 0) {
+            /* Nothing playing, or nothing we decode */
+            SDL_WaitConditionTimeout(decoder_wake, decoder_lock, ahead_poll_ms);
+            continue;
+        }
+        left = SDL_min(left, len);
+
+        write_pos += len - left;
+        if (write_pos == ring_size) {
+            write_pos = 0;
+        }
+        SDL_AtomicAdd(&filled, len - left);
+        if (left > 0) {
+            SDL_AtomicSet(&ended, 1);
+        }
+    }
+    SDL_UnlockMutex(decoder_lock);
+    return 0;
+}
+
+int _Mix_StartMusicAhead(int size, int block, int poll_ms, Mix_MusicAheadDecode decode)
+{
+    if (size <= 0 || block <= 0 || block > size) {
+        return Mix_SetError("Invalid decode ahead size");
+    }
+
+    ring = (Uint8 *)SDL_malloc((size_t)size);
+    if (!ring) {
+        return Mix_OutOfMemory();
+    }
+    ring_size = size;
+    ring_block = block;
+    read_pos = 0;
+    write_pos = 0;
+    SDL_AtomicSet(&filled, 0);
+    SDL_AtomicSet(&ended, 0);
+    ahead_decode = decode;
+    ahead_poll_ms = SDL_max(poll_ms, 1);
+    ahead_quit = SDL_FALSE;
+
+    decoder_lock = SDL_CreateMutex();
+    decoder_wake = SDL_CreateCondition();
+    if (!decoder_lock || !decoder_wake) {
+        _Mix_StopMusicAhead();
+        return -1;
+    }
+    ahead_thread = SDL_CreateThread(ahead_thread_main, "SDL_mixer music", NULL);
+    if (!ahead_thread) {
+        _Mix_StopMusicAhead();
+        return -1;
+    }
+    return 0;
+}
+
+void _Mix_StopMusicAhead(void)
+{
+    if (ahead_thread) {
+        SDL_LockMutex(decoder_lock);
+        ahead_quit = SDL_TRUE;
+        SDL_SignalCondition(decoder_wake);
+        SDL_UnlockMutex(decoder_lock);
+        SDL_WaitThread(ahead_thread, NULL);
+        ahead_thread = NULL;
+    }
+    if (decoder_wake) {
+        SDL_DestroyCondition(decoder_wake);
+        decoder_wake = NULL;
+    }
+    if (decoder_lock) {
+        SDL_DestroyMutex(decoder_lock);
+        decoder_lock = NULL;
+    }
+    SDL_free(ring);
+    ring = NULL;
+    ring_size = 0;
+    ahead_decode = NULL;
+}
+
+SDL_bool _Mix_MusicAheadRunning(void)
+{
+    return ahead_thread ? SDL_TRUE : SDL_FALSE;
+}
+
+void _Mix_LockMusicDecoder(void)
+{
+    if (ahead_thread) {
+        SDL_LockMutex(decoder_lock);
+    }
+}
+
+SDL_bool _Mix_TryLockMusicDecoder(void)
+{
+    if (ahead_thread) {
+        return (SDL_TryLockMutex(decoder_lock) == 0) ? SDL_TRUE : SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+void _Mix_UnlockMusicDecoder(void)
+{
+    if (ahead_thread) {
+        SDL_UnlockMutex(decoder_lock);
+    }
+}
+
+void _Mix_FlushMusicAhead(void)
+{
+    if (!ahead_thread) {
+        return;
+    }
+    read_pos = 0;
+    write_pos = 0;
+    SDL_AtomicSet(&filled, 0);
+    SDL_AtomicSet(&ended, 0);
+    SDL_SignalCondition(decoder_wake);
+}
+
+int _Mix_ReadMusicAhead(Uint8 *dst, int len, SDL_bool *ended_out)
+{
+    int has_ended, available, n, first;
+
+    /* Check for the end first, so no bytes written before it are missed */
+    has_ended = SDL_AtomicGet(&ended);
+    available = SDL_AtomicGet(&filled);
+    n = SDL_min(len, available);
+
+    first = SDL_min(n, ring_size - read_pos);
+    SDL_memcpy(dst, ring + read_pos, (size_t)first);
+    SDL_memcpy(dst + first, ring, (size_t)(n - first));
+    read_pos += n;
+    if (read_pos >= ring_size) {
+        read_pos -= ring_size;
+    }
+    SDL_AtomicAdd(&filled, -n);
+
+    *ended_out = (has_ended && n == available) ? SDL_TRUE : SDL_FALSE;
+    return n;
+}
+
+int _Mix_MusicAheadBuffered(void)
+{
+    return ahead_thread ? SDL_AtomicGet(&filled) : 0;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,71 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef MUSIC_AHEAD_H_
+#define MUSIC_AHEAD_H_
+
+/* Decoding music ahead of the audio callback, for
+ * SDL_MIXER_HINT_MUSIC_DECODE_AHEAD.
+ *
+ * A thread decodes into a ring buffer, and the audio callback only copies
+ * out of it, so slow decoders and disk reads can't make it miss a deadline.
+ *
+ * The thread holds the decoder lock while it decodes, so anything else that
+ * uses the playing music's decoder must hold it too, taken after the audio
+ * lock. The ring is only read with the audio lock held, so nothing touches
+ * it while both locks are held.
+ */
+
+#include <SDL3/SDL_stdinc.h>
+
+/* Fill 'len' bytes at 'dst', returning how many bytes couldn't be filled
+ * because the music ended, like GetAudio, or -1 if there's nothing to
+ * decode right now. Called with the decoder lock held. */
+typedef int (*Mix_MusicAheadDecode)(Uint8 *dst, int len);
+
+/* Start the thread with a ring of 'size' bytes, which it fills 'block'
+ * bytes at a time, checking for room every 'poll_ms' milliseconds */
+extern int _Mix_StartMusicAhead(int size, int block, int poll_ms, Mix_MusicAheadDecode decode);
+extern void _Mix_StopMusicAhead(void);
+extern SDL_bool _Mix_MusicAheadRunning(void);
+
+/* These do nothing if the thread isn't running */
+extern void _Mix_LockMusicDecoder(void);
+extern SDL_bool _Mix_TryLockMusicDecoder(void);
+extern void _Mix_UnlockMusicDecoder(void);
+
+/* Throw away everything decoded so far, after the music was started,
+ * stopped or moved, and wake the thread to decode from the new position.
+ * MAKE SURE you hold both the audio lock and the decoder lock! */
+extern void _Mix_FlushMusicAhead(void);
+
+/* Take up to 'len' bytes off the ring, returning how many there were;
+ * '*ended' is set once the music ended and all of it has been taken.
+ * MAKE SURE you hold the audio lock, as the audio callback does. */
+extern int _Mix_ReadMusicAhead(Uint8 *dst, int len, SDL_bool *ended);
+
+/* How many bytes are decoded and waiting */
+extern int _Mix_MusicAheadBuffered(void);
+
+#endif /* MUSIC_AHEAD_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
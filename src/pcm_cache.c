@@ -0,0 +1,236 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+/* A cached chunk is a 64 byte header, all numbers little endian:
+ *
+ *   char   magic[8]        "MIXPCM" and 0x00 0x1A
+ *   Uint32 version         1
+ *   Uint32 format          of the samples
+ *   Uint64 source_hash     of the file that was loaded
+ *   Uint64 source_size
+ *   Uint64 config_hash
+ *   Uint32 channels        of the samples, and the device
+ *   Uint32 device_freq
+ *   Uint32 freq            of the samples
+ *   Uint32 native_rate     1 if SDL_MIXER_HINT_NATIVE_RATE_CHUNKS was set
+ *   Uint32 length          of the samples in bytes
+ *   Uint32 reserved        0
+ *
+ * followed by the samples, exactly as the chunk had them.
+ */
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "pcm_cache.h"
+#include "mapped_file.h"
+#include "utils.h"
+
+#include <stdio.h>  /* rename(), remove() */
+#if defined(_WIN32)
+#include <process.h>    /* _getpid() */
+#define getpid _getpid
+#else
+#include <unistd.h>     /* getpid() */
+#endif
+
+#define MIX_PCM_CACHE_VERSION   1
+
+static void put_le32(Uint8 *p, Uint32 value)
+{
+    p[0] = (Uint8)value;
+    p[1] = (Uint8)(value >> 8);
+    p[2] = (Uint8)(value >> 16);
+    p[3] = (Uint8)(value >> 24);
+}
+
+static void put_le64(Uint8 *p, Uint64 value)
+{
+    put_le32(p, (Uint32)value);
+    put_le32(p + 4, (Uint32)(value >> 32));
+}
+
+static Uint32 read_le32(const Uint8 *p)
+{
+    return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static Uint64 read_le64(const Uint8 *p)
+{
+    return (Uint64)read_le32(p) | ((Uint64)read_le32(p + 4) << 32);
+}
+
+/* The header for 'key' and the samples it describes */
+static void make_header(Uint8 *header, const Mix_PCMCacheKey *key, int freq, Uint32 length)
+{
+    SDL_memset(header, 0, MIX_PCM_CACHE_HEADER_SIZE);
+    SDL_memcpy(header, "MIXPCM\0\x1a", 8);
+    put_le32(header + 8, MIX_PCM_CACHE_VERSION);
+    put_le32(header + 12, key->device.format);
+    put_le64(header + 16, key->source_hash);
+    put_le64(header + 24, key->source_size);
+    put_le64(header + 32, key->config_hash);
+    put_le32(header + 40, (Uint32)key->device.channels);
+    put_le32(header + 44, (Uint32)key->device.freq);
+    put_le32(header + 48, (Uint32)freq);
+    put_le32(header + 52, key->native_rate ? 1 : 0);
+    put_le32(header + 56, length);
+}
+
+/* Everything besides the source and the format that the samples depend on */
+static Uint64 hash_config(void)
+{
+    const char *revision = SDL_GetRevision();
+    Uint64 hash = MIX_HASH_INIT;
+    int version[3], i;
+
+    version[0] = SDL_MIXER_MAJOR_VERSION;
+    version[1] = SDL_MIXER_MINOR_VERSION;
+    version[2] = SDL_MIXER_PATCHLEVEL;
+    hash = _Mix_HashBytes(hash, version, sizeof(version));
+    if (revision) {
+        hash = _Mix_HashBytes(hash, revision, SDL_strlen(revision));
+    }
+    for (i = 0; i < Mix_GetNumChunkDecoders(); ++i) {
+        const char *decoder = Mix_GetChunkDecoder(i);
+        hash = _Mix_HashBytes(hash, decoder, SDL_strlen(decoder) + 1);
+    }
+    return hash;
+}
+
+void _Mix_InitPCMCacheKey(Mix_PCMCacheKey *key, const void *data, size_t size, const SDL_AudioSpec *device, SDL_bool native_rate)
+{
+    const char *dir = SDL_GetHint(SDL_MIXER_HINT_PCM_CACHE_DIR);
+    const char *separator = "/";
+    Uint8 header[MIX_PCM_CACHE_HEADER_SIZE];
+    size_t dirlen, pathlen;
+    Uint64 name;
+
+    SDL_zerop(key);
+    if (!dir || !*dir) {
+        return;
+    }
+    key->source_hash = _Mix_HashBytes(MIX_HASH_INIT, data, size);
+    key->source_size = (Uint64)size;
+    key->config_hash = hash_config();
+    key->device = *device;
+    key->native_rate = native_rate;
+
+    /* The file is named after the header, which has the whole key */
+    make_header(header, key, 0, 0);
+    name = _Mix_HashBytes(MIX_HASH_INIT, header, sizeof(header));
+
+    dirlen = SDL_strlen(dir);
+    if (dir[dirlen - 1] == '/' || dir[dirlen - 1] == '\\') {
+        separator = "";
+    }
+    pathlen = dirlen + 1 + 16 + 4 + 1;
+    key->path = (char *)SDL_malloc(pathlen);
+    if (key->path) {
+        (void)SDL_snprintf(key->path, pathlen, "%s%s%016" SDL_PRIx64 ".pcm", dir, separator, name);
+    }
+}
+
+void _Mix_FreePCMCacheKey(Mix_PCMCacheKey *key)
+{
+    SDL_free(key->path);
+    key->path = NULL;
+}
+
+const Uint8 *_Mix_MapPCMCache(const Mix_PCMCacheKey *key, size_t *map_size, int *freq, Uint32 *length)
+{
+    Uint8 expected[MIX_PCM_CACHE_HEADER_SIZE];
+    const Uint8 *map;
+    size_t size;
+    Uint32 frame_size;
+
+    if (!key->path) {
+        return NULL;
+    }
+    map = _Mix_MapFile(key->path, &size);
+    if (!map) {
+        return NULL;
+    }
+
+    /* Everything but the rate and length of the samples must match */
+    if (size >= MIX_PCM_CACHE_HEADER_SIZE) {
+        *freq = (int)read_le32(map + 48);
+        *length = read_le32(map + 56);
+        make_header(expected, key, *freq, *length);
+        frame_size = (SDL_AUDIO_BITSIZE(key->device.format) / 8) * (Uint32)key->device.channels;
+        if (SDL_memcmp(map, expected, sizeof(expected)) == 0 &&
+            *length == size - MIX_PCM_CACHE_HEADER_SIZE &&
+            frame_size > 0 && (*length % frame_size) == 0 && *freq > 0 &&
+            (key->native_rate || *freq == key->device.freq)) {
+            *map_size = size;
+            return map;
+        }
+    }
+    _Mix_UnmapFile(map, size);
+    return NULL;
+}
+
+void _Mix_StorePCMCache(const Mix_PCMCacheKey *key, int freq, const Uint8 *samples, Uint32 length)
+{
+    Uint8 header[MIX_PCM_CACHE_HEADER_SIZE];
+    SDL_RWops *dst;
+    char *temp;
+    size_t templen;
+    Uint64 nonce;
+    SDL_bool written;
+
+    if (!key->path) {
+        return;
+    }
+
+    /* Write a file of our own and rename it into place, so that nobody
+       ever maps a half written file. Other processes may share the cache
+       directory, so the name has our process ID and a random part too. */
+    templen = SDL_strlen(key->path) + 80;
+    temp = (char *)SDL_malloc(templen);
+    if (!temp) {
+        return;
+    }
+    nonce = SDL_GetPerformanceCounter();
+    nonce = _Mix_HashBytes(MIX_HASH_INIT, &nonce, sizeof(nonce));
+    nonce = _Mix_HashBytes(nonce, &temp, sizeof(temp));
+    (void)SDL_snprintf(temp, templen, "%s.%d.%" SDL_PRIu64 ".%016" SDL_PRIx64 ".tmp", key->path,
+                       (int)getpid(), (Uint64)SDL_GetCurrentThreadID(), nonce);
+    dst = SDL_RWFromFile(temp, "wb");
+    if (!dst) {
+        SDL_free(temp);
+        return;
+    }
+    make_header(header, key, freq, length);
+    written = (SDL_RWwrite(dst, header, sizeof(header)) == sizeof(header) &&
+               SDL_RWwrite(dst, samples, length) == length);
+    if (SDL_RWclose(dst) < 0) {
+        written = SDL_FALSE;
+    }
+    if (!written || rename(temp, key->path) != 0) {
+        /* Out of space, or another loader got there first */
+        remove(temp);
+    }
+    SDL_free(temp);
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,66 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef PCM_CACHE_H_
+#define PCM_CACHE_H_
+
+/* An on-disk cache of chunks as Mix_LoadWAV_RW() leaves them, decoded and
+ * converted, so that the next load of the same file for the same audio
+ * format maps the result instead of decoding it again. Enabled by
+ * SDL_MIXER_HINT_PCM_CACHE_DIR.
+ *
+ * A cached file is named after a hash of everything its contents depend
+ * on, and its header repeats all of that, so entries for other sources,
+ * formats or library builds are never mistaken for it; they're simply
+ * never looked up again.
+ */
+
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_audio.h>
+
+#define MIX_PCM_CACHE_HEADER_SIZE   64  /* samples start here, aligned */
+
+typedef struct
+{
+    char *path;             /* of the cached file, NULL if caching is off */
+    Uint64 source_hash;
+    Uint64 source_size;
+    Uint64 config_hash;     /* decoders and library versions */
+    SDL_AudioSpec device;
+    SDL_bool native_rate;
+} Mix_PCMCacheKey;
+
+/* Set up the key for loading 'size' bytes of 'data' for the 'device'
+ * format; its path stays NULL if caching is off, or there's no memory. */
+extern void _Mix_InitPCMCacheKey(Mix_PCMCacheKey *key, const void *data, size_t size, const SDL_AudioSpec *device, SDL_bool native_rate);
+extern void _Mix_FreePCMCacheKey(Mix_PCMCacheKey *key);
+
+/* Map the cached file, returning the mapping, with the samples at
+ * MIX_PCM_CACHE_HEADER_SIZE, or NULL if there's no valid one */
+extern const Uint8 *_Mix_MapPCMCache(const Mix_PCMCacheKey *key, size_t *map_size, int *freq, Uint32 *length);
+
+/* Store the samples of a freshly loaded chunk; failing is harmless */
+extern void _Mix_StorePCMCache(const Mix_PCMCacheKey *key, int freq, const Uint8 *samples, Uint32 length);
+
+#endif /* PCM_CACHE_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
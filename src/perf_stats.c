@@ -0,0 +1,140 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+/* Mixer performance counters.
+ *
+ * Only the audio thread writes the counters, so they're published with a
+ * sequence lock: the writer makes the sequence odd while it updates them,
+ * and readers retry until they copy them with the same even sequence on
+ * both sides. Resets are requested by readers and done by the writer.
+ */
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "perf_stats.h"
+
+static SDL_AtomicInt perf_enabled;
+static SDL_AtomicInt perf_reset;
+static SDL_AtomicInt perf_sequence;
+static Mix_PerfStats perf_stats;
+
+
+static Uint64 ticks_to_ns(Uint64 ticks)
+{
+    static Uint64 frequency = 0;
+
+    if (!frequency) {
+        frequency = SDL_GetPerformanceFrequency();
+    }
+    /* Split to avoid overflow with fast counters */
+    return (ticks / frequency) * SDL_NS_PER_SECOND + ((ticks % frequency) * SDL_NS_PER_SECOND) / frequency;
+}
+
+static int histogram_bucket(Uint64 ns)
+{
+    Uint64 us = ns / 1000;
+    int bucket = 0;
+
+    while (us >= 2 && bucket < MIX_PERF_HISTOGRAM_BUCKETS - 1) {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+SDL_bool _Mix_PerfStatsEnabled(void)
+{
+    return SDL_AtomicGet(&perf_enabled) ? SDL_TRUE : SDL_FALSE;
+}
+
+void _Mix_RecordPerfSample(const MixPerfSample *sample)
+{
+    Mix_PerfStats *stats = &perf_stats;
+    Uint64 callback_ns = ticks_to_ns(sample->callback_time);
+
+    SDL_AtomicAdd(&perf_sequence, 1);
+
+    if (SDL_AtomicGet(&perf_reset)) {
+        SDL_AtomicSet(&perf_reset, 0);
+        SDL_zerop(stats);
+    }
+
+    if (stats->callbacks == 0 || callback_ns < stats->callback_ns_min) {
+        stats->callback_ns_min = callback_ns;
+    }
+    if (callback_ns > stats->callback_ns_max) {
+        stats->callback_ns_max = callback_ns;
+    }
+    ++stats->callbacks;
+    stats->callback_ns_total += callback_ns;
+    ++stats->callback_histogram[histogram_bucket(callback_ns)];
+    stats->bytes_mixed += (Uint64)sample->bytes;
+    stats->music_ns += ticks_to_ns(sample->music_time);
+    stats->channel_effects_ns += ticks_to_ns(sample->effects_time);
+    stats->postmix_ns += ticks_to_ns(sample->postmix_time);
+    if (sample->deadline_ns && callback_ns > sample->deadline_ns) {
+        ++stats->deadline_misses;
+    }
+    stats->active_voices = sample->voices;
+    if (sample->voices > stats->max_active_voices) {
+        stats->max_active_voices = sample->voices;
+    }
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicAdd(&perf_sequence, 1);
+}
+
+void Mix_EnablePerfStats(SDL_bool enable)
+{
+    SDL_AtomicSet(&perf_enabled, enable ? 1 : 0);
+}
+
+void Mix_ResetPerfStats(void)
+{
+    SDL_AtomicSet(&perf_reset, 1);
+}
+
+int Mix_GetPerfStats(Mix_PerfStats *stats)
+{
+    int before, after;
+
+    if (!stats) {
+        return Mix_SetError("Tried to get performance counters into a NULL struct");
+    }
+
+    do {
+        before = SDL_AtomicGet(&perf_sequence);
+        SDL_MemoryBarrierAcquire();
+        *stats = perf_stats;
+        SDL_MemoryBarrierAcquire();
+        after = SDL_AtomicGet(&perf_sequence);
+    } while ((before & 1) || before != after);
+
+    if (SDL_AtomicGet(&perf_reset)) {
+        /* The writer hasn't picked up the reset yet */
+        SDL_zerop(stats);
+    }
+    return 0;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
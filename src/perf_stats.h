@@ -0,0 +1,52 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef PERF_STATS_H_
+#define PERF_STATS_H_
+
+/* Performance counters for Mix_GetPerfStats().
+ *
+ * The audio thread fills in a MixPerfSample while it mixes, and hands it to
+ * _Mix_RecordPerfSample() once per callback; times are in
+ * SDL_GetPerformanceCounter() ticks. Nothing is measured unless
+ * _Mix_PerfStatsEnabled() says so.
+ */
+
+#include <SDL3/SDL_stdinc.h>
+
+typedef struct
+{
+    Uint64 callback_time;
+    Uint64 music_time;
+    Uint64 effects_time;
+    Uint64 postmix_time;
+    Uint64 deadline_ns;         /* length of the audio mixed, 0 if there's no deadline */
+    int voices;
+    int bytes;
+} MixPerfSample;
+
+extern SDL_bool _Mix_PerfStatsEnabled(void);
+extern void _Mix_RecordPerfSample(const MixPerfSample *sample);
+
+#endif /* PERF_STATS_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
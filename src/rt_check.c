@@ -0,0 +1,131 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#define MIX_RT_CHECK_IMPLEMENTATION
+#include "rt_check.h"
+
+#ifdef MIX_RT_CHECK
+
+/* The audio thread, plus one per mix worker */
+#define MAX_RT_THREADS  32
+
+static SDL_AtomicInt enabled;
+static SDL_AtomicInt in_callback;
+static SDL_ThreadID audio_thread;
+static SDL_AtomicInt num_workers;
+static SDL_ThreadID workers[MAX_RT_THREADS];
+static SDL_AtomicInt reporting;
+
+
+static SDL_bool on_mixing_thread(void)
+{
+    SDL_ThreadID self;
+    int i, count;
+
+    if (!SDL_AtomicGet(&enabled)) {
+        return SDL_FALSE;
+    }
+    self = SDL_GetCurrentThreadID();
+    if (SDL_AtomicGet(&in_callback) && self == audio_thread) {
+        return SDL_TRUE;
+    }
+    count = SDL_AtomicGet(&num_workers);
+    for (i = 0; i < count; ++i) {
+        if (workers[i] == self) {
+            return SDL_TRUE;
+        }
+    }
+    return SDL_FALSE;
+}
+
+static void report(const char *what, size_t size)
+{
+    /* Logging may allocate too; don't report that */
+    if (!SDL_AtomicCAS(&reporting, 0, 1)) {
+        return;
+    }
+    SDL_LogWarn(SDL_LOG_CATEGORY_AUDIO, "SDL_mixer: %s(%u) on a mixing thread in realtime mode", what, (unsigned int)size);
+    SDL_AtomicSet(&reporting, 0);
+}
+
+void *_Mix_RTCheckMalloc(size_t size)
+{
+    if (on_mixing_thread()) {
+        report("SDL_malloc", size);
+    }
+    return SDL_malloc(size);
+}
+
+void *_Mix_RTCheckCalloc(size_t nmemb, size_t size)
+{
+    if (on_mixing_thread()) {
+        report("SDL_calloc", nmemb * size);
+    }
+    return SDL_calloc(nmemb, size);
+}
+
+void *_Mix_RTCheckRealloc(void *mem, size_t size)
+{
+    if (on_mixing_thread()) {
+        report("SDL_realloc", size);
+    }
+    return SDL_realloc(mem, size);
+}
+
+void _Mix_RTCheckInit(void)
+{
+    SDL_AtomicSet(&num_workers, 0);
+    SDL_AtomicSet(&in_callback, 0);
+    SDL_AtomicSet(&enabled, 1);
+}
+
+void _Mix_RTCheckQuit(void)
+{
+    SDL_AtomicSet(&enabled, 0);
+    SDL_AtomicSet(&num_workers, 0);
+}
+
+void _Mix_RTCheckEnter(void)
+{
+    audio_thread = SDL_GetCurrentThreadID();
+    SDL_AtomicSet(&in_callback, 1);
+}
+
+void _Mix_RTCheckLeave(void)
+{
+    SDL_AtomicSet(&in_callback, 0);
+}
+
+void _Mix_RTCheckAddThread(void)
+{
+    int slot = SDL_AtomicAdd(&num_workers, 1);
+
+    if (slot < MAX_RT_THREADS) {
+        workers[slot] = SDL_GetCurrentThreadID();
+    } else {
+        SDL_AtomicAdd(&num_workers, -1);
+    }
+}
+
+#endif /* MIX_RT_CHECK */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,66 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef RT_CHECK_H_
+#define RT_CHECK_H_
+
+/* Debug-build detection of heap allocations on the mixing threads, for
+ * SDL_MIXER_HINT_REALTIME. SDL_mixer's own sources allocate through the
+ * wrappers below, which log any SDL_malloc(), SDL_calloc() or SDL_realloc()
+ * made by the audio thread inside the mixer callback, or by a mix worker or
+ * the mix ahead thread, while realtime mode is on. SDL's memory functions
+ * are never replaced, so allocations made inside SDL or by the application
+ * aren't seen. In release builds (NDEBUG) all of this compiles away.
+ */
+
+#include <SDL3/SDL.h>
+
+#ifndef NDEBUG
+#define MIX_RT_CHECK 1
+#endif
+
+#ifdef MIX_RT_CHECK
+extern void *_Mix_RTCheckMalloc(size_t size);
+extern void *_Mix_RTCheckCalloc(size_t nmemb, size_t size);
+extern void *_Mix_RTCheckRealloc(void *mem, size_t size);
+#ifndef MIX_RT_CHECK_IMPLEMENTATION
+#define SDL_malloc  _Mix_RTCheckMalloc
+#define SDL_calloc  _Mix_RTCheckCalloc
+#define SDL_realloc _Mix_RTCheckRealloc
+#endif
+
+extern void _Mix_RTCheckInit(void);
+extern void _Mix_RTCheckQuit(void);
+extern void _Mix_RTCheckEnter(void);        /* audio thread starts mixing */
+extern void _Mix_RTCheckLeave(void);        /* ... and is done */
+extern void _Mix_RTCheckAddThread(void);    /* a mix worker or the mix ahead thread starts up */
+#else
+#define _Mix_RTCheckInit()
+#define _Mix_RTCheckQuit()
+#define _Mix_RTCheckEnter()
+#define _Mix_RTCheckLeave()
+#define _Mix_RTCheckAddThread()
+#endif
+
+#endif /* RT_CHECK_H_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
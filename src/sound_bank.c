@@ -0,0 +1,292 @@
+/*
+  SDL_mixer:  An audio mixer library based on the SDL library
+  Copyright (C) 1997-2024 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+/* Sound banks: many sounds in one file, already in the format they're
+ * played in, so that loading them takes one file mapping instead of a
+ * file, a header parse and two allocations per sound.
+ *
+ * A bank is laid out as follows, all numbers little endian:
+ *
+ *   header, 32 bytes:
+ *     char   magic[8]      "MIXBANK" and a 0x1A byte
+ *     Uint32 version       1
+ *     Uint32 count         number of sounds
+ *     Uint32 format        SDL_AudioFormat of all the samples
+ *     Uint32 channels
+ *     Uint32 freq
+ *     Uint32 reserved      0
+ *
+ *   index, 24 bytes per sound, sorted by name (byte order, no duplicates):
+ *     Uint64 offset        of the samples, a multiple of MIX_BANK_ALIGN
+ *     Uint32 length        of the samples in bytes, whole frames
+ *     Uint32 name_offset   of the name, which is NUL terminated
+ *     Uint32 name_length   not counting the NUL
+ *     Uint32 reserved      0
+ *
+ * followed by the names and the samples, in any order. A sound's ID is
+ * its position in the index. examples/mixbank.c builds banks.
+ */
+
+#include <SDL3/SDL.h>
+
+#include <SDL3_mixer/SDL_mixer.h>
+#include "mixer.h"
+#include "mapped_file.h"
+
+#define MIX_BANK_VERSION        1
+#define MIX_BANK_HEADER_SIZE    32
+#define MIX_BANK_ENTRY_SIZE     24
+#define MIX_BANK_ALIGN          64      /* enough for any SIMD load */
+
+struct Mix_Bank
+{
+    const Uint8 *map;
+    size_t map_size;
+    const Uint8 *index;
+    int count;
+    Mix_Chunk *chunks;      /* one for each sound, in index order */
+    SDL_bool converted;     /* chunks own their samples, not the mapping */
+};
+
+static Uint32 read_le32(const Uint8 *p)
+{
+    return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static Uint64 read_le64(const Uint8 *p)
+{
+    return (Uint64)read_le32(p) | ((Uint64)read_le32(p + 4) << 32);
+}
+
+static const char *entry_name(const Mix_Bank *bank, int id)
+{
+    return (const char *)bank->map + read_le32(bank->index + id * MIX_BANK_ENTRY_SIZE + 12);
+}
+
+/* Make sure every entry is within the file and the names are sorted */
+static int check_index(const Uint8 *map, size_t size, int count, int frame_size)
+{
+    const Uint8 *entry = map + MIX_BANK_HEADER_SIZE;
+    const char *prev_name = NULL;
+    int i;
+
+    for (i = 0; i < count; ++i, entry += MIX_BANK_ENTRY_SIZE) {
+        Uint64 offset = read_le64(entry);
+        Uint32 length = read_le32(entry + 8);
+        Uint32 name_offset = read_le32(entry + 12);
+        Uint32 name_length = read_le32(entry + 16);
+        const char *name = (const char *)map + name_offset;
+
+        if (offset > size || length > size - offset ||
+            (offset % MIX_BANK_ALIGN) != 0 || (length % frame_size) != 0) {
+            return Mix_SetError("Sound bank entry %d has invalid samples", i);
+        }
+        if (name_offset >= size || name_length >= size - name_offset ||
+            name[name_length] != '\0' || SDL_strlen(name) != name_length) {
+            return Mix_SetError("Sound bank entry %d has an invalid name", i);
+        }
+        if (prev_name && SDL_strcmp(prev_name, name) >= 0) {
+            return Mix_SetError("Sound bank index isn't sorted by name");
+        }
+        prev_name = name;
+    }
+    return 0;
+}
+
+Mix_Bank *Mix_OpenBank(const char *file)
+{
+    Mix_Bank *bank;
+    SDL_AudioSpec bankspec, target;
+    Uint16 format;
+    const Uint8 *map;
+    size_t size;
+    Uint32 count;
+    int i, frame_size;
+
+    if (!file) {
+        Mix_SetError("Mix_OpenBank with NULL file");
+        return NULL;
+    }
+
+    /* Make sure audio has been opened */
+    if (!Mix_QuerySpec(&target.freq, &format, &target.channels)) {
+        Mix_SetError("Audio device hasn't been opened");
+        return NULL;
+    }
+    target.format = format;
+
+    map = _Mix_MapFile(file, &size);
+    if (!map) {
+        return NULL;
+    }
+    if (size < MIX_BANK_HEADER_SIZE || SDL_memcmp(map, "MIXBANK\x1a", 8) != 0) {
+        _Mix_UnmapFile(map, size);
+        Mix_SetError("%s is not a sound bank", file);
+        return NULL;
+    }
+    if (read_le32(map + 8) != MIX_BANK_VERSION) {
+        Mix_SetError("Unsupported sound bank version %u", (unsigned int)read_le32(map + 8));
+        _Mix_UnmapFile(map, size);
+        return NULL;
+    }
+    count = read_le32(map + 12);
+    bankspec.format = (SDL_AudioFormat)read_le32(map + 16);
+    bankspec.channels = (int)read_le32(map + 20);
+    bankspec.freq = (int)read_le32(map + 24);
+    frame_size = (SDL_AUDIO_BITSIZE(bankspec.format) / 8) * bankspec.channels;
+    if (count > (size - MIX_BANK_HEADER_SIZE) / MIX_BANK_ENTRY_SIZE ||
+        frame_size <= 0 || bankspec.channels <= 0 || bankspec.channels > 8 || bankspec.freq <= 0) {
+        _Mix_UnmapFile(map, size);
+        Mix_SetError("Invalid sound bank header");
+        return NULL;
+    }
+    if (check_index(map, size, (int)count, frame_size) < 0) {
+        _Mix_UnmapFile(map, size);
+        return NULL;
+    }
+
+    bank = (Mix_Bank *)SDL_calloc(1, sizeof(*bank));
+    if (bank) {
+        bank->chunks = (Mix_Chunk *)SDL_calloc(count ? count : 1, sizeof(Mix_Chunk));
+    }
+    if (!bank || !bank->chunks) {
+        SDL_free(bank);
+        _Mix_UnmapFile(map, size);
+        Mix_OutOfMemory();
+        return NULL;
+    }
+    bank->map = map;
+    bank->map_size = size;
+    bank->index = map + MIX_BANK_HEADER_SIZE;
+    bank->count = (int)count;
+    bank->converted = (bankspec.format != target.format ||
+                       bankspec.channels != target.channels ||
+                       bankspec.freq != target.freq);
+
+    for (i = 0; i < bank->count; ++i) {
+        const Uint8 *entry = bank->index + i * MIX_BANK_ENTRY_SIZE;
+        Mix_Chunk *chunk = &bank->chunks[i];
+        const Uint8 *samples = map + read_le64(entry);
+        Uint32 length = read_le32(entry + 8);
+
+        chunk->allocated = MIX_CHUNK_BANK;
+        chunk->volume = MIX_MAX_VOLUME;
+        if (!bank->converted) {
+            chunk->abuf = (Uint8 *)samples;
+            chunk->alen = length;
+        } else {
+            /* Built for another device format, each sound gets converted */
+            Uint8 *dst_data = NULL;
+            int dst_len = 0;
+
+            if (length > 0 &&
+                SDL_ConvertAudioSamples(&bankspec, samples, (int)length, &target, &dst_data, &dst_len) < 0) {
+                Mix_CloseBank(bank);
+                return NULL;
+            }
+            chunk->abuf = dst_data;
+            chunk->alen = (Uint32)dst_len;
+        }
+    }
+    return bank;
+}
+
+void Mix_CloseBank(Mix_Bank *bank)
+{
+    int i;
+
+    if (!bank) {
+        return;
+    }
+    _Mix_HaltChunks(bank->chunks, bank->count);
+    if (bank->converted) {
+        for (i = 0; i < bank->count; ++i) {
+            SDL_free(bank->chunks[i].abuf);
+        }
+    }
+    SDL_free(bank->chunks);
+    _Mix_UnmapFile(bank->map, bank->map_size);
+    SDL_free(bank);
+}
+
+int Mix_GetNumBankChunks(const Mix_Bank *bank)
+{
+    if (!bank) {
+        return Mix_SetError("Tried to query a NULL sound bank");
+    }
+    return bank->count;
+}
+
+Mix_Chunk *Mix_GetBankChunk(Mix_Bank *bank, int id)
+{
+    if (!bank) {
+        Mix_SetError("Tried to query a NULL sound bank");
+        return NULL;
+    }
+    if (id < 0 || id >= bank->count) {
+        Mix_SetError("Invalid sound bank ID %d", id);
+        return NULL;
+    }
+    return &bank->chunks[id];
+}
+
+const char *Mix_GetBankChunkName(const Mix_Bank *bank, int id)
+{
+    if (!bank) {
+        Mix_SetError("Tried to query a NULL sound bank");
+        return NULL;
+    }
+    if (id < 0 || id >= bank->count) {
+        Mix_SetError("Invalid sound bank ID %d", id);
+        return NULL;
+    }
+    return entry_name(bank, id);
+}
+
+int Mix_FindBankChunk(const Mix_Bank *bank, const char *name)
+{
+    int lo = 0, hi;
+
+    if (!bank) {
+        return Mix_SetError("Tried to query a NULL sound bank");
+    }
+    if (!name) {
+        return Mix_SetError("Tried to find a NULL name in a sound bank");
+    }
+
+    /* The index is sorted by name */
+    hi = bank->count - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int cmp = SDL_strcmp(name, entry_name(bank, mid));
+        if (cmp == 0) {
+            return mid;
+        } else if (cmp < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return Mix_SetError("No sound named '%s' in the bank", name);
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
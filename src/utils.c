@@ -32,6 +32,18 @@ SDL_bool _Mix_IsLoopTag(const char *tag)
     return SDL_strcasecmp(buf, "LOOP") == 0;
 }
 
+Uint64 _Mix_HashBytes(Uint64 hash, const void *data, size_t len)
+{
+    const Uint8 *bytes = (const Uint8 *)data;
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
 /* Parse time string of the form HH:MM:SS.mmm and return equivalent sample
  * position */
 Sint64 _Mix_ParseTime(char *time, long samplerate_hz)
@@ -32,5 +32,10 @@ extern Sint64 _Mix_ParseTime(char *time, long samplerate_hz);
 
 extern SDL_bool _Mix_IsLoopTag(const char *tag);
 
+/* 64-bit FNV-1a hash of 'len' bytes, continuing from 'hash', which should
+ * start out as MIX_HASH_INIT */
+#define MIX_HASH_INIT   0xcbf29ce484222325ULL
+extern Uint64 _Mix_HashBytes(Uint64 hash, const void *data, size_t len);
+
 #endif /* UTILS_H_ */
 